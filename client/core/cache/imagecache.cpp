@@ -0,0 +1,116 @@
+#include "core/cache/imagecache.h"
+#include <QCryptographicHash>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QRegularExpression>
+#include <QSaveFile>
+#include <QStandardPaths>
+
+namespace {
+constexpr int DEFAULT_MEMORY_LIMIT = 32 * 1024 * 1024; // 32MB 像素数据
+}
+
+ImageCache& ImageCache::instance()
+{
+    static ImageCache cache;
+    return cache;
+}
+
+ImageCache::ImageCache()
+    : m_memory(DEFAULT_MEMORY_LIMIT)
+{
+    const QString base = QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
+    if (!base.isEmpty() && QDir().mkpath(base + "/images")) {
+        m_diskDir = base + "/images";
+        qInfo() << "[ ImageCache ] 磁盘缓存目录:" << m_diskDir;
+    } else {
+        qWarning() << "[ ImageCache ] 磁盘缓存不可用，仅使用内存缓存";
+    }
+}
+
+QString ImageCache::memoryKey(const QString& key, const QSize& size)
+{
+    return QStringLiteral("%1@%2x%3").arg(key).arg(size.width()).arg(size.height());
+}
+
+QPixmap ImageCache::scaled(const QByteArray& bytes, const QSize& size)
+{
+    QPixmap pix;
+    if (!pix.loadFromData(bytes))
+        return QPixmap();
+    return pix.scaled(size, Qt::KeepAspectRatio, Qt::SmoothTransformation);
+}
+
+QString ImageCache::diskPath(const QString& key) const
+{
+    // 仅接受十六进制摘要作为文件名，避免任意键拼出目录穿越路径
+    static const QRegularExpression hexKey(QStringLiteral("^[0-9a-f]{16,128}$"));
+    if (m_diskDir.isEmpty() || !hexKey.match(key).hasMatch())
+        return QString();
+    return m_diskDir + "/" + key;
+}
+
+QPixmap ImageCache::insertMemory(const QString& key, const QSize& size, const QPixmap& pix)
+{
+    const int cost = qMax(1, pix.width() * pix.height() * qMax(1, pix.depth() / 8));
+    m_memory.insert(memoryKey(key, size), new QPixmap(pix), cost);
+    return pix;
+}
+
+QPixmap ImageCache::cached(const QString& key, const QSize& size)
+{
+    if (QPixmap* pix = m_memory.object(memoryKey(key, size)))
+        return *pix;
+    return QPixmap();
+}
+
+QPixmap ImageCache::load(const QString& key, const QSize& size)
+{
+    QPixmap pix = cached(key, size);
+    if (!pix.isNull())
+        return pix;
+    const QString path = diskPath(key);
+    if (path.isEmpty())
+        return QPixmap();
+    QFile f(path);
+    if (!f.open(QIODevice::ReadOnly))
+        return QPixmap();
+    pix = scaled(f.readAll(), size);
+    if (pix.isNull()) {
+        qWarning() << "[ ImageCache ] 磁盘缓存损坏，已删除:" << path;
+        f.remove();
+        return QPixmap();
+    }
+    return insertMemory(key, size, pix);
+}
+
+QPixmap ImageCache::store(const QString& key, const QByteArray& bytes, const QSize& size, bool persist)
+{
+    const QPixmap pix = scaled(bytes, size);
+    if (pix.isNull())
+        return QPixmap();
+    if (persist) {
+        const QString path = diskPath(key);
+        if (!path.isEmpty() && !QFile::exists(path)) {
+            // QSaveFile 先写临时文件再原子替换，异常退出不会留下半个文件
+            QSaveFile f(path);
+            if (!f.open(QIODevice::WriteOnly) || f.write(bytes) != bytes.size() || !f.commit())
+                qWarning() << "[ ImageCache ] 写入磁盘缓存失败:" << path;
+        }
+    }
+    return insertMemory(key, size, pix);
+}
+
+QPixmap ImageCache::fromBase64(const QString& base64, const QSize& size)
+{
+    if (base64.isEmpty())
+        return QPixmap();
+    const QByteArray latin = base64.toLatin1();
+    const QString key = QString::fromLatin1(QCryptographicHash::hash(latin, QCryptographicHash::Md5).toHex());
+    QPixmap pix = cached(key, size);
+    if (!pix.isNull())
+        return pix;
+    // 内联数据本身随响应到达，无需落盘
+    return store(key, QByteArray::fromBase64(latin), size, false);
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <QByteArray>
+#include <QCache>
+#include <QPixmap>
+#include <QSize>
+#include <QString>
+
+// 客户端图片缓存（仅在 GUI 线程使用）：
+// - 内存层：按 “内容键@尺寸” 缓存已缩放的 QPixmap，QCache 自带 LRU 淘汰，按像素字节计费
+// - 磁盘层：按内容键保存原始图片字节，重启后无需再次向服务端拉取
+// 内容键为内容哈希（如服务端下发的 image_hash），同一键对应的内容永不变化，因此无需失效逻辑。
+class ImageCache {
+public:
+    static ImageCache& instance();
+
+    // 仅查内存，未命中返回空 QPixmap
+    QPixmap cached(const QString& key, const QSize& size);
+    // 先查内存，再查磁盘（命中后解码缩放并放入内存）
+    QPixmap load(const QString& key, const QSize& size);
+    // 解码并缩放 bytes 后放入内存；persist 为 true 时同时写入磁盘。解码失败返回空 QPixmap
+    QPixmap store(const QString& key, const QByteArray& bytes, const QSize& size, bool persist = true);
+    // 便捷接口：以 base64 文本摘要为键，内存命中时跳过 base64 解码、图片解码与缩放
+    QPixmap fromBase64(const QString& base64, const QSize& size);
+
+    void setMemoryLimit(int bytes) { m_memory.setMaxCost(bytes); }
+
+private:
+    ImageCache();
+    ImageCache(const ImageCache&) = delete;
+    ImageCache& operator=(const ImageCache&) = delete;
+
+    static QString memoryKey(const QString& key, const QSize& size);
+    static QPixmap scaled(const QByteArray& bytes, const QSize& size);
+    QString diskPath(const QString& key) const;
+    QPixmap insertMemory(const QString& key, const QSize& size, const QPixmap& pix);
+
+    QCache<QString, QPixmap> m_memory;
+    QString m_diskDir;
+};
@@ -2,6 +2,11 @@
 #include "core/network/streamparser.h"
 #include "core/network/responsedispatcher.h"
 #include "core/logging/logging.h"
+#include <QCoreApplication>
+#include <QCryptographicHash>
+#include <QPointer>
+#include <QRandomGenerator>
+#include <QThreadPool>
 
 using namespace Protocol;
 
@@ -22,8 +27,9 @@ CommunicationClient::CommunicationClient(QObject* parent)
     m_pongTimeoutTimer.setSingleShot(true);
     connect(&m_pongTimeoutTimer, &QTimer::timeout, this, &CommunicationClient::onHeartbeatTimeout);
 
-    // 连接解析器->调度器
-    connect(m_parser, &StreamFrameParser::frameReady, m_dispatcher, &ResponseDispatcher::onFrame);
+    // 连接解析器->调度器（payload 为解析器缓冲区视图，必须同步处理）
+    connect(m_parser, &StreamFrameParser::frameReady, m_dispatcher, &ResponseDispatcher::onFrame,
+            Qt::DirectConnection);
     connect(m_parser, &StreamFrameParser::protocolError, this, [this](const QString& msg) {
         qWarning() << "[ Client ] 协议错误:" << msg << ", 主动断开";
         m_socket.abort();
@@ -32,24 +38,62 @@ CommunicationClient::CommunicationClient(QObject* parent)
     // 调度器->对外信号
     connect(m_dispatcher, &ResponseDispatcher::jsonResponse, this, &CommunicationClient::jsonReceived);
     connect(m_dispatcher, &ResponseDispatcher::errorResponse, this, &CommunicationClient::errorOccurred);
+    connect(m_dispatcher, &ResponseDispatcher::pushReceived, this, [this](const QJsonObject& push) {
+        emit pushReceived(push.value("topic").toString(), push.value("data").toObject());
+    });
+    connect(m_dispatcher, &ResponseDispatcher::serverHello, this, [this](const QJsonObject& hello) {
+        m_encoding = hello.value("encoding").toString() == encodingName(PayloadEncoding::Cbor)
+            ? PayloadEncoding::Cbor
+            : PayloadEncoding::Json;
+        m_headerVersion = hello.value("header_version").toInt() == VERSION_V2 ? VERSION_V2 : VERSION;
+        qInfo() << "[ Client ] 协商负载编码:" << encodingName(m_encoding)
+                << ", 压缩:" << hello.value("compression").toString()
+                << ", 头部版本:" << m_headerVersion;
+    });
     connect(m_dispatcher, &ResponseDispatcher::heartbeatPong, this, [this]() {
         qInfo() << "[ Client ] 收到心跳PONG";
         if (m_pongTimeoutTimer.isActive())
             m_pongTimeoutTimer.stop();
     });
-    // 文件下载接收
+    // 文件/blob 下载接收（数据块总是属于队首请求）
     connect(m_dispatcher, &ResponseDispatcher::fileChunkReceived, this, [this](const QByteArray& data) {
-        if (!m_downloadFile || !m_downloadFile->isOpen()) return;
-        m_downloadFile->write(data);
+        if (m_downloads.isEmpty()) return;
+        PendingDownload& d = m_downloads.head();
+        if (d.file) d.file->write(data);
+        else d.data.append(data);
     });
     connect(m_dispatcher, &ResponseDispatcher::fileDownloadCompleted, this, [this](const QJsonObject& meta) {
         Q_UNUSED(meta);
-        if (m_downloadFile) {
-            m_downloadFile->flush();
-            m_downloadFile->close();
-            m_downloadFile.reset(nullptr);
+        if (m_downloads.isEmpty()) return;
+        PendingDownload d = m_downloads.dequeue();
+        if (d.file) {
+            d.file->flush();
+            d.file->close();
+            qInfo() << "[ Client ] 文件下载完成";
+        } else {
+            emit blobReceived(d.blob, d.data);
+        }
+    });
+    connect(m_dispatcher, &ResponseDispatcher::fileUploadAck, this, &CommunicationClient::handleUploadAck);
+    connect(&m_socket, &QTcpSocket::bytesWritten, this, &CommunicationClient::pumpUploads);
+    connect(m_dispatcher, &ResponseDispatcher::fileTransferError, this, [this](const QJsonObject& err) {
+        // 上传错误带 upload_id；其余错误仅当指向队首下载时出队
+        if (handleUploadError(err)) return;
+        if (m_downloads.isEmpty()) return;
+        const PendingDownload& head = m_downloads.head();
+        const bool match = head.blob.isEmpty() ? err.value("name").toString() == head.name
+                                               : err.value("blob").toString() == head.blob;
+        if (!match) return;
+        PendingDownload d = m_downloads.dequeue();
+        const QString message = err.value("message").toString();
+        qWarning() << "[ Client ] 下载失败:" << (d.blob.isEmpty() ? d.name : d.blob) << message;
+        if (d.file) {
+            d.file->close();
+            // 续传失败时保留本地已有部分，仅清理从头开始的下载
+            if (d.offset == 0) d.file->remove();
+        } else {
+            emit blobFailed(d.blob, message);
         }
-        qInfo() << "[ Client ] 文件下载完成";
     });
 }
 
@@ -63,9 +107,11 @@ void CommunicationClient::connectToServer(const QString& host, quint16 port)
 
 void CommunicationClient::sendJson(const QJsonObject& obj)
 {
-    QByteArray payload = toJsonPayload(obj);
-    QByteArray data = pack(MessageType::JsonRequest, payload);
-    qInfo() << "[ Client ] 发送JSON请求";
+    const bool cbor = m_encoding == PayloadEncoding::Cbor;
+    const FrameTag tag { m_headerVersion, m_headerVersion == VERSION_V2 ? ++m_nextRequestId : 0, 0 };
+    QByteArray data = cbor ? pack(MessageType::CborRequest, toCborPayload(obj), tag)
+                           : pack(MessageType::JsonRequest, toJsonPayload(obj), tag);
+    qInfo() << "[ Client ] 发送" << (cbor ? "CBOR" : "JSON") << "请求";
     Log::request("CommunicationClient", obj);
     m_socket.write(data);
 }
@@ -73,15 +119,38 @@ void CommunicationClient::sendJson(const QJsonObject& obj)
 void CommunicationClient::onConnected()
 {
     qInfo() << "[ Client ] 已连接服务器";
+    // 每次（重）连接都重新协商，收到 ServerHello 之前的请求仍以 JSON + v1 头部发送
+    m_encoding = PayloadEncoding::Json;
+    m_headerVersion = VERSION;
+    sendHello();
+    // 未完成的上传重新登记，服务端回送缺失块列表后续传
+    for (auto it = m_uploads.begin(); it != m_uploads.end(); ++it) {
+        it->acked = false;
+        it->completing = false;
+        it->offsets.clear();
+        if (!it->hash.isEmpty()) sendUploadMeta(*it);
+    }
     emit connected();
     m_reconnectDelay = 1000;
     m_pingTimer.start();
 }
 
+void CommunicationClient::sendHello()
+{
+    // 按偏好顺序列出支持的编码；压缩帧由 StreamFrameParser 统一解压
+    const QJsonArray encodings { encodingName(PayloadEncoding::Cbor), encodingName(PayloadEncoding::Json) };
+    const QJsonArray compression { QStringLiteral("zlib") };
+    const QJsonArray headerVersions { int(VERSION_V2), int(VERSION) };
+    m_socket.write(pack(MessageType::ClientHello,
+                        toJsonPayload(QJsonObject{{"encodings", encodings}, {"compression", compression},
+                                                  {"header_versions", headerVersions}})));
+}
+
 void CommunicationClient::onDisconnected()
 {
     qWarning() << "[ Client ] 与服务器断开，准备重连，当前重连间隔(ms)=" << m_reconnectDelay;
     emit disconnected();
+    failPendingDownloads(QStringLiteral("disconnected"));
     m_pingTimer.stop();
     m_pongTimeoutTimer.stop();
     QTimer::singleShot(m_reconnectDelay, this, [this]() {
@@ -117,37 +186,203 @@ void CommunicationClient::onHeartbeatTimeout()
     m_socket.abort(); // 触发重连
 }
 
-bool CommunicationClient::uploadFile(const QString& localPath, const QString& serverPath)
+QString CommunicationClient::uploadFile(const QString& localPath, const QString& serverPath)
 {
-    QFile file(localPath);
-    if (!file.open(QIODevice::ReadOnly)) {
+    QSharedPointer<QFile> file(new QFile(localPath));
+    if (!file->open(QIODevice::ReadOnly)) {
         qWarning() << "[ Client ] 打开文件失败:" << localPath;
-        return false;
+        return QString();
+    }
+    PendingUpload upload;
+    do {
+        upload.id = QRandomGenerator::global()->generate64();
+    } while (upload.id == 0 || m_uploads.contains(upload.id));
+    upload.name = serverPath.isEmpty() ? QFileInfo(*file).fileName() : serverPath;
+    upload.size = file->size();
+    upload.file = file;
+    m_uploads.insert(upload.id, upload);
+    // 在线程池中计算内容哈希（读整个文件，不阻塞界面线程），完成后再登记会话；
+    // 数据块在收到缺失块列表后发送（未连接时等重连后再登记）
+    const quint64 id = upload.id;
+    QPointer<CommunicationClient> self(this);
+    QThreadPool::globalInstance()->start([self, id, localPath]() {
+        QString hash;
+        QFile f(localPath);
+        QCryptographicHash sha(QCryptographicHash::Sha256);
+        if (f.open(QIODevice::ReadOnly) && sha.addData(&f)) hash = QString::fromLatin1(sha.result().toHex());
+        // 经由应用对象回到主线程，再检查客户端是否仍然存在
+        QMetaObject::invokeMethod(QCoreApplication::instance(), [self, id, hash]() {
+            if (self) self->onUploadHashed(id, hash);
+        }, Qt::QueuedConnection);
+    });
+    return uploadIdToString(id);
+}
+
+void CommunicationClient::onUploadHashed(quint64 id, const QString& hash)
+{
+    auto it = m_uploads.find(id);
+    if (it == m_uploads.end()) return;
+    if (hash.isEmpty()) {
+        const QString name = it->name;
+        it->file->close();
+        m_uploads.erase(it);
+        qWarning() << "[ Client ] 读取上传文件失败:" << name;
+        emit uploadFailed(uploadIdToString(id), QStringLiteral("read failed"));
+        return;
     }
-    const QString name = serverPath.isEmpty() ? QFileInfo(file).fileName() : serverPath;
-    const qint64 size = file.size();
-    // 1) 发送 meta
-    m_socket.write(pack(MessageType::FileUploadMeta, toJsonPayload(QJsonObject{{"name", name}, {"size", size}})));
-    // 2) 发送所有数据块
-    while (!file.atEnd()) {
-        QByteArray chunk = file.read(Protocol::FILE_CHUNK_SIZE);
-        m_socket.write(pack(MessageType::FileUploadChunk, chunk));
+    it->hash = hash;
+    if (m_socket.state() == QAbstractSocket::ConnectedState) sendUploadMeta(*it);
+}
+
+void CommunicationClient::sendUploadMeta(const PendingUpload& upload)
+{
+    m_socket.write(pack(MessageType::FileUploadMeta,
+                        toJsonPayload(QJsonObject{{"upload_id", uploadIdToString(upload.id)},
+                                                  {"name", upload.name}, {"size", upload.size},
+                                                  {"hash", upload.hash}})));
+}
+
+void CommunicationClient::handleUploadAck(const QJsonObject& ack)
+{
+    const QString idText = ack.value("upload_id").toString();
+    auto it = m_uploads.find(uploadIdFromString(idText));
+    if (it == m_uploads.end()) return;
+    if (ack.value("uploaded").toBool()) {
+        it->file->close();
+        m_uploads.erase(it);
+        qInfo() << "[ Client ] 文件上传完成:" << ack.value("file").toString()
+                << (ack.value("deduplicated").toBool() ? "（服务端已有相同内容）" : "");
+        emit uploadFinished(idText, ack.value("hash").toString());
+        return;
+    }
+    // 缺失块列表：[[first, last], ...]，块序号闭区间
+    const qint64 chunkSize = ack.value("chunk_size").toVariant().toLongLong();
+    PendingUpload& upload = it.value();
+    upload.offsets.clear();
+    qint64 missingBytes = 0;
+    for (const auto& v : ack.value("missing").toArray()) {
+        const QJsonArray range = v.toArray();
+        for (qint64 i = range.at(0).toVariant().toLongLong(); i <= range.at(1).toVariant().toLongLong(); ++i) {
+            const qint64 offset = i * chunkSize;
+            upload.offsets.enqueue(offset);
+            missingBytes += qMin(chunkSize, upload.size - offset);
+        }
     }
-    file.close();
-    // 3) 完成
-    m_socket.write(pack(MessageType::FileUploadComplete, toJsonPayload(QJsonObject{{"name", name}, {"size", size}})));
+    upload.sent = upload.size - missingBytes;
+    upload.acked = true;
+    upload.completing = false;
+    emit uploadProgress(idText, upload.sent, upload.size);
+    pumpUploads();
+}
+
+bool CommunicationClient::handleUploadError(const QJsonObject& err)
+{
+    if (!err.contains("upload_id")) return false;
+    const QString idText = err.value("upload_id").toString();
+    auto it = m_uploads.find(uploadIdFromString(idText));
+    if (it == m_uploads.end()) return true;
+    const int code = err.value("code").toInt();
+    PendingUpload& upload = it.value();
+    if (code == 422 && err.contains("offset")) {
+        // 块校验失败：重发该块；已发送 Complete 时服务端会在缺失列表中再次给出
+        if (!upload.completing) upload.offsets.enqueue(err.value("offset").toVariant().toLongLong());
+        pumpUploads();
+        return true;
+    }
+    if (code == 404) {
+        // 服务端不认识该会话（重启或已过期）：重新登记，服务端给出完整缺失列表
+        if (upload.acked || upload.completing) {  // 同一轮的多个 404 只重新登记一次
+            upload.acked = false;
+            upload.completing = false;
+            upload.offsets.clear();
+            sendUploadMeta(upload);
+        }
+        return true;
+    }
+    const QString message = err.value("message").toString();
+    qWarning() << "[ Client ] 上传失败:" << upload.name << message;
+    upload.file->close();
+    m_uploads.erase(it);
+    emit uploadFailed(idText, message);
     return true;
 }
 
-bool CommunicationClient::downloadFile(const QString& serverPath, const QString& localPath)
+void CommunicationClient::pumpUploads()
 {
-    m_downloadFile.reset(new QFile(localPath));
-    if (!m_downloadFile->open(QIODevice::WriteOnly)) {
+    if (m_uploads.isEmpty() || m_socket.state() != QAbstractSocket::ConnectedState) return;
+    QList<quint64> failed;
+    bool progressed = true;
+    // 各上传轮流发送一块，直到写缓冲达到窗口或无块可发
+    while (progressed && m_socket.bytesToWrite() < UPLOAD_WINDOW_BYTES) {
+        progressed = false;
+        for (auto it = m_uploads.begin(); it != m_uploads.end(); ++it) {
+            PendingUpload& upload = it.value();
+            if (!upload.acked || upload.completing) continue;
+            if (upload.offsets.isEmpty()) {
+                upload.completing = true;
+                m_socket.write(pack(MessageType::FileUploadComplete,
+                                    toJsonPayload(QJsonObject{{"upload_id", uploadIdToString(upload.id)}})));
+                continue;
+            }
+            const qint64 offset = upload.offsets.dequeue();
+            const qint64 length = qMin<qint64>(FILE_CHUNK_SIZE, upload.size - offset);
+            const QByteArray data = upload.file->seek(offset) ? upload.file->read(length) : QByteArray();
+            if (data.size() != length) {
+                upload.acked = false; // 本轮不再参与发送
+                failed.append(upload.id);
+                continue;
+            }
+            m_socket.write(pack(MessageType::FileUploadChunk, packUploadChunk(upload.id, offset, data)));
+            upload.sent += length;
+            emit uploadProgress(uploadIdToString(upload.id), upload.sent, upload.size);
+            progressed = true;
+            if (m_socket.bytesToWrite() >= UPLOAD_WINDOW_BYTES) break;
+        }
+    }
+    for (quint64 id : failed) {
+        PendingUpload upload = m_uploads.take(id);
+        upload.file->close();
+        qWarning() << "[ Client ] 读取上传文件失败:" << upload.name;
+        emit uploadFailed(uploadIdToString(id), QStringLiteral("read failed"));
+    }
+}
+
+bool CommunicationClient::downloadFile(const QString& serverPath, const QString& localPath, bool resume)
+{
+    QSharedPointer<QFile> file(new QFile(localPath));
+    const QIODevice::OpenMode mode = resume ? (QIODevice::WriteOnly | QIODevice::Append) : QIODevice::WriteOnly;
+    if (!file->open(mode)) {
         qWarning() << "[ Client ] 无法创建下载文件:" << localPath;
-        m_downloadFile.reset(nullptr);
         return false;
     }
-    // 请求下载
-    m_socket.write(pack(MessageType::FileDownloadRequest, toJsonPayload(QJsonObject{{"name", serverPath}})));
+    const qint64 offset = resume ? file->size() : 0;
+    m_downloads.enqueue(PendingDownload{serverPath, QString(), file, QByteArray(), offset});
+    // 请求下载（offset > 0 时只请求剩余部分）
+    QJsonObject req{{"name", serverPath}};
+    if (offset > 0) req["offset"] = offset;
+    m_socket.write(pack(MessageType::FileDownloadRequest, toJsonPayload(req)));
     return true;
 }
+
+void CommunicationClient::fetchBlob(const QString& hash)
+{
+    if (hash.isEmpty()) return;
+    for (const auto& d : m_downloads) {
+        if (d.blob == hash) return;
+    }
+    m_downloads.enqueue(PendingDownload{QString(), hash, {}, QByteArray()});
+    m_socket.write(pack(MessageType::FileDownloadRequest, toJsonPayload(QJsonObject{{"blob", hash}})));
+}
+
+void CommunicationClient::failPendingDownloads(const QString& message)
+{
+    // 断线后服务端不会再回送，在途请求全部作废；已写入的文件部分保留，重连后可用 resume 续传
+    while (!m_downloads.isEmpty()) {
+        PendingDownload d = m_downloads.dequeue();
+        if (d.file) {
+            d.file->close();
+        } else {
+            emit blobFailed(d.blob, message);
+        }
+    }
+}
@@ -5,6 +5,10 @@
 #include <QTcpSocket>
 #include <QTimer>
 #include <QFile>
+#include <QHash>
+#include <QQueue>
+#include <QSharedPointer>
+#include "core/network/protocol.h"
 
 class StreamFrameParser;
 class ResponseDispatcher;
@@ -25,12 +29,27 @@ signals:
     void disconnected();
     void jsonReceived(const QJsonObject& obj);
     void errorOccurred(int code, const QString& message);
+    // fetchBlob 请求的内容到达；同一哈希的内容永不变化，可按哈希长期缓存
+    void blobReceived(const QString& hash, const QByteArray& bytes);
+    void blobFailed(const QString& hash, const QString& message);
+    // uploadFile 的进度与结果；uploadId 为 uploadFile 的返回值
+    void uploadProgress(const QString& uploadId, qint64 sent, qint64 total);
+    // hash 为服务端存储该内容所用的 SHA-256，可作为聊天附件等的引用
+    void uploadFinished(const QString& uploadId, const QString& hash);
+    void uploadFailed(const QString& uploadId, const QString& message);
+    // 服务端推送（需先由业务服务发送 push_subscribe 订阅）
+    void pushReceived(const QString& topic, const QJsonObject& data);
 
 public slots:
     void sendJson(const QJsonObject& obj);
     // 最简文件上传/下载 API（无需鉴权）
-    bool uploadFile(const QString& localPath, const QString& serverPath);
-    bool downloadFile(const QString& serverPath, const QString& localPath);
+    // 上传为非阻塞：立即返回 upload_id（打开文件失败返回空）。先在后台计算内容哈希，服务端已有同内容时直接完成，
+    // 否则数据块在 socket 可写时分批发出，多个上传轮流发送；断线重连后自动向服务端查询缺失块并续传
+    QString uploadFile(const QString& localPath, const QString& serverPath);
+    // resume=true 且本地文件已存在时，从本地已有长度处续传（服务端按 offset 区间回送）
+    bool downloadFile(const QString& serverPath, const QString& localPath, bool resume = false);
+    // 按内容哈希拉取服务端 BlobStore 中的数据（如药品图片），已在途的同一哈希不会重复请求
+    void fetchBlob(const QString& hash);
 
 private slots:
     void onConnected();
@@ -50,6 +69,42 @@ private:
     int m_reconnectDelay = 1000; // ms
     QString m_host;
     quint16 m_port = 0;
-    // 下载临时文件句柄
-    QScopedPointer<QFile> m_downloadFile;
+    // 在途下载：服务端按请求顺序逐个完整回送 Chunk...Complete，因此用 FIFO 对应
+    struct PendingDownload {
+        QString name;                // 文件下载的服务端路径
+        QString blob;                // 非空表示 blob 下载
+        QSharedPointer<QFile> file;  // 文件下载目标
+        QByteArray data;             // blob 下载的累积缓冲
+        qint64 offset = 0;           // 续传起点（0 表示完整下载）
+    };
+    QQueue<PendingDownload> m_downloads;
+    // 在途上传：以 upload_id 为键，跨重连保留
+    struct PendingUpload {
+        quint64 id = 0;
+        QString name;                // 服务端文件名
+        qint64 size = 0;
+        qint64 sent = 0;             // 服务端已有 + 本轮已发出的字节数（用于进度）
+        QSharedPointer<QFile> file;
+        QString hash;                // 内容 SHA-256，后台计算完成前为空，计算完成后才登记会话
+        QQueue<qint64> offsets;      // 待发送块的偏移（来自服务端的缺失块列表）
+        bool acked = false;          // 本连接上已收到缺失块列表，可以发送数据
+        bool completing = false;     // 已发送 FileUploadComplete，等待结果
+    };
+    QHash<quint64, PendingUpload> m_uploads;
+    // socket 写缓冲中上传数据的上限，超过则等 bytesWritten 再继续，避免一次性把文件读入内存
+    static constexpr qint64 UPLOAD_WINDOW_BYTES = 4 * Protocol::FILE_CHUNK_SIZE;
+    // 与服务端协商的业务负载编码（收到 ServerHello 前使用 JSON）
+    Protocol::PayloadEncoding m_encoding = Protocol::PayloadEncoding::Json;
+    // 与服务端协商的请求帧头部版本；v2 时每个请求在头部携带自增的 requestId
+    quint8 m_headerVersion = Protocol::VERSION;
+    quint64 m_nextRequestId = 0;
+
+    void sendHello();
+    void failPendingDownloads(const QString& message);
+    void onUploadHashed(quint64 id, const QString& hash);
+    void sendUploadMeta(const PendingUpload& upload);
+    void pumpUploads();
+    void handleUploadAck(const QJsonObject& ack);
+    // 处理指向上传的错误；不是上传错误时返回 false
+    bool handleUploadError(const QJsonObject& err);
 };
@@ -3,21 +3,28 @@
 #include <QDebug>
 #include <QMetaType>
 #include <QtCore>
+#include <array>
 
 namespace Protocol {
 
 //======================== 协议总体说明（中文） ========================
 // 本模块定义了客户端与服务端之间的自定义二进制协议：
 // - 固定头部（大端序）：
-//   magic(4) | version(1) | type(2) | payloadSize(4)
+//   v1: magic(4) | version(1) | type(2) | payloadSize(4)
+//   v2: magic(4) | version(1) | type(2) | payloadSize(4) | flags(2) | requestId(8)
+//   v2 在 v1 之后追加扩展字段，解析器按 version 决定头部长度；requestId 由客户端为每个请求分配，
+//   服务端在对应响应的头部原样带回，用于请求/响应关联（v1 客户端仍使用 JSON 内的 uuid/request_uuid）
 // - 变长字段：payload(payloadSize字节)
-// - payload 通常为 JSON（QJsonObject）经压缩（Compact）后的字节串
-// 该头部尺寸由 FIXED_HEADER_SIZE 常量给出，双方需保持一致。
+// - payload 通常为 JSON（QJsonObject）经压缩（Compact）后的字节串；
+//   连接建立后双方可通过 ClientHello/ServerHello 协商改用 CBOR（二进制）编码业务请求/响应，
+//   以及对大负载启用 zlib 压缩（type 最高位 COMPRESSED_FLAG 置位）
+// v1/v2 头部尺寸分别由 FIXED_HEADER_SIZE / HEADER_SIZE_V2 给出，双方需保持一致。
 //====================================================================
 
 // 常量定义
 static constexpr quint32 MAGIC = 0x1A2B3C4D;
 static constexpr quint8 VERSION = 1;
+static constexpr quint8 VERSION_V2 = 2; // 经 ClientHello/ServerHello 协商后使用
 
 // 配置项
 static constexpr quint16 SERVER_PORT = 8888;
@@ -31,46 +38,164 @@ enum class MessageType : quint16 {
     ErrorResponse = 3,
     HeartbeatPing = 4,
     HeartbeatPong = 5,
+    // 能力协商：连接建立后客户端发送 ClientHello，服务端以 ServerHello 回复最终选择
+    ClientHello = 7,           // payload: JSON { encodings: ["cbor", "json"], compression: ["zlib"], header_versions: [2, 1] }
+    ServerHello = 8,           // payload: JSON { encoding: "cbor" | "json", compression: "zlib" | "none", header_version: 2 | 1 }
+    // CBOR 编码的业务请求/响应，语义与 JsonRequest/JsonResponse 相同
+    CborRequest = 9,           // payload: CBOR map
+    CborResponse = 10,         // payload: CBOR map
+    // 服务端主动推送（连接以 action=push_subscribe 订阅后），无对应请求
+    Push = 11,                 // payload: JSON { topic, data }
     // 文件传输（保留 100+ 区间）
-    FileUploadMeta = 100,      // payload: JSON { name, size }
-    FileUploadChunk = 101,     // payload: binary chunk
-    FileUploadComplete = 102,  // payload: JSON { name, size, path }
+    // 上传以客户端生成的 upload_id 标识，同一连接可并发多个上传；断线重连后以同一 upload_id 重发 meta 即续传
+    FileUploadMeta = 100,      // payload: JSON { upload_id, name, size }
+    FileUploadChunk = 101,     // payload: 上传块头部（见 packUploadChunk）+ binary chunk
+    FileUploadComplete = 102,  // payload: JSON { upload_id }
+    FileUploadAck = 103,       // payload: JSON { upload_id, chunk_size, missing: [[first, last], ...] } 或 { upload_id, uploaded, file, size }
     FileDownloadRequest = 110, // payload: JSON { name }
     FileDownloadChunk = 111,   // payload: binary chunk
     FileDownloadComplete = 112,// payload: JSON { name, size }
     FileTransferError = 199    // payload: JSON { code, message }
 };
 
+// type 字段最高位作为压缩标志：置位表示 payload 为 qCompress（zlib）压缩后的字节
+static constexpr quint16 COMPRESSED_FLAG = 0x8000;
+// 仅对不小于该阈值的负载尝试压缩（小包压缩收益低于 CPU 开销）
+static constexpr int COMPRESS_THRESHOLD = 8 * 1024; // 8KB
+// 解压后的最大允许尺寸，防止压缩炸弹
+static constexpr int MAX_UNCOMPRESSED_SIZE = 64 * 1024 * 1024; // 64MB
+
 // 头部结构（大端序）
 struct Header {
     quint32 magic = MAGIC;
     quint8 version = VERSION;
-    MessageType type = MessageType::JsonRequest;
-    quint32 payloadSize = 0;
+    MessageType type = MessageType::JsonRequest; // 已去除压缩标志位
+    quint32 payloadSize = 0;                     // 线上（可能为压缩后）的字节数
+    bool compressed = false;                     // 线上 payload 是否经过压缩（解析器已负责解压）
+    quint16 flags = 0;                           // 仅 v2：保留的帧标志位，当前为 0
+    quint64 requestId = 0;                       // 仅 v2：请求 id（0 表示未携带）
 };
 
 static constexpr int FIXED_HEADER_SIZE = sizeof(quint32) + sizeof(quint8) + sizeof(quint16) + sizeof(quint32);
+static constexpr int HEADER_SIZE_V2 = FIXED_HEADER_SIZE + sizeof(quint16) + sizeof(quint64);
+
+// 出站帧的头部扩展信息：version 为 VERSION_V2 时写出 flags/requestId，否则按 v1 头部打包
+struct FrameTag {
+    quint8 version = VERSION;
+    quint64 requestId = 0;
+    quint16 flags = 0;
+};
+
+inline int headerSize(quint8 version)
+{
+    return version == VERSION_V2 ? HEADER_SIZE_V2 : FIXED_HEADER_SIZE;
+}
 static constexpr int FILE_CHUNK_SIZE = 64 * 1024; // 64KB
 
-// 将消息打包为协议帧：固定头 + payload
-inline QByteArray pack(MessageType type, const QByteArray& payload)
+// FileUploadChunk 负载前缀（大端）：uploadId(8) | offset(8) | crc32(4)，其后为块数据。
+// offset 为块在文件中的绝对位置，服务端据此定位写入，块可乱序/重复到达
+static constexpr int UPLOAD_CHUNK_HEADER_SIZE = sizeof(quint64) + sizeof(qint64) + sizeof(quint32);
+
+// CRC-32（IEEE 802.3，与 zlib crc32 相同），用于逐块校验上传数据
+inline quint32 crc32(const char* data, int size)
 {
-    QByteArray out;
-    out.reserve(FIXED_HEADER_SIZE + payload.size());
-    QDataStream ds(&out, QIODevice::WriteOnly);
-    ds.setByteOrder(QDataStream::BigEndian);
-    ds.setVersion(QDataStream::Qt_5_15);
-
-    ds << (quint32)MAGIC;
-    ds << (quint8)VERSION;
-    ds << (quint16)type;
-    ds << (quint32)payload.size();
-    if (!payload.isEmpty()) {
-        ds.writeRawData(payload.constData(), payload.size());
+    static const std::array<quint32, 256> table = [] {
+        std::array<quint32, 256> t {};
+        for (quint32 i = 0; i < 256; ++i) {
+            quint32 c = i;
+            for (int k = 0; k < 8; ++k)
+                c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            t[i] = c;
+        }
+        return t;
+    }();
+    quint32 crc = 0xFFFFFFFFu;
+    for (int i = 0; i < size; ++i)
+        crc = table[(crc ^ static_cast<uchar>(data[i])) & 0xFF] ^ (crc >> 8);
+    return crc ^ 0xFFFFFFFFu;
+}
+
+// JSON 中的 upload_id 使用 16 位十六进制字符串（64 位整数超出 JSON 数字的精确范围）
+inline QString uploadIdToString(quint64 uploadId)
+{
+    return QStringLiteral("%1").arg(uploadId, 16, 16, QLatin1Char('0'));
+}
+
+inline quint64 uploadIdFromString(const QString& text)
+{
+    return text.toULongLong(nullptr, 16);
+}
+
+// 生成 FileUploadChunk 负载：块头部 + 数据
+inline QByteArray packUploadChunk(quint64 uploadId, qint64 offset, const QByteArray& data)
+{
+    QByteArray out(UPLOAD_CHUNK_HEADER_SIZE + data.size(), Qt::Uninitialized);
+    auto* p = reinterpret_cast<uchar*>(out.data());
+    qToBigEndian<quint64>(uploadId, p);
+    qToBigEndian<qint64>(offset, p + 8);
+    qToBigEndian<quint32>(crc32(data.constData(), data.size()), p + 16);
+    memcpy(p + UPLOAD_CHUNK_HEADER_SIZE, data.constData(), data.size());
+    return out;
+}
+
+// 解析 FileUploadChunk 负载；data 为 payload 的视图（不拷贝），负载过短返回 false
+inline bool parseUploadChunk(const QByteArray& payload, quint64& uploadId, qint64& offset, quint32& crc, QByteArray& data)
+{
+    if (payload.size() < UPLOAD_CHUNK_HEADER_SIZE) return false;
+    const auto* p = reinterpret_cast<const uchar*>(payload.constData());
+    uploadId = qFromBigEndian<quint64>(p);
+    offset = qFromBigEndian<qint64>(p + 8);
+    crc = qFromBigEndian<quint32>(p + 16);
+    data = QByteArray::fromRawData(payload.constData() + UPLOAD_CHUNK_HEADER_SIZE, payload.size() - UPLOAD_CHUNK_HEADER_SIZE);
+    return true;
+}
+
+// 在 out 末尾直接写入帧头（大端），不构造中间 QByteArray/QDataStream；调用方随后追加 payloadSize 字节的负载
+inline void appendFrameHeader(QByteArray& out, quint16 rawType, int payloadSize, const FrameTag& tag = FrameTag())
+{
+    const bool v2 = tag.version == VERSION_V2;
+    const int offset = out.size();
+    out.resize(offset + (v2 ? HEADER_SIZE_V2 : FIXED_HEADER_SIZE));
+    auto* p = reinterpret_cast<uchar*>(out.data()) + offset;
+    qToBigEndian<quint32>(MAGIC, p);
+    p[4] = v2 ? VERSION_V2 : VERSION;
+    qToBigEndian<quint16>(rawType, p + 5);
+    qToBigEndian<quint32>(static_cast<quint32>(payloadSize), p + 7);
+    if (v2) {
+        qToBigEndian<quint16>(tag.flags, p + FIXED_HEADER_SIZE);
+        qToBigEndian<quint64>(tag.requestId, p + FIXED_HEADER_SIZE + 2);
     }
+}
+
+// 按原始 type 字段（可含压缩标志）打包协议帧：头部 + payload
+inline QByteArray packFrame(quint16 rawType, const QByteArray& payload, const FrameTag& tag = FrameTag())
+{
+    QByteArray out;
+    out.reserve(headerSize(tag.version) + payload.size());
+    appendFrameHeader(out, rawType, payload.size(), tag);
+    out.append(payload);
     return out;
 }
 
+// 将消息打包为协议帧：头部 + payload
+inline QByteArray pack(MessageType type, const QByteArray& payload, const FrameTag& tag = FrameTag())
+{
+    return packFrame(static_cast<quint16>(type), payload, tag);
+}
+
+// 负载超过阈值时尝试 zlib 压缩；仅在压缩后更小时采用，并在 rawType 上置压缩标志。返回实际上线的负载
+inline QByteArray compressIfWorthwhile(quint16& rawType, const QByteArray& payload)
+{
+    if (payload.size() >= COMPRESS_THRESHOLD) {
+        QByteArray z = qCompress(payload);
+        if (z.size() < payload.size()) {
+            rawType |= COMPRESSED_FLAG;
+            return z;
+        }
+    }
+    return payload;
+}
+
 // 将 QJsonObject 压缩为紧凑 JSON 字节串
 inline QByteArray toJsonPayload(const QJsonObject& obj)
 {
@@ -92,6 +217,38 @@ inline QJsonObject fromJsonPayload(const QByteArray& data)
     return doc.object();
 }
 
+// 业务负载编码（按连接协商；JSON 始终可用以保持兼容）
+enum class PayloadEncoding : quint8 {
+    Json = 0,
+    Cbor = 1
+};
+
+inline QString encodingName(PayloadEncoding encoding)
+{
+    return encoding == PayloadEncoding::Cbor ? QStringLiteral("cbor") : QStringLiteral("json");
+}
+
+// 将 QJsonObject 编码为 CBOR 字节串
+inline QByteArray toCborPayload(const QJsonObject& obj)
+{
+    return QCborMap::fromJsonObject(obj).toCborValue().toCbor();
+}
+
+// 从 CBOR 字节串解析为对象；失败时与 fromJsonPayload 一样返回 { error, detail }
+inline QJsonObject fromCborPayload(const QByteArray& data)
+{
+    QCborParserError err {};
+    const QCborValue value = QCborValue::fromCbor(data, &err);
+    if (err.error != QCborError::NoError || !value.isMap()) {
+        qWarning() << "[ Protocol ] CBOR解析失败:" << err.errorString() << ", 原始字节长度=" << data.size();
+        return QJsonObject {
+            { "error", QStringLiteral("Invalid CBOR payload") },
+            { "detail", err.errorString() },
+        };
+    }
+    return value.toMap().toJsonObject();
+}
+
 } // namespace Protocol
 
 Q_DECLARE_METATYPE(Protocol::MessageType)
@@ -16,6 +16,15 @@ void ResponseDispatcher::onFrame(Header header, QByteArray payload)
     case MessageType::JsonResponse:
         handleJson(payload);
         break;
+    case MessageType::CborResponse:
+        handleCbor(payload);
+        break;
+    case MessageType::ServerHello:
+        emit serverHello(fromJsonPayload(payload));
+        break;
+    case MessageType::Push:
+        emit pushReceived(fromJsonPayload(payload));
+        break;
     case MessageType::ErrorResponse:
         handleError(payload);
         break;
@@ -28,6 +37,12 @@ void ResponseDispatcher::onFrame(Header header, QByteArray payload)
     case MessageType::FileDownloadComplete:
         emit fileDownloadCompleted(fromJsonPayload(payload));
         break;
+    case MessageType::FileUploadAck:
+        emit fileUploadAck(fromJsonPayload(payload));
+        break;
+    case MessageType::FileTransferError:
+        emit fileTransferError(fromJsonPayload(payload));
+        break;
     default:
         // 忽略非响应类（例如服务器误发的请求）
         break;
@@ -42,6 +57,15 @@ void ResponseDispatcher::handleJson(const QByteArray& payload)
     emit jsonResponse(obj);
 }
 
+void ResponseDispatcher::handleCbor(const QByteArray& payload)
+{
+    // CBOR 响应解码后与 JSON 响应走同一出口，上层服务无需区分
+    const QJsonObject obj = fromCborPayload(payload);
+    qInfo() << "[ Client ] 收到CBOR响应";
+    Log::request("CommunicationClient", obj);
+    emit jsonResponse(obj);
+}
+
 void ResponseDispatcher::handleError(const QByteArray& payload)
 {
     const QJsonObject obj = fromJsonPayload(payload);
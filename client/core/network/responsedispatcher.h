@@ -17,11 +17,19 @@ signals:
     void jsonResponse(const QJsonObject& obj);
     void errorResponse(int code, const QString& msg);
     void heartbeatPong();
+    // 能力协商结果：{ encoding }
+    void serverHello(const QJsonObject& hello);
     // 文件下载
     void fileChunkReceived(const QByteArray& data);
     void fileDownloadCompleted(const QJsonObject& meta);
+    // 文件上传：缺失块列表或完成结果
+    void fileUploadAck(const QJsonObject& ack);
+    void fileTransferError(const QJsonObject& err);
+    // 服务端主动推送：{ topic, data }
+    void pushReceived(const QJsonObject& push);
 
 private:
     void handleJson(const QByteArray& payload);
+    void handleCbor(const QByteArray& payload);
     void handleError(const QByteArray& payload);
 };
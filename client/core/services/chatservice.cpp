@@ -12,6 +12,8 @@ ChatService::ChatService(CommunicationClient* client, const QString& currentUser
 {
     Q_ASSERT(m_client);
     connect(m_client, &CommunicationClient::jsonReceived, this, &ChatService::onJsonReceived);
+    connect(m_client, &CommunicationClient::pushReceived, this, &ChatService::onPushReceived);
+    connect(m_client, &CommunicationClient::connected, this, &ChatService::onConnected);
 }
 
 void ChatService::requestChat(const QString& doctorUser, const QString& patientUser, const QString& note)
@@ -40,6 +42,16 @@ void ChatService::sendText(const QString& doctorUser, const QString& patientUser
     m_client->sendJson(req);
 }
 
+void ChatService::sendFile(const QString& doctorUser, const QString& patientUser, const QJsonObject& fileMeta)
+{
+    QJsonObject req { { "action", "send_message" }, { "uuid", QUuid::createUuid().toString(QUuid::WithoutBraces) },
+        { "user", m_currentUser }, { "doctor_user", doctorUser }, { "patient_user", patientUser },
+        { "message_id", QUuid::createUuid().toString(QUuid::WithoutBraces) },
+        { "message_type", "file" }, { "text_content", QString() }, { "file_metadata", fileMeta } };
+    Log::request("ChatService", req, "action", "send_message");
+    m_client->sendJson(req);
+}
+
 void ChatService::getHistory(const QString& doctorUser, const QString& patientUser, qint64 beforeId, int limit)
 {
     QJsonObject req { { "action", "get_history_messages" }, { "uuid", QUuid::createUuid().toString(QUuid::WithoutBraces) },
@@ -64,6 +76,14 @@ void ChatService::recentContacts(int limit)
     m_client->sendJson(req);
 }
 
+void ChatService::markRead(const QString& peer)
+{
+    QJsonObject req { { "action", "mark_read" }, { "uuid", QUuid::createUuid().toString(QUuid::WithoutBraces) },
+        { "user", m_currentUser }, { "peer", peer } };
+    Log::request("ChatService", req, "action", "mark_read");
+    m_client->sendJson(req);
+}
+
 void ChatService::onJsonReceived(const QJsonObject& obj)
 {
     const QString type = obj.value("type").toString();
@@ -120,42 +140,29 @@ void ChatService::onJsonReceived(const QJsonObject& obj)
         const bool hasMore = data.value("has_more").toBool();
         emit eventsReceived(messages, instant, nextCursor, hasMore);
 
-        // 更新游标并串联下一次轮询（由 Service 控制）
-        m_pollCursor = nextCursor;
+        // 更新游标并串联下一次轮询（由 Service 控制；已改用推送时不再续轮询）
+        m_pollCursor = std::max(m_pollCursor, nextCursor);
         m_pollInFlight = false;
-        if (m_polling) {
+        if (m_polling && !m_pushActive) {
             scheduleNextPoll();
         }
-
-        // 将 events 中的消息增量并入缓存（通常是最新的消息，可能跨多个会话）
-        // 这些消息服务端通常已是按时间升序或未知顺序，这里保持按 id 排序再合并
-        QMap<QString, QList<QJsonObject>> batchByConv;
-        for (const auto& v : messages) {
-            const QJsonObject m = v.toObject();
-            const QString doctor = m.value("doctor_username").toString();
-            const QString patient = m.value("patient_username").toString();
-            batchByConv[convKey(doctor, patient)].push_back(m);
-        }
-        for (auto it = batchByConv.begin(); it != batchByConv.end(); ++it) {
-            auto& lst = it.value();
-            std::sort(lst.begin(), lst.end(), [](const QJsonObject& a, const QJsonObject& b) {
-                return a.value("id").toVariant().toLongLong() < b.value("id").toVariant().toLongLong();
-            });
-            QList<QJsonObject> delta;
-            mergeAscending(it.key(), lst, &delta);
-            // 维护 earliestId
-            if (!lst.isEmpty()) {
-                const qint64 earliest = lst.first().value("id").toVariant().toLongLong();
-                const auto eit = m_earliestId.find(it.key());
-                if (eit == m_earliestId.end() || earliest < eit.value())
-                    m_earliestId[it.key()] = earliest;
-            }
-            // 解析 key -> doctor/patient 供信号携带
-            const auto parts = it.key().split('|');
-            const QString doctor = parts.value(0);
-            const QString patient = parts.value(1);
-            emit conversationUpserted(doctor, patient, delta);
+        mergeIncoming(messages);
+        return;
+    }
+    if (type == "push_subscribe_response") {
+        if (!obj.value("success").toBool()) {
+            scheduleNextPoll();
+            return;
         }
+        m_pushActive = true;
+        const qint64 nextCursor = (qint64)obj.value("data").toObject().value("next_cursor").toDouble();
+        m_pollCursor = std::max(m_pollCursor, nextCursor);
+        return;
+    }
+    if (type == "error_response" && obj.value("action").toString() == "push_subscribe") {
+        // 服务端不支持推送：退回长轮询
+        qWarning() << "[ ChatService ] 服务端不支持 push_subscribe，改用长轮询";
+        scheduleNextPoll();
         return;
     }
     if (type == "recent_contacts_response") {
@@ -165,6 +172,73 @@ void ChatService::onJsonReceived(const QJsonObject& obj)
     }
 }
 
+void ChatService::onPushReceived(const QString& topic, const QJsonObject& data)
+{
+    if (!m_polling)
+        return;
+    if (topic == "chat.messages") {
+        const auto messages = data.value("messages").toArray();
+        m_pollCursor = std::max(m_pollCursor, (qint64)data.value("next_cursor").toDouble());
+        emit eventsReceived(messages, QJsonArray(), m_pollCursor, false);
+        mergeIncoming(messages);
+        return;
+    }
+    if (topic == "chat.events") {
+        emit eventsReceived(QJsonArray(), data.value("events").toArray(), m_pollCursor, false);
+        return;
+    }
+}
+
+void ChatService::onConnected()
+{
+    // 重连后旧连接上的订阅与在途轮询均已失效，按当前游标重新订阅（服务端补发断线期间的消息）
+    if (!m_polling)
+        return;
+    m_pushActive = false;
+    m_pollInFlight = false;
+    subscribePush();
+}
+
+void ChatService::mergeIncoming(const QJsonArray& messages)
+{
+    // 新消息通常是最新的，可能跨多个会话；到达顺序不保证，这里按 id 排序再合并
+    QMap<QString, QList<QJsonObject>> batchByConv;
+    for (const auto& v : messages) {
+        const QJsonObject m = v.toObject();
+        const QString doctor = m.value("doctor_username").toString();
+        const QString patient = m.value("patient_username").toString();
+        batchByConv[convKey(doctor, patient)].push_back(m);
+    }
+    for (auto it = batchByConv.begin(); it != batchByConv.end(); ++it) {
+        auto& lst = it.value();
+        std::sort(lst.begin(), lst.end(), [](const QJsonObject& a, const QJsonObject& b) {
+            return a.value("id").toVariant().toLongLong() < b.value("id").toVariant().toLongLong();
+        });
+        QList<QJsonObject> delta;
+        mergeAscending(it.key(), lst, &delta);
+        // 维护 earliestId
+        if (!lst.isEmpty()) {
+            const qint64 earliest = lst.first().value("id").toVariant().toLongLong();
+            const auto eit = m_earliestId.find(it.key());
+            if (eit == m_earliestId.end() || earliest < eit.value())
+                m_earliestId[it.key()] = earliest;
+        }
+        // 解析 key -> doctor/patient 供信号携带
+        const auto parts = it.key().split('|');
+        const QString doctor = parts.value(0);
+        const QString patient = parts.value(1);
+        emit conversationUpserted(doctor, patient, delta);
+    }
+}
+
+void ChatService::subscribePush()
+{
+    QJsonObject req { { "action", "push_subscribe" }, { "uuid", QUuid::createUuid().toString(QUuid::WithoutBraces) },
+        { "user", m_currentUser }, { "cursor", (double)m_pollCursor } };
+    Log::request("ChatService", req, "action", "push_subscribe");
+    m_client->sendJson(req);
+}
+
 void ChatService::scheduleNextPoll(int delayMs)
 {
     if (!m_polling || m_pollInFlight)
@@ -184,7 +258,9 @@ void ChatService::startPolling()
     if (m_polling)
         return;
     m_polling = true;
-    scheduleNextPoll();
+    if (m_pushActive)
+        return;
+    subscribePush();
 }
 
 void ChatService::stopPolling()
@@ -14,10 +14,15 @@ public:
     void requestChat(const QString& doctorUser, const QString& patientUser, const QString& note = QString());
     void acceptChat(const QString& doctorUser, const QString& patientUser);
     void sendText(const QString& doctorUser, const QString& patientUser, const QString& text);
+    // 发送文件消息：fileMeta={hash, name, mime}，hash 为 CommunicationClient::uploadFile 完成后服务端回送的内容哈希
+    void sendFile(const QString& doctorUser, const QString& patientUser, const QJsonObject& fileMeta);
     void getHistory(const QString& doctorUser, const QString& patientUser, qint64 beforeId = 0, int limit = 20);
     void pollEvents(qint64 cursor, int timeoutSec = 1800, int limit = 50);
     void recentContacts(int limit = 20);
-    // 轮询控制（由 Service 统一串联，避免 UI 层重复触发）
+    // 清零与 peer 会话的服务端未读数（recentContacts 返回的 unread）
+    void markRead(const QString& peer);
+    // 实时接收控制（由 Service 统一串联，避免 UI 层重复触发）：优先订阅服务端推送，
+    // 服务端不支持 push_subscribe 时退回长轮询；断线重连后自动重新订阅并按游标补齐
     void startPolling();
     void stopPolling();
 
@@ -41,12 +46,17 @@ signals:
 
 private slots:
     void onJsonReceived(const QJsonObject& obj);
+    void onPushReceived(const QString& topic, const QJsonObject& data);
+    void onConnected();
 
 private:
+    void subscribePush();
     void scheduleNextPoll(int delayMs = 0);
     void doPoll();
     static QString convKey(const QString& doctorUser, const QString& patientUser);
     void mergeAscending(const QString& key, const QList<QJsonObject>& pageAsc, QList<QJsonObject>* deltaOut = nullptr);
+    // 将轮询/推送到达的新消息（可能跨多个会话）按会话并入缓存并发出 conversationUpserted
+    void mergeIncoming(const QJsonArray& messages);
 
     CommunicationClient* m_client = nullptr;
     QString m_currentUser;
@@ -54,6 +64,7 @@ private:
     bool m_polling {false};
     bool m_pollInFlight {false};
     qint64 m_pollCursor {0};
+    bool m_pushActive {false}; // 已订阅推送，不再发起轮询
     // 会话 -> 升序消息
     QMap<QString, QList<QJsonObject>> m_convMessages;
     // 会话 -> 最早 id（便于翻页）
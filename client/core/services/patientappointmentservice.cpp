@@ -8,6 +8,7 @@ PatientAppointmentService::PatientAppointmentService(CommunicationClient* shared
 {
     Q_ASSERT(m_client);
     connect(m_client, &CommunicationClient::jsonReceived, this, &PatientAppointmentService::onJsonReceived);
+    connect(m_client, &CommunicationClient::pushReceived, this, &PatientAppointmentService::onPushReceived);
 }
 
 void PatientAppointmentService::fetchAllDoctors()
@@ -59,18 +60,19 @@ void PatientAppointmentService::onJsonReceived(const QJsonObject& obj)
         else emit createFailed(obj.value("error").toString());
         return;
     }
-    
-    // 监听预约完成通知，自动刷新医生列表数据
-    if (type == "appointment_completed_notification") {
-        qDebug() << "[PatientAppointmentService] 收到预约完成通知，刷新医生数据";
-        
-        // 发出预约数量变化信号（预约完成意味着-1）
-        QString doctorUsername = obj.value("doctor_username").toString();
-        if (!doctorUsername.isEmpty()) {
-            emit appointmentCountChanged(doctorUsername, -1);
-        }
-        
-        fetchAllDoctors(); // 自动刷新医生排班信息
-        return;
+}
+
+void PatientAppointmentService::onPushReceived(const QString& topic, const QJsonObject& data)
+{
+    // 预约完成推送（服务端向所有已订阅推送的连接广播），自动刷新医生列表数据
+    if (topic != "appointment.completed") return;
+    qDebug() << "[PatientAppointmentService] 收到预约完成推送，刷新医生数据";
+
+    // 发出预约数量变化信号（预约完成意味着-1）
+    const QString doctorUsername = data.value("doctor_username").toString();
+    if (!doctorUsername.isEmpty()) {
+        emit appointmentCountChanged(doctorUsername, -1);
     }
+
+    fetchAllDoctors(); // 自动刷新医生排班信息
 }
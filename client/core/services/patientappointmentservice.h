@@ -36,6 +36,7 @@ signals:
 
 private slots:
     void onJsonReceived(const QJsonObject& obj);
+    void onPushReceived(const QString& topic, const QJsonObject& data);
 
 private:
     CommunicationClient* m_client = nullptr; // 非拥有
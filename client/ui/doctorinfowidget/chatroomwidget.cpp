@@ -188,6 +188,7 @@ ChatRoomWidget::ChatRoomWidget(const QString& doctorName, CommunicationClient* c
         const QIcon avatarIcon(":/icons/用户.svg");
         for (const auto &v : contacts) {
             const QString name = v.toObject().value("username").toString();
+            const int unread = v.toObject().value("unread").toInt();
             // 行项目
             auto *it = new QListWidgetItem();
             it->setText(name);                   // 逻辑上仍使用文本
@@ -226,14 +227,16 @@ ChatRoomWidget::ChatRoomWidget(const QString& doctorName, CommunicationClient* c
             badge->setFixedSize(22,22);
             badge->setAlignment(Qt::AlignCenter);
             badge->setStyleSheet("background: transparent;"); // 徽标背景透明
-            badge->hide();
+            // 初始未读数来自服务端会话摘要
+            if (unread > 0) badge->setText(QString::number(unread));
+            else badge->hide();
 
             hl->addWidget(av);
             hl->addLayout(textBox, 1);
             hl->addWidget(badge);
             row->setLayout(hl);
             row->setProperty("active", false); // 默认未选中
-            row->setProperty("unread", 0);
+            row->setProperty("unread", unread);
             row->setSizePolicy(QSizePolicy::Expanding, QSizePolicy::Fixed);
             m_convList->setItemWidget(it, row);
         }
@@ -277,6 +280,7 @@ void ChatRoomWidget::onPeerChanged() {
     m_list->clear();
     if (!item) { m_currentPeer.clear(); m_chat->stopPolling(); return; }
     m_currentPeer = item->text();
+    m_chat->markRead(m_currentPeer);
     // 先从本地消息管理器渲染（如有缓存）
     const auto cached = m_chat->messagesFor(m_doctor, m_currentPeer);
     for (const auto &o : cached) appendMessage(o);
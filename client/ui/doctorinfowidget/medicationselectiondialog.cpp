@@ -104,16 +104,17 @@ void MedicationSelectionDialog::onSearchTextChanged() {
 }
 
 void MedicationSelectionDialog::filterMedications() {
-    QString searchText = searchEdit_->text().toLower();
+    const QString searchText = searchEdit_->text().toCaseFolded();
+    if (searchText.isEmpty()) {
+        filteredMedications_ = medications_;
+        populateTable(filteredMedications_);
+        return;
+    }
     QJsonArray filtered;
     
-    for (const auto& med : medications_) {
-        QJsonObject medication = med.toObject();
-        QString name = medication.value("name").toString().toLower();
-        QString genericName = medication.value("generic_name").toString().toLower();
-        
-        if (searchText.isEmpty() || name.contains(searchText) || genericName.contains(searchText)) {
-            filtered.append(medication);
+    for (int i = 0; i < searchKeys_.size(); ++i) {
+        if (searchKeys_[i].contains(searchText)) {
+            filtered.append(medications_[i]);
         }
     }
     
@@ -144,6 +145,13 @@ void MedicationSelectionDialog::onMedicationResponse(const QJsonObject& response
     if (response.value("type").toString() == "medications_response") {
         if (response.value("success").toBool()) {
             medications_ = response.value("data").toArray();
+            searchKeys_.clear();
+            searchKeys_.reserve(medications_.size());
+            for (const auto& med : medications_) {
+                const QJsonObject medication = med.toObject();
+                searchKeys_.push_back((medication.value("name").toString() + QLatin1Char('\n')
+                                       + medication.value("generic_name").toString()).toCaseFolded());
+            }
             filterMedications();
         } else {
             QMessageBox::warning(this, tr("错误"), tr("获取药品列表失败"));
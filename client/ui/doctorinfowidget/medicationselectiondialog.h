@@ -4,6 +4,7 @@
 #include <QDialog>
 #include <QJsonObject>
 #include <QJsonArray>
+#include <QVector>
 
 class QTableWidget;
 class QLineEdit;
@@ -36,6 +37,7 @@ private:
     CommunicationClient* client_;
     QJsonArray medications_;
     QJsonArray filteredMedications_;
+    QVector<QString> searchKeys_; // 与 medications_ 同序，折叠后的 "name\ngeneric_name"，输入时无需逐条转换
     QJsonObject selectedMedication_;
     
     QTableWidget* medicationsTable_;
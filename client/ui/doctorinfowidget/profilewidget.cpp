@@ -18,6 +18,7 @@
 #include <QJsonObject>
 #include <QJsonArray>
 #include "core/network/communicationclient.h"
+#include "core/cache/imagecache.h"
 #include "core/network/protocol.h"
 #include "core/services/doctorprofileservice.h"
 
@@ -150,9 +151,8 @@ ProfileWidget::ProfileWidget(const QString& doctorName, CommunicationClient* cli
         parseWorkTitle(d.value("title").toString());
         const auto photoB64 = d.value("photo").toString();
         if (!photoB64.isEmpty()) {
-            photoBytes_ = QByteArray::fromBase64(photoB64.toUtf8());
-            QPixmap px; px.loadFromData(photoBytes_);
-            photoPreview_->setPixmap(px.scaled(photoPreview_->size(), Qt::KeepAspectRatio, Qt::SmoothTransformation));
+            photoBase64_ = photoB64;
+            photoPreview_->setPixmap(ImageCache::instance().fromBase64(photoBase64_, photoPreview_->size()));
         }
     });
     connect(service_, &DoctorProfileService::infoFailed, this, [this](const QString& msg){
@@ -195,9 +195,8 @@ void ProfileWidget::onChoosePhoto() {
     if (path.isEmpty()) return;
     QFile f(path);
     if (f.open(QIODevice::ReadOnly)) {
-        photoBytes_ = f.readAll();
-        QPixmap px; px.loadFromData(photoBytes_);
-        photoPreview_->setPixmap(px.scaled(photoPreview_->size(), Qt::KeepAspectRatio, Qt::SmoothTransformation));
+        photoBase64_ = QString::fromLatin1(f.readAll().toBase64());
+        photoPreview_->setPixmap(ImageCache::instance().fromBase64(photoBase64_, photoPreview_->size()));
     }
 }
 
@@ -214,8 +213,8 @@ void ProfileWidget::onSave() {
     data["consultation_fee"] = feeEdit_->value();
     data["max_patients_per_day"] = dailyLimitEdit_->value();
     // 照片：若已选择，随请求以 base64 发送（后端 BLOB 列 photo）
-    if (!photoBytes_.isEmpty()) {
-        data["photo"] = QString::fromUtf8(photoBytes_.toBase64());
+    if (!photoBase64_.isEmpty()) {
+        data["photo"] = photoBase64_;
     }
 
     service_->updateDoctorInfo(doctorName_, data);
@@ -43,7 +43,7 @@ private:
     QLineEdit* departmentEdit_ {nullptr};
     QTextEdit* bioEdit_ {nullptr}; // 映射到 specialization 字段
     QLabel* photoPreview_ {nullptr};
-    QByteArray photoBytes_;
+    QString photoBase64_; // 照片以 base64 原样保存，仅在需要时解码
     QTimeEdit* workStartEdit_ {nullptr};
     QTimeEdit* workEndEdit_ {nullptr};
     QDoubleSpinBox* feeEdit_ {nullptr}; // consultation_fee
@@ -1,5 +1,6 @@
 #include "doctorinfopage.h"
 #include "core/network/communicationclient.h"
+#include "core/cache/imagecache.h"
 #include <QApplication>
 #include <QScreen>
 #include <QJsonDocument>
@@ -279,11 +280,10 @@ void DoctorInfoPage::displayBasicInfo(const QJsonObject& doctorInfo)
     
     // 显示医生照片或默认图标
     if (doctorInfo.contains("photo") && !doctorInfo.value("photo").toString().isEmpty()) {
-        QString photoBase64 = doctorInfo.value("photo").toString();
-        QByteArray photoData = QByteArray::fromBase64(photoBase64.toUtf8());
-        QPixmap photo;
-        if (photo.loadFromData(photoData)) {
-            photoLabel->setPixmap(photo.scaled(100, 100, Qt::KeepAspectRatio, Qt::SmoothTransformation));
+        // 经 ImageCache 取图，重复进入页面时直接命中已缩放的图片
+        QPixmap photo = ImageCache::instance().fromBase64(doctorInfo.value("photo").toString(), QSize(100, 100));
+        if (!photo.isNull()) {
+            photoLabel->setPixmap(photo);
         } else {
             photoLabel->setText("👨‍⚕️");
         }
@@ -1,6 +1,7 @@
 #include "medicationpage.h"
 #include "core/network/communicationclient.h"
 #include "core/services/medicationservice.h"
+#include "core/cache/imagecache.h"
 #include <QVBoxLayout>
 #include <QHBoxLayout>
 #include <QHeaderView>
@@ -13,7 +14,8 @@
 #include <QPixmap>
 #include <QBuffer>
 #include <QApplication>
-#include <QFile>
+
+static const QSize kThumbSize(64, 64); // 图片列缩略图尺寸
 
 MedicationSearchPage::MedicationSearchPage(CommunicationClient *c, const QString &p, QWidget *parent)
     : BasePage(c,p,parent) {
@@ -72,6 +74,7 @@ MedicationSearchPage::MedicationSearchPage(CommunicationClient *c, const QString
     connect(m_searchBtn,&QPushButton::clicked,this,&MedicationSearchPage::onSearch);
     connect(m_searchEdit,&QLineEdit::returnPressed,this,&MedicationSearchPage::onSearch);
     connect(m_remoteBtn,&QPushButton::clicked,this,&MedicationSearchPage::remoteSearch);
+    connect(m_client,&CommunicationClient::blobReceived,this,&MedicationSearchPage::onBlobReceived);
 
     // 服务化
     m_service = new MedicationService(m_client, this);
@@ -120,6 +123,7 @@ void MedicationSearchPage::populateTable(const QJsonArray &arr){
         }
     } else { for(const auto &v: arr) rows.push_back(v.toObject()); }
     m_table->setRowCount(rows.size());
+    m_blobRowMap.clear();
     int row=0; for(const auto &o: rows){
         auto setText=[&](int col,const QString &text){ auto *item=new QTableWidgetItem(text); m_table->setItem(row,col,item); };
         setText(0, QString::number(o.value("id").toInt()));
@@ -137,14 +141,19 @@ void MedicationSearchPage::populateTable(const QJsonArray &arr){
         setText(12, o.value("unit").toString());
         // 图片列: 异步获取占位
         QLabel *imgLabel = new QLabel; imgLabel->setFixedSize(64,64); imgLabel->setScaledContents(true);
-        QString localPath = o.value("image_path").toString();
-        if(!localPath.isEmpty() && QFile::exists(localPath)){
-            QPixmap pix(localPath);
-            if(!pix.isNull()) { imgLabel->setPixmap(pix.scaled(64,64,Qt::KeepAspectRatio, Qt::SmoothTransformation)); }
-            else { imgLabel->setText("图"); }
+        const QString imageHash = o.value("image_hash").toString();
+        if(!imageHash.isEmpty()){
+            // 按内容哈希取图：内存/磁盘缓存命中则不再下载、解码与缩放
+            QPixmap pix = ImageCache::instance().load(imageHash, kThumbSize);
+            if(!pix.isNull()) { imgLabel->setPixmap(pix); }
+            else {
+                imgLabel->setText("...");
+                m_blobRowMap.insert(imageHash, row);
+                m_client->fetchBlob(imageHash);
+            }
         } else if(o.contains("image_base64")) {
-            QByteArray raw = QByteArray::fromBase64(o.value("image_base64").toString().toLatin1());
-            QPixmap pix; if(pix.loadFromData(raw)) imgLabel->setPixmap(pix.scaled(64,64,Qt::KeepAspectRatio, Qt::SmoothTransformation)); else imgLabel->setText("图");
+            QPixmap pix = ImageCache::instance().fromBase64(o.value("image_base64").toString(), kThumbSize);
+            if(!pix.isNull()) imgLabel->setPixmap(pix); else imgLabel->setText("图");
         } else {
             imgLabel->setText("...");
             fetchImageForRow(row, o.value("name").toString());
@@ -179,3 +188,15 @@ void MedicationSearchPage::onImageDownloaded(){
         }
     }
 }
+
+void MedicationSearchPage::onBlobReceived(const QString &hash, const QByteArray &bytes){
+    const QList<int> rows = m_blobRowMap.values(hash);
+    if(rows.isEmpty()) return; // 其他页面请求的 blob
+    m_blobRowMap.remove(hash);
+    const QPixmap pix = ImageCache::instance().store(hash, bytes, kThumbSize);
+    if(pix.isNull()) { qWarning() << "[ MedicationSearchPage ] 图片解码失败 hash=" << hash; return; }
+    for(int row : rows){
+        if(row < 0 || row >= m_table->rowCount()) continue;
+        if(QLabel *lbl = qobject_cast<QLabel*>(m_table->cellWidget(row,13))) lbl->setPixmap(pix);
+    }
+}
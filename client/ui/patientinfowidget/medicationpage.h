@@ -7,6 +7,7 @@
 #include <QPushButton>
 #include <QNetworkReply>
 #include <QHash>
+#include <QMultiHash>
 
 class MedicationSearchPage : public BasePage {
     Q_OBJECT
@@ -16,12 +17,14 @@ public:
 private slots:
     void onSearch();
     void onImageDownloaded();
+    void onBlobReceived(const QString &hash, const QByteArray &bytes);
 private:
     QLineEdit *m_searchEdit;
     QPushButton *m_searchBtn;
     QPushButton *m_remoteBtn;
     QTableWidget *m_table;
     QHash<QNetworkReply*, int> m_replyRowMap; // reply -> row index
+    QMultiHash<QString, int> m_blobRowMap;    // image_hash -> 等待该图片的行
     void sendSearchRequest(const QString &keyword);
     void populateTable(const QJsonArray &arr);
     void fetchImageForRow(int row, const QString &medName);
@@ -1,4 +1,7 @@
 #include "database.h"
+#include "dbpool.h"
+#include "database_config.h"
+#include "schemamigrator.h"
 #include <QSqlQuery>
 #include <QSqlError>
 #include <QDebug>
@@ -8,17 +11,27 @@
 #include <QJsonDocument>
 #include <QTimer>
 #include <QCoreApplication>
+#include <QAtomicInt>
+#include <QAtomicInteger>
+#include <limits>
 
-DBManager::DBManager(const QString& path) {
-    // 检查可用的SQL驱动
-    qDebug() << "可用的SQL驱动:" << QSqlDatabase::drivers();
-    
-    // 使用唯一的连接名称，避免与TcpServer冲突
-    static int connectionId = 0;
-    QString connectionName = QString("main_db_connection_%1").arg(++connectionId);
+namespace {
+// 语句缓存命中统计（所有连接累计）
+QAtomicInteger<quint64> g_statementHits(0);
+QAtomicInteger<quint64> g_statementMisses(0);
+}
+
+DBManager::DBManager(const QString& path, OpenMode mode)
+    : m_mode(mode), m_statements(static_cast<int>(Stmt::Count), nullptr) {
+    // 使用唯一的连接名称，避免与TcpServer冲突（连接池会在多个线程中创建连接）
+    static QAtomicInt connectionId(0);
+    QString connectionName = QString("main_db_connection_%1").arg(connectionId.fetchAndAddOrdered(1) + 1);
     
     m_db = QSqlDatabase::addDatabase("QSQLITE", connectionName);
     m_db.setDatabaseName(path);
+    // 池化连接只读：写入统一交给 DBWriteQueue 的写连接
+    m_db.setConnectOptions(m_mode == OpenMode::Pooled ? DatabaseConfig::getReadOnlyConnectOptions()
+                                                      : DatabaseConfig::getConnectOptions());
     
     qDebug() << "数据库驱动名称:" << m_db.driverName();
     qDebug() << "数据库文件路径:" << path;
@@ -27,18 +40,37 @@ DBManager::DBManager(const QString& path) {
         qDebug() << "Error: connection with database fail" << m_db.lastError().text();
     } else {
         qDebug() << "Database: connection ok";
+        applyPragmas();
+    }
+    if (m_mode == OpenMode::Bootstrap) {
+        // 检查可用的SQL驱动
+        qDebug() << "可用的SQL驱动:" << QSqlDatabase::drivers();
+        m_schemaReady = m_db.isOpen() && initDatabase();
     }
-    initDatabase();
 }
 
 DBManager::~DBManager() {
     const QString connectionName = m_db.connectionName();
+    if (m_statementHits + m_statementMisses > 0) {
+        qDebug().noquote() << QString("[DBManager] 连接 %1 语句缓存 命中=%2 未命中=%3")
+                                  .arg(connectionName).arg(m_statementHits).arg(m_statementMisses);
+    }
+    // 缓存的语句须先于连接关闭释放
+    qDeleteAll(m_statements);
+    m_statements.clear();
     if (m_db.isOpen()) {
         m_db.close();
     }
     // 释放该连接的最后一个句柄
     m_db = QSqlDatabase();
 
+    if (m_mode != OpenMode::Bootstrap) {
+        // 池化连接与写连接随所属线程结束而销毁，此时已无查询在使用，可直接移除
+        QSqlDatabase::removeDatabase(connectionName);
+        if (m_mode == OpenMode::Pooled) DBConnectionPool::instance().connectionClosed();
+        return;
+    }
+
     // 如果有事件循环，延后到本轮事件循环结束再移除连接，
     // 可避免析构顺序导致的 "still in use" 警告。
     if (QCoreApplication::instance()) {
@@ -51,67 +83,338 @@ DBManager::~DBManager() {
     }
 }
 
-void DBManager::initDatabase() {
-    createUsersTable();
-    createDoctorsTable();
-    createPatientsTable();
-    createAppointmentsTable();
-    createMedicalRecordsTable();
-    createMedicalAdvicesTable();
-    createPrescriptionsTable();
-    createPrescriptionItemsTable();
-    createMedicationsTable();
-    createDoctorSchedulesTable();
-    createHospitalizationsTable(); // 添加住院表
-    createAttendanceTable();
-    createLeaveRequestsTable();
-    createChatMessagesTable();
-    
-    // 创建数据库触发器来维护预约统计
-    createAppointmentTriggers();
+DBManager::StatementCacheStats DBManager::statementCacheStats() {
+    StatementCacheStats stats;
+    stats.hits = g_statementHits.loadRelaxed();
+    stats.misses = g_statementMisses.loadRelaxed();
+    return stats;
+}
+
+DBManager::StatementRef DBManager::statement(Stmt id, const char* sql) {
+    CachedStatement*& cached = m_statements[static_cast<int>(id)];
+    if (cached && !cached->busy) {
+        ++m_statementHits;
+        g_statementHits.fetchAndAddRelaxed(1);
+        cached->busy = true;
+        return StatementRef(cached, nullptr);
+    }
+    ++m_statementMisses;
+    g_statementMisses.fetchAndAddRelaxed(1);
+    if (!cached) {
+        auto* entry = new CachedStatement{QSqlQuery(m_db)};
+        entry->query.setForwardOnly(true);
+        if (entry->query.prepare(QString::fromUtf8(sql))) {
+            cached = entry;
+            cached->busy = true;
+            return StatementRef(cached, nullptr);
+        }
+        // 准备失败不缓存，交给调用方按一次性语句执行并报告错误
+        delete entry;
+    }
+    auto* transient = new QSqlQuery(m_db);
+    transient->setForwardOnly(true);
+    transient->prepare(QString::fromUtf8(sql));
+    return StatementRef(nullptr, transient);
+}
+
+DBManager::StatementRef::~StatementRef() {
+    if (m_cached) {
+        m_cached->query.finish();
+        m_cached->busy = false;
+    }
+    delete m_transient;
+}
+
+void DBManager::applyPragmas() {
+    QSqlQuery q(m_db);
+    if (m_mode == OpenMode::Bootstrap) {
+        // journal_mode 持久化在数据库文件中，切换一次后所有连接均为 WAL：读者读快照，不再与写事务互斥
+        if (!q.exec(QStringLiteral("PRAGMA journal_mode=WAL")) || !q.next()
+            || q.value(0).toString().compare(QStringLiteral("wal"), Qt::CaseInsensitive) != 0) {
+            qWarning() << "切换 WAL 日志模式失败:" << q.lastError().text();
+        }
+    }
+    for (const QString& pragma : DatabaseConfig::getConnectionPragmas()) {
+        if (!q.exec(pragma)) {
+            qWarning() << "执行" << pragma << "失败:" << q.lastError().text();
+        }
+    }
+}
+
+bool DBManager::beginTransaction() {
+    QSqlQuery q(m_db);
+    if (m_inBatch) {
+        return q.exec(QStringLiteral("SAVEPOINT db_txn"));
+    }
+    // 立即取得写锁：WAL 下延迟事务在读后升级为写时可能因快照过期直接失败，无法靠忙等重试
+    return q.exec(QStringLiteral("BEGIN IMMEDIATE"));
+}
+
+bool DBManager::commitTransaction() {
+    if (m_inBatch) {
+        QSqlQuery q(m_db);
+        return q.exec(QStringLiteral("RELEASE db_txn"));
+    }
+    return m_db.commit();
+}
+
+void DBManager::rollbackTransaction() {
+    if (m_inBatch) {
+        QSqlQuery q(m_db);
+        q.exec(QStringLiteral("ROLLBACK TO db_txn"));
+        q.exec(QStringLiteral("RELEASE db_txn"));
+        return;
+    }
+    m_db.rollback();
+}
+
+bool DBManager::initDatabase() {
+    // 表结构按版本迁移，只补齐尚未应用的步骤；已是最新版本时只读一次 schema_version
+    const QList<SchemaMigrator::Step> steps{
+        {1, QStringLiteral("基础业务表"), [this] {
+             return createUsersTable() && createDoctorsTable() && createPatientsTable()
+                 && createAppointmentsTable() && createMedicalRecordsTable() && createMedicalAdvicesTable()
+                 && createPrescriptionsTable() && createPrescriptionItemsTable() && createMedicationsTable()
+                 && createDoctorSchedulesTable() && createHospitalizationsTable()
+                 && createAttendanceTable() && createLeaveRequestsTable();
+         }},
+        {2, QStringLiteral("doctors 表补充 photo 列"), [this] { return addDoctorPhotoColumn(); }},
+        {3, QStringLiteral("预约统计缓存表，清理旧触发器"), [this] { return createAppointmentStatsCache(); }},
+        {4, QStringLiteral("聊天消息、收件索引与会话摘要"), [this] {
+             return createChatMessagesTable() && createChatInboxTables();
+         }},
+        {5, QStringLiteral("文件对象与患者钱包"), [this] {
+             return createFileObjectsTable() && createPatientWalletsTable();
+         }},
+        {6, QStringLiteral("预约/病历/处方/住院常用查询索引"), [this] { return createQueryIndexes(); }},
+        {7, QStringLiteral("按医生/日期/状态的预约计数及维护触发器"), [this] { return createAppointmentCounters(); }},
+        {8, QStringLiteral("上传文件名到内容哈希的映射"), [this] { return createFileNamesTable(); }},
+    };
+    // 必须迁移到最后一步：半迁移的表结构（如缺少 appointment_counters）会让挂号与排班统计出错
+    const int target = steps.last().version;
+    const int reached = SchemaMigrator::migrate(m_db, steps);
+    if (reached < target) {
+        qWarning() << "表结构迁移未完成，当前版本" << reached << "目标版本" << target;
+        return false;
+    }
     
     // 不插入示例数据，使用现有数据库中的数据
+    return true;
 }
 
-void DBManager::createChatMessagesTable() {
-    if (!m_db.tables().contains(QStringLiteral("chat_messages"))) {
-        QSqlQuery q(m_db);
-        const char *sql = R"(
-            CREATE TABLE chat_messages (
-                id INTEGER PRIMARY KEY AUTOINCREMENT,
-                doctor_username  TEXT NOT NULL,
-                patient_username TEXT NOT NULL,
-                message_id       TEXT NOT NULL UNIQUE,
-                sender_username  TEXT NOT NULL,
-                message_type     TEXT NOT NULL CHECK(message_type IN ('text','image','file')),
-                text_content     TEXT,
-                file_metadata    TEXT,
-                created_at       DATETIME DEFAULT CURRENT_TIMESTAMP,
-                FOREIGN KEY (doctor_username)  REFERENCES users(username),
-                FOREIGN KEY (patient_username) REFERENCES users(username),
-                FOREIGN KEY (sender_username)  REFERENCES users(username)
-            )
-        )";
-        if (!q.exec(sql)) {
-            qDebug() << "创建chat_messages表失败:" << q.lastError().text();
-        } else {
-            QSqlQuery idx(m_db);
-            idx.exec("CREATE INDEX IF NOT EXISTS idx_chat_pair ON chat_messages(doctor_username, patient_username)");
-            idx.exec("CREATE INDEX IF NOT EXISTS idx_chat_pair_id ON chat_messages(doctor_username, patient_username, id DESC)");
-            idx.exec("CREATE INDEX IF NOT EXISTS idx_chat_sender ON chat_messages(sender_username, id DESC)");
-        }
+bool DBManager::createChatMessagesTable() {
+    QSqlQuery q(m_db);
+    const char *sql = R"(
+        CREATE TABLE IF NOT EXISTS chat_messages (
+            id INTEGER PRIMARY KEY AUTOINCREMENT,
+            doctor_username  TEXT NOT NULL,
+            patient_username TEXT NOT NULL,
+            message_id       TEXT NOT NULL UNIQUE,
+            sender_username  TEXT NOT NULL,
+            message_type     TEXT NOT NULL CHECK(message_type IN ('text','image','file')),
+            text_content     TEXT,
+            file_metadata    TEXT,
+            created_at       DATETIME DEFAULT CURRENT_TIMESTAMP,
+            FOREIGN KEY (doctor_username)  REFERENCES users(username),
+            FOREIGN KEY (patient_username) REFERENCES users(username),
+            FOREIGN KEY (sender_username)  REFERENCES users(username)
+        )
+    )";
+    if (!q.exec(sql)) {
+        qDebug() << "创建chat_messages表失败:" << q.lastError().text();
+        return false;
+    }
+    return execSchema({
+        "CREATE INDEX IF NOT EXISTS idx_chat_pair ON chat_messages(doctor_username, patient_username)",
+        "CREATE INDEX IF NOT EXISTS idx_chat_pair_id ON chat_messages(doctor_username, patient_username, id DESC)",
+        "CREATE INDEX IF NOT EXISTS idx_chat_sender ON chat_messages(sender_username, id DESC)",
+    });
+}
+
+bool DBManager::createChatInboxTables() {
+    // chat_inbox：每条消息为每个参与者（医生、患者、发送者）各记一行，主键 (username, message_id) 即按用户的游标索引；
+    // chat_conversations：每个用户与每个对端一行，记录最新消息 id 与未读数。两表在 addChatMessage 的同一事务中维护
+    // 两表由已有消息回填，已有会话视为已读（INSERT OR IGNORE：重复执行不影响已存在的行）
+    return execSchema({
+        R"(
+            CREATE TABLE IF NOT EXISTS chat_inbox (
+                username   TEXT NOT NULL,
+                message_id INTEGER NOT NULL,
+                PRIMARY KEY (username, message_id)
+            ) WITHOUT ROWID
+        )",
+        R"(
+            INSERT OR IGNORE INTO chat_inbox (username, message_id)
+            SELECT doctor_username, id FROM chat_messages
+            UNION ALL SELECT patient_username, id FROM chat_messages
+            UNION ALL SELECT sender_username, id FROM chat_messages
+        )",
+        R"(
+            CREATE TABLE IF NOT EXISTS chat_conversations (
+                username TEXT NOT NULL,
+                peer     TEXT NOT NULL,
+                last_id  INTEGER NOT NULL,
+                unread   INTEGER NOT NULL DEFAULT 0,
+                PRIMARY KEY (username, peer)
+            ) WITHOUT ROWID
+        )",
+        "CREATE INDEX IF NOT EXISTS idx_chat_conv_recent ON chat_conversations(username, last_id DESC)",
+        R"(
+            INSERT OR IGNORE INTO chat_conversations (username, peer, last_id, unread)
+            SELECT u, peer, MAX(id), 0 FROM (
+                SELECT doctor_username AS u, patient_username AS peer, id FROM chat_messages
+                UNION ALL
+                SELECT patient_username, doctor_username, id FROM chat_messages
+            ) GROUP BY u, peer
+        )",
+    });
+}
+
+bool DBManager::createFileObjectsTable() {
+    QSqlQuery q(m_db);
+    const char *sql = R"(
+        CREATE TABLE IF NOT EXISTS file_objects (
+            hash       TEXT PRIMARY KEY,
+            size       INTEGER NOT NULL,
+            refcount   INTEGER NOT NULL DEFAULT 0,
+            created_at DATETIME DEFAULT CURRENT_TIMESTAMP
+        )
+    )";
+    if (!q.exec(sql)) {
+        qDebug() << "创建file_objects表失败:" << q.lastError().text();
+        return false;
+    }
+    return true;
+}
+
+bool DBManager::registerFileObject(const QString &hash, qint64 size) {
+    auto qStmt = statement(Stmt::RegisterFileObject, "INSERT OR IGNORE INTO file_objects (hash, size, refcount) VALUES (:h, :s, 0)");
+    QSqlQuery &q = *qStmt;
+    q.bindValue(":h", hash);
+    q.bindValue(":s", size);
+    if (!q.exec()) {
+        qDebug() << "登记文件对象失败:" << q.lastError().text();
+        return false;
+    }
+    return true;
+}
+
+bool DBManager::createFileNamesTable() {
+    // 上传内容只按哈希存放在 FileStore，按名下载需先把文件名解析为哈希
+    return execSchema({R"(
+        CREATE TABLE IF NOT EXISTS file_names (
+            name       TEXT PRIMARY KEY,
+            hash       TEXT NOT NULL,
+            updated_at DATETIME DEFAULT CURRENT_TIMESTAMP
+        )
+    )"});
+}
+
+bool DBManager::registerFileName(const QString &name, const QString &hash) {
+    auto qStmt = statement(Stmt::RegisterFileName, "INSERT INTO file_names (name, hash) VALUES (:n, :h) "
+              "ON CONFLICT(name) DO UPDATE SET hash = excluded.hash, updated_at = CURRENT_TIMESTAMP");
+    QSqlQuery &q = *qStmt;
+    q.bindValue(":n", name);
+    q.bindValue(":h", hash);
+    if (!q.exec()) {
+        qDebug() << "登记文件名失败:" << q.lastError().text();
+        return false;
+    }
+    return true;
+}
+
+bool DBManager::getFileHashByName(const QString &name, QString &hash) {
+    auto qStmt = statement(Stmt::GetFileHashByName, "SELECT hash FROM file_names WHERE name = :n");
+    QSqlQuery &q = *qStmt;
+    q.bindValue(":n", name);
+    if (!q.exec() || !q.next()) return false;
+    hash = q.value(0).toString();
+    return true;
+}
+
+bool DBManager::createPatientWalletsTable() {
+    // 原由 EvaluateModule 在每次请求时自建；只读连接无法建表，改为启动时创建
+    return execSchema({R"(
+        CREATE TABLE IF NOT EXISTS patient_wallets (
+            patient_username TEXT PRIMARY KEY,
+            balance REAL DEFAULT 0,
+            updated_at DATETIME DEFAULT CURRENT_TIMESTAMP
+        )
+    )"});
+}
+
+bool DBManager::getWalletBalance(const QString &patientUsername, double &balance) {
+    auto qStmt = statement(Stmt::GetWalletBalance, "SELECT balance FROM patient_wallets WHERE patient_username = :p");
+    QSqlQuery &q = *qStmt;
+    q.bindValue(":p", patientUsername);
+    if (!q.exec()) {
+        qDebug() << "查询钱包余额失败:" << q.lastError().text();
+        return false;
+    }
+    balance = q.next() ? q.value(0).toDouble() : 0.0;
+    return true;
+}
+
+bool DBManager::adjustWalletBalance(const QString &patientUsername, double delta, double &newBalance, QString &errorMessage) {
+    // 单条 UPSERT 完成“不存在则建户”与加减余额，无需先读后写
+    auto qStmt = statement(Stmt::AdjustWalletBalance, "INSERT INTO patient_wallets (patient_username, balance) VALUES (:p, :d) "
+              "ON CONFLICT(patient_username) DO UPDATE SET balance = balance + excluded.balance, "
+              "updated_at = CURRENT_TIMESTAMP");
+    QSqlQuery &q = *qStmt;
+    q.bindValue(":p", patientUsername);
+    q.bindValue(":d", delta);
+    if (!q.exec()) {
+        errorMessage = q.lastError().text();
+        return false;
     }
+    return getWalletBalance(patientUsername, newBalance);
+}
+
+bool DBManager::getFileObject(const QString &hash, QJsonObject &out) {
+    auto qStmt = statement(Stmt::GetFileObject, "SELECT hash, size, refcount, created_at FROM file_objects WHERE hash = :h");
+    QSqlQuery &q = *qStmt;
+    q.bindValue(":h", hash);
+    if (!q.exec() || !q.next()) return false;
+    out = QJsonObject{{"hash", q.value("hash").toString()},
+                      {"size", q.value("size").toLongLong()},
+                      {"refcount", q.value("refcount").toInt()},
+                      {"created_at", q.value("created_at").toString()}};
+    return true;
 }
 
 bool DBManager::addChatMessage(const QJsonObject &msg, int &insertedId, QString &errorMessage) {
+    // 消息、参与者收件索引、会话摘要（及 file_metadata 携带内容哈希时的文件对象引用计数）在同一事务内写入
+    if (!beginTransaction()) {
+        errorMessage = m_db.lastError().text();
+        return false;
+    }
+    if (!insertChatMessage(msg, insertedId, errorMessage)) {
+        rollbackTransaction();
+        return false;
+    }
+    if (!commitTransaction()) {
+        errorMessage = m_db.lastError().text();
+        rollbackTransaction();
+        return false;
+    }
+    return true;
+}
+
+bool DBManager::insertChatMessage(const QJsonObject &msg, int &insertedId, QString &errorMessage) {
     // 期望字段：doctor_username, patient_username, message_id, sender_username, message_type, text_content(可空), file_metadata(可空)
-    QSqlQuery q(m_db);
-    q.prepare(R"(
+    // file_metadata 携带内容哈希时同时为文件对象引用计数 +1；出错时由调用方回滚整个事务
+    const QString fileHash = msg.value("file_metadata").toObject().value("hash").toString();
+    auto fail = [&](const QSqlQuery &failed) {
+        errorMessage = failed.lastError().text();
+        return false;
+    };
+    auto qStmt = statement(Stmt::InsertChatMessage, R"(
         INSERT INTO chat_messages (
             doctor_username, patient_username, message_id, sender_username,
             message_type, text_content, file_metadata
         ) VALUES (:d, :p, :mid, :s, :t, :text, :file)
     )");
+    QSqlQuery &q = *qStmt;
     q.bindValue(":d", msg.value("doctor_username").toString());
     q.bindValue(":p", msg.value("patient_username").toString());
     q.bindValue(":mid", msg.value("message_id").toString());
@@ -126,29 +429,60 @@ bool DBManager::addChatMessage(const QJsonObject &msg, int &insertedId, QString
     } else {
         q.bindValue(":file", QVariant(QVariant::String));
     }
-    if (!q.exec()) {
-        errorMessage = q.lastError().text();
-        return false;
-    }
+    if (!q.exec()) return fail(q);
     insertedId = q.lastInsertId().toInt();
+    if (!fileHash.isEmpty()) {
+        auto refStmt = statement(Stmt::AddFileObjectRef, "UPDATE file_objects SET refcount = refcount + 1 WHERE hash = :h");
+        QSqlQuery &ref = *refStmt;
+        ref.bindValue(":h", fileHash);
+        if (!ref.exec()) return fail(ref);
+        if (ref.numRowsAffected() == 0) {
+            errorMessage = QStringLiteral("file not uploaded");
+            return false;
+        }
+    }
+    const QString doctor = msg.value("doctor_username").toString();
+    const QString patient = msg.value("patient_username").toString();
+    const QString sender = msg.value("sender_username").toString();
+    auto inboxStmt = statement(Stmt::InsertChatInbox, "INSERT OR IGNORE INTO chat_inbox (username, message_id) VALUES (:u, :id)");
+    QSqlQuery &inbox = *inboxStmt;
+    for (const QString &user : {doctor, patient, sender}) {
+        inbox.bindValue(":u", user);
+        inbox.bindValue(":id", insertedId);
+        if (!inbox.exec()) return fail(inbox);
+    }
+    // 会话摘要：双方各一行，接收方未读数 +1
+    auto convStmt = statement(Stmt::UpsertChatConversation, R"(
+        INSERT INTO chat_conversations (username, peer, last_id, unread) VALUES (:u, :peer, :id, :unread)
+        ON CONFLICT(username, peer) DO UPDATE SET last_id = excluded.last_id, unread = unread + excluded.unread
+    )");
+    QSqlQuery &conv = *convStmt;
+    auto touchConversation = [&](const QString &user, const QString &peer) {
+        conv.bindValue(":u", user);
+        conv.bindValue(":peer", peer);
+        conv.bindValue(":id", insertedId);
+        conv.bindValue(":unread", user == sender ? 0 : 1);
+        return conv.exec();
+    };
+    if (!touchConversation(doctor, patient)) return fail(conv);
+    if (patient != doctor && !touchConversation(patient, doctor)) return fail(conv);
     return true;
 }
 
 bool DBManager::getChatHistory(const QString &doctorUsername, const QString &patientUsername,
                                qint64 beforeId, int limit, QJsonArray &out) {
-    QSqlQuery q(m_db);
-    QString sql = R"(
+    // beforeId <= 0 表示从最新一条开始：统一成一条语句，避免按条件拼接出多个 SQL 变体
+    auto qStmt = statement(Stmt::GetChatHistory, R"(
         SELECT id, doctor_username, patient_username, message_id, sender_username,
                message_type, text_content, file_metadata, created_at
         FROM chat_messages
-        WHERE doctor_username = :d AND patient_username = :p
-    )";
-    if (beforeId > 0) sql += " AND id < :before";
-    sql += " ORDER BY id DESC LIMIT :limit";
-    q.prepare(sql);
+        WHERE doctor_username = :d AND patient_username = :p AND id < :before
+        ORDER BY id DESC LIMIT :limit
+    )");
+    QSqlQuery &q = *qStmt;
     q.bindValue(":d", doctorUsername);
     q.bindValue(":p", patientUsername);
-    if (beforeId > 0) q.bindValue(":before", beforeId);
+    q.bindValue(":before", beforeId > 0 ? beforeId : std::numeric_limits<qint64>::max());
     q.bindValue(":limit", qMax(1, limit));
     if (!q.exec()) { qDebug() << "getChatHistory error:" << q.lastError().text(); return false; }
     while (q.next()) {
@@ -172,18 +506,18 @@ bool DBManager::getChatHistory(const QString &doctorUsername, const QString &pat
 }
 
 bool DBManager::getMessagesSinceForUser(const QString &username, qint64 cursor, int limit, QJsonArray &out) {
-    // 返回与该用户相关（作为医生、患者、或发送者）且 id>cursor 的消息
-    QSqlQuery q(m_db);
-    q.prepare(R"(
-        SELECT id, doctor_username, patient_username, message_id, sender_username,
-               message_type, text_content, file_metadata, created_at
-        FROM chat_messages
-        WHERE id > :cursor AND (
-            doctor_username = :u OR patient_username = :u OR sender_username = :u
-        )
-        ORDER BY id ASC
+    // 返回与该用户相关（作为医生、患者、或发送者）且 id>cursor 的消息：
+    // 沿 chat_inbox 主键 (username, message_id) 做范围扫描，代价只与新消息数有关
+    auto qStmt = statement(Stmt::GetMessagesSince, R"(
+        SELECT m.id, m.doctor_username, m.patient_username, m.message_id, m.sender_username,
+               m.message_type, m.text_content, m.file_metadata, m.created_at
+        FROM chat_inbox i
+        JOIN chat_messages m ON m.id = i.message_id
+        WHERE i.username = :u AND i.message_id > :cursor
+        ORDER BY i.message_id ASC
         LIMIT :limit
     )");
+    QSqlQuery &q = *qStmt;
     q.bindValue(":cursor", cursor);
     q.bindValue(":u", username);
     q.bindValue(":limit", qMax(1, limit));
@@ -209,406 +543,406 @@ bool DBManager::getMessagesSinceForUser(const QString &username, qint64 cursor,
 }
 
 bool DBManager::getRecentContactsForUser(const QString &username, int limit, QJsonArray &out) {
-    // 查找最近出现于该用户相关消息中的对端用户名（医生或患者），按最近消息时间倒序，去重
-    // 通过 UNION 取医生视角与患者视角，再按 max(id) 排序
-    QSqlQuery q(m_db);
-    q.prepare(R"(
-        SELECT peer, MAX(id) AS last_id
-        FROM (
-            SELECT CASE WHEN sender_username = :u THEN
-                        CASE WHEN doctor_username = :u THEN patient_username ELSE doctor_username END
-                    ELSE
-                        CASE WHEN doctor_username = :u THEN patient_username ELSE doctor_username END
-                END AS peer,
-                id
-            FROM chat_messages
-            WHERE doctor_username = :u OR patient_username = :u OR sender_username = :u
-        ) t
-        GROUP BY peer
+    // 会话摘要表按 (username, last_id DESC) 索引，直接取最近的 limit 个对端
+    auto qStmt = statement(Stmt::GetRecentContacts, R"(
+        SELECT peer, last_id, unread
+        FROM chat_conversations
+        WHERE username = :u
         ORDER BY last_id DESC
         LIMIT :limit
     )");
+    QSqlQuery &q = *qStmt;
     q.bindValue(":u", username);
     q.bindValue(":limit", qMax(1, limit));
     if (!q.exec()) { qDebug() << "getRecentContactsForUser error:" << q.lastError().text(); return false; }
     while (q.next()) {
-        QJsonObject o; o["username"] = q.value(0).toString(); o["last_id"] = q.value(1).toInt();
+        QJsonObject o;
+        o["username"] = q.value(0).toString();
+        o["last_id"] = q.value(1).toInt();
+        o["unread"] = q.value(2).toInt();
         out.append(o);
     }
     return true;
 }
 
-void DBManager::createUsersTable() {
-    if (!m_db.tables().contains(QStringLiteral("users"))) {
-        QSqlQuery query(m_db);
-        QString sql = R"(
-            CREATE TABLE users (
-                id INTEGER PRIMARY KEY AUTOINCREMENT,
-                username TEXT UNIQUE NOT NULL,
-                password TEXT NOT NULL,
-                role TEXT NOT NULL CHECK(role IN ('doctor', 'patient')),
-                created_at DATETIME DEFAULT CURRENT_TIMESTAMP,
-                updated_at DATETIME DEFAULT CURRENT_TIMESTAMP
-            )
-        )";
-        if (!query.exec(sql)) {
-            qDebug() << "创建users表失败:" << query.lastError().text();
-        }
+bool DBManager::markConversationRead(const QString &username, const QString &peer) {
+    auto qStmt = statement(Stmt::MarkConversationRead, "UPDATE chat_conversations SET unread = 0 WHERE username = :u AND peer = :p");
+    QSqlQuery &q = *qStmt;
+    q.bindValue(":u", username);
+    q.bindValue(":p", peer);
+    if (!q.exec()) { qDebug() << "markConversationRead error:" << q.lastError().text(); return false; }
+    return true;
+}
+
+bool DBManager::createUsersTable() {
+    QSqlQuery query(m_db);
+    QString sql = R"(
+        CREATE TABLE IF NOT EXISTS users (
+            id INTEGER PRIMARY KEY AUTOINCREMENT,
+            username TEXT UNIQUE NOT NULL,
+            password TEXT NOT NULL,
+            role TEXT NOT NULL CHECK(role IN ('doctor', 'patient')),
+            created_at DATETIME DEFAULT CURRENT_TIMESTAMP,
+            updated_at DATETIME DEFAULT CURRENT_TIMESTAMP
+        )
+    )";
+    if (!query.exec(sql)) {
+        qDebug() << "创建users表失败:" << query.lastError().text();
+        return false;
     }
+    return true;
 }
 
-void DBManager::createDoctorsTable() {
-    if (!m_db.tables().contains(QStringLiteral("doctors"))) {
-        QSqlQuery query(m_db);
-        QString sql = R"(
-            CREATE TABLE doctors (
-                id INTEGER PRIMARY KEY AUTOINCREMENT,
-                username TEXT UNIQUE NOT NULL,
-                name TEXT NOT NULL,
-                department TEXT,
-                phone TEXT,
-                email TEXT,
-                work_number TEXT,
-                title TEXT,
-                specialization TEXT,
-                consultation_fee DECIMAL(10,2) DEFAULT 0.00,
-                max_patients_per_day INTEGER DEFAULT 20,
-                photo BLOB,
-                created_at DATETIME DEFAULT CURRENT_TIMESTAMP,
-                updated_at DATETIME DEFAULT CURRENT_TIMESTAMP,
-                FOREIGN KEY (username) REFERENCES users(username)
-            )
-        )";
-        if (!query.exec(sql)) {
-            qDebug() << "创建doctors表失败:" << query.lastError().text();
-        }
+bool DBManager::createDoctorsTable() {
+    QSqlQuery query(m_db);
+    QString sql = R"(
+        CREATE TABLE IF NOT EXISTS doctors (
+            id INTEGER PRIMARY KEY AUTOINCREMENT,
+            username TEXT UNIQUE NOT NULL,
+            name TEXT NOT NULL,
+            department TEXT,
+            phone TEXT,
+            email TEXT,
+            work_number TEXT,
+            title TEXT,
+            specialization TEXT,
+            consultation_fee DECIMAL(10,2) DEFAULT 0.00,
+            max_patients_per_day INTEGER DEFAULT 20,
+            photo BLOB,
+            created_at DATETIME DEFAULT CURRENT_TIMESTAMP,
+            updated_at DATETIME DEFAULT CURRENT_TIMESTAMP,
+            FOREIGN KEY (username) REFERENCES users(username)
+        )
+    )";
+    if (!query.exec(sql)) {
+        qDebug() << "创建doctors表失败:" << query.lastError().text();
+        return false;
     }
-    // 表已存在时，确保新增列 photo 存在（SQLite 迁移）
-    {
-        QSqlQuery info(m_db);
-        if (info.exec("PRAGMA table_info(doctors)")) {
-            bool hasPhoto = false;
-            while (info.next()) {
-                if (info.value(1).toString().compare("photo", Qt::CaseInsensitive) == 0) {
-                    hasPhoto = true; break;
-                }
-            }
-            if (!hasPhoto) {
-                QSqlQuery alter(m_db);
-                if (!alter.exec("ALTER TABLE doctors ADD COLUMN photo BLOB")) {
-                    qDebug() << "为doctors表添加photo列失败:" << alter.lastError().text();
-                }
-            }
-        }
+    return true;
+}
+
+bool DBManager::addDoctorPhotoColumn() {
+    // 早期版本建的 doctors 表没有 photo 列
+    QSqlQuery info(m_db);
+    if (!info.exec("PRAGMA table_info(doctors)")) {
+        qDebug() << "读取doctors表结构失败:" << info.lastError().text();
+        return false;
+    }
+    while (info.next()) {
+        if (info.value(1).toString().compare("photo", Qt::CaseInsensitive) == 0) return true;
     }
+    QSqlQuery alter(m_db);
+    if (!alter.exec("ALTER TABLE doctors ADD COLUMN photo BLOB")) {
+        qDebug() << "为doctors表添加photo列失败:" << alter.lastError().text();
+        return false;
+    }
+    return true;
 }
 
-void DBManager::createPatientsTable() {
-    if (!m_db.tables().contains(QStringLiteral("patients"))) {
-        QSqlQuery query(m_db);
-        QString sql = R"(
-            CREATE TABLE patients (
-                id INTEGER PRIMARY KEY AUTOINCREMENT,
-                username TEXT UNIQUE NOT NULL,
-                name TEXT NOT NULL,
-                age INTEGER,
-                gender TEXT CHECK(gender IN ('男', '女')),
-                phone TEXT,
-                email TEXT,
-                address TEXT,
-                id_card TEXT,
-                emergency_contact TEXT,
-                emergency_phone TEXT,
-                created_at DATETIME DEFAULT CURRENT_TIMESTAMP,
-                updated_at DATETIME DEFAULT CURRENT_TIMESTAMP,
-                FOREIGN KEY (username) REFERENCES users(username)
-            )
-        )";
-        if (!query.exec(sql)) {
-            qDebug() << "创建patients表失败:" << query.lastError().text();
-        }
+bool DBManager::createPatientsTable() {
+    QSqlQuery query(m_db);
+    QString sql = R"(
+        CREATE TABLE IF NOT EXISTS patients (
+            id INTEGER PRIMARY KEY AUTOINCREMENT,
+            username TEXT UNIQUE NOT NULL,
+            name TEXT NOT NULL,
+            age INTEGER,
+            gender TEXT CHECK(gender IN ('男', '女')),
+            phone TEXT,
+            email TEXT,
+            address TEXT,
+            id_card TEXT,
+            emergency_contact TEXT,
+            emergency_phone TEXT,
+            created_at DATETIME DEFAULT CURRENT_TIMESTAMP,
+            updated_at DATETIME DEFAULT CURRENT_TIMESTAMP,
+            FOREIGN KEY (username) REFERENCES users(username)
+        )
+    )";
+    if (!query.exec(sql)) {
+        qDebug() << "创建patients表失败:" << query.lastError().text();
+        return false;
     }
+    return true;
 }
 
-void DBManager::createDoctorSchedulesTable() {
-    if (!m_db.tables().contains(QStringLiteral("doctor_schedules"))) {
-        QSqlQuery query(m_db);
-        QString sql = R"(
-            CREATE TABLE doctor_schedules (
-                id INTEGER PRIMARY KEY AUTOINCREMENT,
-                doctor_username TEXT NOT NULL,
-                day_of_week INTEGER NOT NULL CHECK(day_of_week >= 0 AND day_of_week <= 6),
-                start_time TIME NOT NULL,
-                end_time TIME NOT NULL,
-                max_appointments INTEGER DEFAULT 20,
-                is_active BOOLEAN DEFAULT 1,
-                created_at DATETIME DEFAULT CURRENT_TIMESTAMP,
-                updated_at DATETIME DEFAULT CURRENT_TIMESTAMP,
-                UNIQUE(doctor_username, day_of_week),
-                FOREIGN KEY (doctor_username) REFERENCES users(username)
-            )
-        )";
-        if (!query.exec(sql)) {
-            qDebug() << "创建doctor_schedules表失败:" << query.lastError().text();
-        }
+bool DBManager::createDoctorSchedulesTable() {
+    QSqlQuery query(m_db);
+    QString sql = R"(
+        CREATE TABLE IF NOT EXISTS doctor_schedules (
+            id INTEGER PRIMARY KEY AUTOINCREMENT,
+            doctor_username TEXT NOT NULL,
+            day_of_week INTEGER NOT NULL CHECK(day_of_week >= 0 AND day_of_week <= 6),
+            start_time TIME NOT NULL,
+            end_time TIME NOT NULL,
+            max_appointments INTEGER DEFAULT 20,
+            is_active BOOLEAN DEFAULT 1,
+            created_at DATETIME DEFAULT CURRENT_TIMESTAMP,
+            updated_at DATETIME DEFAULT CURRENT_TIMESTAMP,
+            UNIQUE(doctor_username, day_of_week),
+            FOREIGN KEY (doctor_username) REFERENCES users(username)
+        )
+    )";
+    if (!query.exec(sql)) {
+        qDebug() << "创建doctor_schedules表失败:" << query.lastError().text();
+        return false;
     }
+    return true;
 }
 
-void DBManager::createAppointmentsTable() {
-    if (!m_db.tables().contains(QStringLiteral("appointments"))) {
-        QSqlQuery query(m_db);
-        QString sql = R"(
-            CREATE TABLE appointments (
-                id INTEGER PRIMARY KEY AUTOINCREMENT,
-                patient_username TEXT NOT NULL,
-                doctor_username TEXT NOT NULL,
-                appointment_date DATE NOT NULL,
-                appointment_time TIME NOT NULL,
-                status TEXT DEFAULT 'pending' CHECK(status IN ('pending', 'confirmed', 'completed', 'cancelled')),
-                department TEXT,
-                chief_complaint TEXT,
-                fee DECIMAL(10,2),
-                created_at DATETIME DEFAULT CURRENT_TIMESTAMP,
-                updated_at DATETIME DEFAULT CURRENT_TIMESTAMP,
-                FOREIGN KEY (patient_username) REFERENCES users(username),
-                FOREIGN KEY (doctor_username) REFERENCES users(username)
-            )
-        )";
-        if (!query.exec(sql)) {
-            qDebug() << "创建appointments表失败:" << query.lastError().text();
-        }
+bool DBManager::createAppointmentsTable() {
+    QSqlQuery query(m_db);
+    QString sql = R"(
+        CREATE TABLE IF NOT EXISTS appointments (
+            id INTEGER PRIMARY KEY AUTOINCREMENT,
+            patient_username TEXT NOT NULL,
+            doctor_username TEXT NOT NULL,
+            appointment_date DATE NOT NULL,
+            appointment_time TIME NOT NULL,
+            status TEXT DEFAULT 'pending' CHECK(status IN ('pending', 'confirmed', 'completed', 'cancelled')),
+            department TEXT,
+            chief_complaint TEXT,
+            fee DECIMAL(10,2),
+            created_at DATETIME DEFAULT CURRENT_TIMESTAMP,
+            updated_at DATETIME DEFAULT CURRENT_TIMESTAMP,
+            FOREIGN KEY (patient_username) REFERENCES users(username),
+            FOREIGN KEY (doctor_username) REFERENCES users(username)
+        )
+    )";
+    if (!query.exec(sql)) {
+        qDebug() << "创建appointments表失败:" << query.lastError().text();
+        return false;
     }
+    return true;
 }
 
-void DBManager::createMedicalRecordsTable() {
-    if (!m_db.tables().contains(QStringLiteral("medical_records"))) {
-        QSqlQuery query(m_db);
-        QString sql = R"(
-            CREATE TABLE medical_records (
-                id INTEGER PRIMARY KEY AUTOINCREMENT,
-                appointment_id INTEGER,
-                patient_username TEXT NOT NULL,
-                doctor_username TEXT NOT NULL,
-                visit_date DATETIME NOT NULL,
-                chief_complaint TEXT,
-                present_illness TEXT,
-                past_history TEXT,
-                physical_examination TEXT,
-                diagnosis TEXT,
-                treatment_plan TEXT,
-                notes TEXT,
-                created_at DATETIME DEFAULT CURRENT_TIMESTAMP,
-                updated_at DATETIME DEFAULT CURRENT_TIMESTAMP,
-                FOREIGN KEY (appointment_id) REFERENCES appointments(id),
-                FOREIGN KEY (patient_username) REFERENCES users(username),
-                FOREIGN KEY (doctor_username) REFERENCES users(username)
-            )
-        )";
-        if (!query.exec(sql)) {
-            qDebug() << "创建medical_records表失败:" << query.lastError().text();
-        }
+bool DBManager::createMedicalRecordsTable() {
+    QSqlQuery query(m_db);
+    QString sql = R"(
+        CREATE TABLE IF NOT EXISTS medical_records (
+            id INTEGER PRIMARY KEY AUTOINCREMENT,
+            appointment_id INTEGER,
+            patient_username TEXT NOT NULL,
+            doctor_username TEXT NOT NULL,
+            visit_date DATETIME NOT NULL,
+            chief_complaint TEXT,
+            present_illness TEXT,
+            past_history TEXT,
+            physical_examination TEXT,
+            diagnosis TEXT,
+            treatment_plan TEXT,
+            notes TEXT,
+            created_at DATETIME DEFAULT CURRENT_TIMESTAMP,
+            updated_at DATETIME DEFAULT CURRENT_TIMESTAMP,
+            FOREIGN KEY (appointment_id) REFERENCES appointments(id),
+            FOREIGN KEY (patient_username) REFERENCES users(username),
+            FOREIGN KEY (doctor_username) REFERENCES users(username)
+        )
+    )";
+    if (!query.exec(sql)) {
+        qDebug() << "创建medical_records表失败:" << query.lastError().text();
+        return false;
     }
+    return true;
 }
 
-void DBManager::createMedicalAdvicesTable() {
-    if (!m_db.tables().contains(QStringLiteral("medical_advices"))) {
-        QSqlQuery query(m_db);
-        QString sql = R"(
-            CREATE TABLE medical_advices (
-                id INTEGER PRIMARY KEY AUTOINCREMENT,
-                record_id INTEGER NOT NULL,
-                advice_type TEXT NOT NULL CHECK(advice_type IN ('medication', 'lifestyle', 'followup', 'examination')),
-                content TEXT NOT NULL,
-                priority TEXT DEFAULT 'normal' CHECK(priority IN ('low', 'normal', 'high', 'urgent')),
-                created_at DATETIME DEFAULT CURRENT_TIMESTAMP,
-                FOREIGN KEY (record_id) REFERENCES medical_records(id)
-            )
-        )";
-        if (!query.exec(sql)) {
-            qDebug() << "创建medical_advices表失败:" << query.lastError().text();
-        }
+bool DBManager::createMedicalAdvicesTable() {
+    QSqlQuery query(m_db);
+    QString sql = R"(
+        CREATE TABLE IF NOT EXISTS medical_advices (
+            id INTEGER PRIMARY KEY AUTOINCREMENT,
+            record_id INTEGER NOT NULL,
+            advice_type TEXT NOT NULL CHECK(advice_type IN ('medication', 'lifestyle', 'followup', 'examination')),
+            content TEXT NOT NULL,
+            priority TEXT DEFAULT 'normal' CHECK(priority IN ('low', 'normal', 'high', 'urgent')),
+            created_at DATETIME DEFAULT CURRENT_TIMESTAMP,
+            FOREIGN KEY (record_id) REFERENCES medical_records(id)
+        )
+    )";
+    if (!query.exec(sql)) {
+        qDebug() << "创建medical_advices表失败:" << query.lastError().text();
+        return false;
     }
+    return true;
 }
 
-void DBManager::createPrescriptionsTable() {
-    if (!m_db.tables().contains(QStringLiteral("prescriptions"))) {
-        QSqlQuery query(m_db);
-        QString sql = R"(
-            CREATE TABLE prescriptions (
-                id INTEGER PRIMARY KEY AUTOINCREMENT,
-                record_id INTEGER,
-                patient_username TEXT NOT NULL,
-                doctor_username TEXT NOT NULL,
-                prescription_date DATETIME NOT NULL,
-                total_amount DECIMAL(10,2) DEFAULT 0.00,
-                status TEXT DEFAULT 'pending' CHECK(status IN ('pending', 'dispensed', 'cancelled')),
-                notes TEXT,
-                created_at DATETIME DEFAULT CURRENT_TIMESTAMP,
-                updated_at DATETIME DEFAULT CURRENT_TIMESTAMP,
-                FOREIGN KEY (record_id) REFERENCES medical_records(id),
-                FOREIGN KEY (patient_username) REFERENCES users(username),
-                FOREIGN KEY (doctor_username) REFERENCES users(username)
-            )
-        )";
-        if (!query.exec(sql)) {
-            qDebug() << "创建prescriptions表失败:" << query.lastError().text();
-        }
+bool DBManager::createPrescriptionsTable() {
+    QSqlQuery query(m_db);
+    QString sql = R"(
+        CREATE TABLE IF NOT EXISTS prescriptions (
+            id INTEGER PRIMARY KEY AUTOINCREMENT,
+            record_id INTEGER,
+            patient_username TEXT NOT NULL,
+            doctor_username TEXT NOT NULL,
+            prescription_date DATETIME NOT NULL,
+            total_amount DECIMAL(10,2) DEFAULT 0.00,
+            status TEXT DEFAULT 'pending' CHECK(status IN ('pending', 'dispensed', 'cancelled')),
+            notes TEXT,
+            created_at DATETIME DEFAULT CURRENT_TIMESTAMP,
+            updated_at DATETIME DEFAULT CURRENT_TIMESTAMP,
+            FOREIGN KEY (record_id) REFERENCES medical_records(id),
+            FOREIGN KEY (patient_username) REFERENCES users(username),
+            FOREIGN KEY (doctor_username) REFERENCES users(username)
+        )
+    )";
+    if (!query.exec(sql)) {
+        qDebug() << "创建prescriptions表失败:" << query.lastError().text();
+        return false;
     }
+    return true;
 }
 
-void DBManager::createPrescriptionItemsTable() {
-    if (!m_db.tables().contains(QStringLiteral("prescription_items"))) {
-        QSqlQuery query(m_db);
-        QString sql = R"(
-            CREATE TABLE prescription_items (
-                id INTEGER PRIMARY KEY AUTOINCREMENT,
-                prescription_id INTEGER NOT NULL,
-                medication_id INTEGER NOT NULL,
-                quantity INTEGER NOT NULL,
-                dosage TEXT,
-                frequency TEXT,
-                duration TEXT,
-                instructions TEXT,
-                unit_price DECIMAL(10,2),
-                total_price DECIMAL(10,2),
-                FOREIGN KEY (prescription_id) REFERENCES prescriptions(id),
-                FOREIGN KEY (medication_id) REFERENCES medications(id)
-            )
-        )";
-        if (!query.exec(sql)) {
-            qDebug() << "创建prescription_items表失败:" << query.lastError().text();
-        }
+bool DBManager::createPrescriptionItemsTable() {
+    QSqlQuery query(m_db);
+    QString sql = R"(
+        CREATE TABLE IF NOT EXISTS prescription_items (
+            id INTEGER PRIMARY KEY AUTOINCREMENT,
+            prescription_id INTEGER NOT NULL,
+            medication_id INTEGER NOT NULL,
+            quantity INTEGER NOT NULL,
+            dosage TEXT,
+            frequency TEXT,
+            duration TEXT,
+            instructions TEXT,
+            unit_price DECIMAL(10,2),
+            total_price DECIMAL(10,2),
+            FOREIGN KEY (prescription_id) REFERENCES prescriptions(id),
+            FOREIGN KEY (medication_id) REFERENCES medications(id)
+        )
+    )";
+    if (!query.exec(sql)) {
+        qDebug() << "创建prescription_items表失败:" << query.lastError().text();
+        return false;
     }
+    return true;
 }
 
-void DBManager::createMedicationsTable() {
-    if (!m_db.tables().contains(QStringLiteral("medications"))) {
-        QSqlQuery query(m_db);
-        QString sql = R"(
-            CREATE TABLE medications (
-                id INTEGER PRIMARY KEY AUTOINCREMENT,
-                name TEXT NOT NULL,
-                generic_name TEXT,
-                category TEXT,
-                manufacturer TEXT,
-                specification TEXT,
-                unit TEXT,
-                price DECIMAL(10,2),
-                stock_quantity INTEGER DEFAULT 0,
-                description TEXT,
-                precautions TEXT,
-                side_effects TEXT,
-                contraindications TEXT,
-                created_at DATETIME DEFAULT CURRENT_TIMESTAMP,
-                updated_at DATETIME DEFAULT CURRENT_TIMESTAMP
-            )
-        )";
-        if (!query.exec(sql)) {
-            qDebug() << "创建medications表失败:" << query.lastError().text();
-        }
-        
-        // 插入一些示例药品数据
-        insertSampleMedications();
+bool DBManager::createMedicationsTable() {
+    // 仅在首次建表时插入示例药品
+    const bool existed = m_db.tables().contains(QStringLiteral("medications"));
+    QSqlQuery query(m_db);
+    QString sql = R"(
+        CREATE TABLE IF NOT EXISTS medications (
+            id INTEGER PRIMARY KEY AUTOINCREMENT,
+            name TEXT NOT NULL,
+            generic_name TEXT,
+            category TEXT,
+            manufacturer TEXT,
+            specification TEXT,
+            unit TEXT,
+            price DECIMAL(10,2),
+            stock_quantity INTEGER DEFAULT 0,
+            description TEXT,
+            precautions TEXT,
+            side_effects TEXT,
+            contraindications TEXT,
+            created_at DATETIME DEFAULT CURRENT_TIMESTAMP,
+            updated_at DATETIME DEFAULT CURRENT_TIMESTAMP
+        )
+    )";
+    if (!query.exec(sql)) {
+        qDebug() << "创建medications表失败:" << query.lastError().text();
+        return false;
     }
+    
+    // 插入一些示例药品数据
+    if (!existed) insertSampleMedications();
+    return true;
 }
 
-void DBManager::createHospitalizationsTable() {
-    if (!m_db.tables().contains(QStringLiteral("hospitalizations"))) {
-        QSqlQuery query(m_db);
-        QString sql = R"(
-            CREATE TABLE hospitalizations (
-                id INTEGER PRIMARY KEY AUTOINCREMENT,
-                patient_username TEXT NOT NULL,
-                doctor_username TEXT NOT NULL,
-                admission_date DATE NOT NULL,
-                discharge_date DATE,
-                ward TEXT,
-                bed_number TEXT,
-                diagnosis TEXT,
-                treatment_plan TEXT,
-                daily_cost DECIMAL(10,2) DEFAULT 0.00,
-                total_cost DECIMAL(10,2) DEFAULT 0.00,
-                status TEXT DEFAULT 'admitted' CHECK(status IN ('admitted', 'discharged', 'transferred')),
-                notes TEXT,
-                created_at DATETIME DEFAULT CURRENT_TIMESTAMP,
-                updated_at DATETIME DEFAULT CURRENT_TIMESTAMP,
-                FOREIGN KEY (patient_username) REFERENCES users(username),
-                FOREIGN KEY (doctor_username) REFERENCES users(username)
-            )
-        )";
-        if (!query.exec(sql)) {
-            qDebug() << "创建hospitalizations表失败:" << query.lastError().text();
-        }
+bool DBManager::createHospitalizationsTable() {
+    QSqlQuery query(m_db);
+    QString sql = R"(
+        CREATE TABLE IF NOT EXISTS hospitalizations (
+            id INTEGER PRIMARY KEY AUTOINCREMENT,
+            patient_username TEXT NOT NULL,
+            doctor_username TEXT NOT NULL,
+            admission_date DATE NOT NULL,
+            discharge_date DATE,
+            ward TEXT,
+            bed_number TEXT,
+            diagnosis TEXT,
+            treatment_plan TEXT,
+            daily_cost DECIMAL(10,2) DEFAULT 0.00,
+            total_cost DECIMAL(10,2) DEFAULT 0.00,
+            status TEXT DEFAULT 'admitted' CHECK(status IN ('admitted', 'discharged', 'transferred')),
+            notes TEXT,
+            created_at DATETIME DEFAULT CURRENT_TIMESTAMP,
+            updated_at DATETIME DEFAULT CURRENT_TIMESTAMP,
+            FOREIGN KEY (patient_username) REFERENCES users(username),
+            FOREIGN KEY (doctor_username) REFERENCES users(username)
+        )
+    )";
+    if (!query.exec(sql)) {
+        qDebug() << "创建hospitalizations表失败:" << query.lastError().text();
+        return false;
     }
+    return true;
 }
 
-void DBManager::createAttendanceTable() {
-    if (!m_db.tables().contains(QStringLiteral("attendance"))) {
-        QSqlQuery query(m_db);
-        QString sql = R"(
-            CREATE TABLE attendance (
-                id INTEGER PRIMARY KEY AUTOINCREMENT,
-                doctor_username TEXT NOT NULL,
-                checkin_date DATE NOT NULL,
-                checkin_time TIME NOT NULL,
-                created_at DATETIME DEFAULT CURRENT_TIMESTAMP,
-                FOREIGN KEY (doctor_username) REFERENCES users(username)
-            )
-        )";
-        if (!query.exec(sql)) {
-            qDebug() << "创建attendance表失败:" << query.lastError().text();
-        } else {
-            QSqlQuery idx(m_db);
-            idx.exec("CREATE INDEX IF NOT EXISTS idx_attendance_doctor_date ON attendance(doctor_username, checkin_date)");
-        }
+bool DBManager::createAttendanceTable() {
+    QSqlQuery query(m_db);
+    QString sql = R"(
+        CREATE TABLE IF NOT EXISTS attendance (
+            id INTEGER PRIMARY KEY AUTOINCREMENT,
+            doctor_username TEXT NOT NULL,
+            checkin_date DATE NOT NULL,
+            checkin_time TIME NOT NULL,
+            created_at DATETIME DEFAULT CURRENT_TIMESTAMP,
+            FOREIGN KEY (doctor_username) REFERENCES users(username)
+        )
+    )";
+    if (!query.exec(sql)) {
+        qDebug() << "创建attendance表失败:" << query.lastError().text();
+        return false;
     }
+    return execSchema({"CREATE INDEX IF NOT EXISTS idx_attendance_doctor_date ON attendance(doctor_username, checkin_date)"});
 }
 
-void DBManager::createLeaveRequestsTable() {
-    if (!m_db.tables().contains(QStringLiteral("leave_requests"))) {
-        QSqlQuery query(m_db);
-        QString sql = R"(
-            CREATE TABLE leave_requests (
-                id INTEGER PRIMARY KEY AUTOINCREMENT,
-                doctor_username TEXT NOT NULL,
-                leave_date DATE NOT NULL,
-                reason TEXT,
-                status TEXT NOT NULL DEFAULT 'active' CHECK(status IN ('active','cancelled','approved','rejected')),
-                created_at DATETIME DEFAULT CURRENT_TIMESTAMP,
-                updated_at DATETIME DEFAULT CURRENT_TIMESTAMP,
-                FOREIGN KEY (doctor_username) REFERENCES users(username)
-            )
-        )";
-        if (!query.exec(sql)) {
-            qDebug() << "创建leave_requests表失败:" << query.lastError().text();
-        } else {
-            QSqlQuery idx(m_db);
-            idx.exec("CREATE INDEX IF NOT EXISTS idx_leave_doctor_status ON leave_requests(doctor_username, status)");
-        }
+bool DBManager::createLeaveRequestsTable() {
+    QSqlQuery query(m_db);
+    QString sql = R"(
+        CREATE TABLE IF NOT EXISTS leave_requests (
+            id INTEGER PRIMARY KEY AUTOINCREMENT,
+            doctor_username TEXT NOT NULL,
+            leave_date DATE NOT NULL,
+            reason TEXT,
+            status TEXT NOT NULL DEFAULT 'active' CHECK(status IN ('active','cancelled','approved','rejected')),
+            created_at DATETIME DEFAULT CURRENT_TIMESTAMP,
+            updated_at DATETIME DEFAULT CURRENT_TIMESTAMP,
+            FOREIGN KEY (doctor_username) REFERENCES users(username)
+        )
+    )";
+    if (!query.exec(sql)) {
+        qDebug() << "创建leave_requests表失败:" << query.lastError().text();
+        return false;
     }
+    return execSchema({"CREATE INDEX IF NOT EXISTS idx_leave_doctor_status ON leave_requests(doctor_username, status)"});
 }
 
-bool DBManager::createAttendanceRecord(const QJsonObject &data) {
-    QSqlQuery q(m_db);
-    q.prepare(R"(INSERT INTO attendance (doctor_username, checkin_date, checkin_time)
+bool DBManager::createAttendanceRecord(const QJsonObject &data, int *insertedId) {
+    auto qStmt = statement(Stmt::CreateAttendance, R"(INSERT INTO attendance (doctor_username, checkin_date, checkin_time)
                 VALUES (:u, :d, :t))");
+    QSqlQuery &q = *qStmt;
     q.bindValue(":u", data.value("doctor_username").toString());
     q.bindValue(":d", data.value("checkin_date").toString());
     q.bindValue(":t", data.value("checkin_time").toString());
     if (!q.exec()) { qDebug() << "createAttendanceRecord error:" << q.lastError().text(); return false; }
+    if (insertedId) *insertedId = q.lastInsertId().toInt();
     return true;
 }
 
 bool DBManager::getAttendanceByDoctor(const QString &doctorUsername, QJsonArray &records, int limit) {
-    QSqlQuery q(m_db);
-    q.prepare(QString(R"(
+    auto qStmt = statement(Stmt::GetAttendanceByDoctor, R"(
         SELECT id, doctor_username, checkin_date, checkin_time, created_at
         FROM attendance
         WHERE doctor_username = :u
         ORDER BY checkin_date DESC, checkin_time DESC, id DESC
-        LIMIT %1
-    )").arg(qMax(1, limit)));
+        LIMIT :limit
+    )");
+    QSqlQuery &q = *qStmt;
     q.bindValue(":u", doctorUsername);
+    q.bindValue(":limit", qMax(1, limit));
     if (!q.exec()) { qDebug() << "getAttendanceByDoctor error:" << q.lastError().text(); return false; }
     while (q.next()) {
         QJsonObject o;
@@ -671,8 +1005,8 @@ bool DBManager::cancelActiveLeaveForDoctor(const QString &doctorUsername) {
 // 移除旧版住院接口的重复实现，统一使用下方新版实现
 
 bool DBManager::authenticateUser(const QString& username, const QString& password) {
-    QSqlQuery query(m_db);
-    query.prepare("SELECT username FROM users WHERE username = :username AND password = :password");
+    auto queryStmt = statement(Stmt::AuthenticateUser, "SELECT username FROM users WHERE username = :username AND password = :password");
+    QSqlQuery &query = *queryStmt;
     query.bindValue(":username", username);
     query.bindValue(":password", password);
     
@@ -685,8 +1019,8 @@ bool DBManager::authenticateUser(const QString& username, const QString& passwor
 }
 
 bool DBManager::getUserRole(const QString &username, QString &role) {
-    QSqlQuery query(m_db);
-    query.prepare("SELECT role FROM users WHERE username = :u");
+    auto queryStmt = statement(Stmt::GetUserRole, "SELECT role FROM users WHERE username = :u");
+    QSqlQuery &query = *queryStmt;
     query.bindValue(":u", username);
     if (query.exec() && query.next()) {
         role = query.value(0).toString();
@@ -715,12 +1049,12 @@ bool DBManager::addUser(const QString& username, const QString& password, const
 }
 
 bool DBManager::getDoctorInfo(const QString& username, QJsonObject& doctorInfo) {
-    QSqlQuery query(m_db);
-    query.prepare(R"(
+    auto queryStmt = statement(Stmt::GetDoctorInfo, R"(
         SELECT name, department, phone, email, work_number, title, 
                specialization, consultation_fee, max_patients_per_day, photo
         FROM doctors WHERE username = :username
     )");
+    QSqlQuery &query = *queryStmt;
     query.bindValue(":username", username);
     
     if (query.exec() && query.next()) {
@@ -744,12 +1078,12 @@ bool DBManager::getDoctorInfo(const QString& username, QJsonObject& doctorInfo)
 }
 
 bool DBManager::getPatientInfo(const QString& username, QJsonObject& patientInfo) {
-    QSqlQuery query(m_db);
-    query.prepare(R"(
+    auto queryStmt = statement(Stmt::GetPatientInfo, R"(
         SELECT name, age, gender, phone, email, address, id_card, 
                emergency_contact, emergency_phone
         FROM patients WHERE username = :username
     )");
+    QSqlQuery &query = *queryStmt;
     query.bindValue(":username", username);
     
     if (query.exec() && query.next()) {
@@ -850,14 +1184,14 @@ bool DBManager::updatePatientInfo(const QString& username, const QJsonObject& da
 // 重写 registerDoctor，使用事务确保原子性，并一次性插入所有数据。
 bool DBManager::registerDoctor(const QString& name, const QString& password, const QString& department, const QString& phone) {
     // 开启数据库事务
-    if (!m_db.transaction()) {
+    if (!beginTransaction()) {
         qDebug() << "Failed to start transaction.";
         return false;
     }
 
     // 1. 插入到 users 表
     if (!addUser(name, password, "doctor")) {
-        m_db.rollback(); // 如果失败，回滚事务
+        rollbackTransaction(); // 如果失败，回滚事务
         return false;
     }
 
@@ -871,14 +1205,14 @@ bool DBManager::registerDoctor(const QString& name, const QString& password, con
     
     if (!docQuery.exec()) {
         qDebug() << "registerDoctor insert error:" << docQuery.lastError().text();
-        m_db.rollback(); // 如果失败，回滚事务
+        rollbackTransaction(); // 如果失败，回滚事务
         return false;
     }
 
     // 提交事务
-    if (!m_db.commit()) {
+    if (!commitTransaction()) {
         qDebug() << "Failed to commit transaction.";
-        m_db.rollback();
+        rollbackTransaction();
         return false;
     }
     
@@ -889,7 +1223,7 @@ bool DBManager::registerDoctor(const QString& name, const QString& password, con
 bool DBManager::registerPatient(const QString& name, const QString& password, int age, const QString& phone, const QString& address) {
     qDebug() << "开始注册患者:" << name << "age:" << age << "phone:" << phone << "address:" << address;
     
-    if (!m_db.transaction()) {
+    if (!beginTransaction()) {
         qDebug() << "Failed to start transaction.";
         return false;
     }
@@ -897,7 +1231,7 @@ bool DBManager::registerPatient(const QString& name, const QString& password, in
     // 1. 插入到 users 表
     if (!addUser(name, password, "patient")) {
         qDebug() << "Failed to add user to users table";
-        m_db.rollback();
+        rollbackTransaction();
         return false;
     }
 
@@ -912,13 +1246,13 @@ bool DBManager::registerPatient(const QString& name, const QString& password, in
     
     if (!patQuery.exec()) {
         qDebug() << "registerPatient insert error:" << patQuery.lastError().text();
-        m_db.rollback();
+        rollbackTransaction();
         return false;
     }
 
-    if (!m_db.commit()) {
+    if (!commitTransaction()) {
         qDebug() << "Failed to commit transaction.";
-        m_db.rollback();
+        rollbackTransaction();
         return false;
     }
     
@@ -992,118 +1326,90 @@ bool DBManager::updatePatientProfile(const QString& oldName, const QString& newN
 
 // 预约管理实现
 bool DBManager::createAppointment(const QJsonObject& appointmentData) {
-    QString doctorUsername = appointmentData["doctor_username"].toString();
-    QString appointmentDate = appointmentData["appointment_date"].toString();
-    QString appointmentTime = appointmentData["appointment_time"].toString();
-    
-    // 尝试严格的验证流程
-    bool strictValidationSuccess = true;
-    QString doctorDepartment;
-    double consultationFee = 0.0;
-    
-    // 1. 验证医生是否存在并获取医生信息
-    QSqlQuery doctorQuery(m_db);
-    doctorQuery.prepare(R"(
-        SELECT d.name, d.department, d.consultation_fee, d.title, d.specialization
-        FROM doctors d 
-        WHERE d.username = :username
-    )");
-    doctorQuery.bindValue(":username", doctorUsername);
-    
-    if (!doctorQuery.exec() || !doctorQuery.next()) {
-        qDebug() << "Doctor not found in doctors table, trying fallback:" << doctorQuery.lastError().text();
-        strictValidationSuccess = false;
-    } else {
-        doctorDepartment = doctorQuery.value("department").toString();
-        consultationFee = doctorQuery.value("consultation_fee").toDouble();
-    }
-    
-    // 2. 如果医生存在，验证排班
-    if (strictValidationSuccess) {
-        QSqlQuery scheduleQuery(m_db);
-        scheduleQuery.prepare(R"(
-            SELECT ds.start_time, ds.end_time, ds.max_appointments
-            FROM doctor_schedules ds
-            WHERE ds.doctor_username = :username 
-            AND ds.day_of_week = CAST(strftime('%w', :appointment_date) AS INTEGER)
-            AND ds.is_active = 1
+    int appointmentId = 0;
+    QString errorMessage;
+    return bookAppointment(appointmentData, appointmentId, errorMessage);
+}
+
+bool DBManager::bookAppointment(const QJsonObject& appointmentData, int& appointmentId, QString& errorMessage) {
+    // 名额检查与插入是同一条条件 INSERT：当天有效预约数（appointment_counters）未达上限才插入，
+    // 不存在“先查后插”的窗口；写入本就只在写线程执行，独立调用时以 BEGIN IMMEDIATE 先取得写锁
+    const QString doctorUsername = appointmentData["doctor_username"].toString();
+    const QString appointmentDate = appointmentData["appointment_date"].toString();
+    const QString appointmentTime = appointmentData["appointment_time"].toString();
+
+    errorMessage.clear();
+    if (!beginTransaction()) {
+        qDebug() << "bookAppointment: failed to begin transaction";
+        return false;
+    }
+    auto fail = [&](const QString& error) {
+        qDebug() << "bookAppointment failed:" << error;
+        rollbackTransaction();
+        return false;
+    };
+
+    // 1. 医生信息与当天（按星期几）的有效排班一次查出
+    QString doctorDepartment = appointmentData["department"].toString();
+    double consultationFee = appointmentData["fee"].toDouble();
+    int maxAppointments = -1; // -1 仅用于医生当天没有排班记录的情况：不限名额（与原回退逻辑一致）
+    {
+        auto lookupStmt = statement(Stmt::GetBookingSchedule, R"(
+            SELECT d.department, d.consultation_fee, ds.start_time, ds.end_time, ds.max_appointments
+            FROM doctors d
+            LEFT JOIN doctor_schedules ds ON ds.doctor_username = d.username
+                AND ds.day_of_week = CAST(strftime('%w', :appointment_date) AS INTEGER)
+                AND ds.is_active = 1
+            WHERE d.username = :username
         )");
-        scheduleQuery.bindValue(":username", doctorUsername);
-        scheduleQuery.bindValue(":appointment_date", appointmentDate);
-        
-        qDebug() << "Checking schedule for doctor:" << doctorUsername 
-                 << "on date:" << appointmentDate;
-        
-        // 先测试日期转换
-        QSqlQuery dayQuery(m_db);
-        dayQuery.prepare("SELECT CAST(strftime('%w', :date) AS INTEGER) as day_of_week");
-        dayQuery.bindValue(":date", appointmentDate);
-        if (dayQuery.exec() && dayQuery.next()) {
-            int dayOfWeek = dayQuery.value(0).toInt();
-            qDebug() << "Calculated day_of_week:" << dayOfWeek << "for date:" << appointmentDate;
-        }
-        
-        if (!scheduleQuery.exec() || !scheduleQuery.next()) {
-            qDebug() << "Doctor has no schedule for this day, query:" << scheduleQuery.executedQuery();
-            qDebug() << "Error:" << scheduleQuery.lastError().text();
-            strictValidationSuccess = false;
+        QSqlQuery &lookup = *lookupStmt;
+        lookup.bindValue(":appointment_date", appointmentDate);
+        lookup.bindValue(":username", doctorUsername);
+        if (!lookup.exec()) return fail(lookup.lastError().text());
+        if (!lookup.next()) {
+            qDebug() << "Doctor not found in doctors table, using request data:" << doctorUsername;
+        } else if (lookup.value("max_appointments").isNull()) {
+            qDebug() << "Doctor has no schedule for this day:" << doctorUsername << appointmentDate;
         } else {
-            QString startTime = scheduleQuery.value("start_time").toString();
-            QString endTime = scheduleQuery.value("end_time").toString();
-            int maxAppointments = scheduleQuery.value("max_appointments").toInt();
-            
-            // 3. 验证预约时间是否在医生工作时间内
-            QTime apptTime = QTime::fromString(appointmentTime, "hh:mm");
-            QTime workStart = QTime::fromString(startTime, "hh:mm");
-            QTime workEnd = QTime::fromString(endTime, "hh:mm");
-            
-            if (apptTime < workStart || apptTime > workEnd) {
-                qDebug() << "Appointment time is outside doctor's working hours, trying fallback";
-                strictValidationSuccess = false;
-            } else {
-                // 4. 检查当天预约数量是否已满
-                QSqlQuery countQuery(m_db);
-                countQuery.prepare(R"(
-                    SELECT COUNT(*) FROM appointments 
-                    WHERE doctor_username = :username 
-                    AND appointment_date = :date 
-                    AND status IN ('pending', 'confirmed')
-                )");
-                countQuery.bindValue(":username", doctorUsername);
-                countQuery.bindValue(":date", appointmentDate);
-                
-                if (!countQuery.exec() || !countQuery.next()) {
-                    qDebug() << "Failed to count existing appointments, trying fallback:" << countQuery.lastError().text();
-                    strictValidationSuccess = false;
-                } else {
-                    int currentAppointments = countQuery.value(0).toInt();
-                    if (currentAppointments >= maxAppointments) {
-                        qDebug() << "Doctor's appointment slots are full for this day:" << currentAppointments << "/" << maxAppointments;
-                        return false; // 直接返回失败，不再使用fallback
-                    }
-                }
+            // 2. 有排班时预约时间必须可解析且在工作时间内，否则拒绝（不能绕过名额限制）
+            auto parseTime = [](const QString& text) {
+                const QTime t = QTime::fromString(text, "hh:mm");
+                return t.isValid() ? t : QTime::fromString(text, "hh:mm:ss");
+            };
+            const QTime apptTime = parseTime(appointmentTime);
+            const QTime workStart = parseTime(lookup.value("start_time").toString());
+            const QTime workEnd = parseTime(lookup.value("end_time").toString());
+            if (!apptTime.isValid()) {
+                errorMessage = QStringLiteral("预约时间格式无效，应为 HH:mm");
+                return fail(errorMessage);
             }
+            if (!workStart.isValid() || !workEnd.isValid() || apptTime < workStart || apptTime > workEnd) {
+                errorMessage = QStringLiteral("预约时间不在医生当天的出诊时间（%1-%2）内")
+                                   .arg(lookup.value("start_time").toString(), lookup.value("end_time").toString());
+                return fail(errorMessage);
+            }
+            doctorDepartment = lookup.value("department").toString();
+            consultationFee = lookup.value("consultation_fee").toDouble();
+            maxAppointments = lookup.value("max_appointments").toInt();
         }
     }
-    
-    // 如果严格验证失败，使用传入的数据作为回退
-    if (!strictValidationSuccess) {
-        doctorDepartment = appointmentData["department"].toString();
-        consultationFee = appointmentData["fee"].toDouble();
-    }
-    
-    // 5. 创建预约记录（无论是否通过严格验证）
-    QSqlQuery query(m_db);
-    query.prepare(R"(
+
+    // 3. 名额未满时插入（待处理与已确认的预约占用名额）
+    auto insertStmt = statement(Stmt::BookAppointment, R"(
         INSERT INTO appointments (
             patient_username, doctor_username, appointment_date, 
             appointment_time, department, chief_complaint, fee, status
-        ) VALUES (
-            :patient_username, :doctor_username, :appointment_date,
-            :appointment_time, :department, :chief_complaint, :fee, 'pending'
         )
+        SELECT :patient_username, :doctor_username, :appointment_date,
+               :appointment_time, :department, :chief_complaint, :fee, 'pending'
+        WHERE :max_appointments < 0 OR COALESCE((
+            SELECT SUM(c.count) FROM appointment_counters c
+            WHERE c.doctor_username = :doctor_username
+            AND c.appointment_date = COALESCE(date(:appointment_date), :appointment_date)
+            AND c.status IN ('pending', 'confirmed')
+        ), 0) < :max_appointments
     )");
-    
+    QSqlQuery &query = *insertStmt;
     query.bindValue(":patient_username", appointmentData["patient_username"].toString());
     query.bindValue(":doctor_username", doctorUsername);
     query.bindValue(":appointment_date", appointmentDate);
@@ -1111,6 +1417,7 @@ bool DBManager::createAppointment(const QJsonObject& appointmentData) {
     query.bindValue(":department", doctorDepartment);
     query.bindValue(":chief_complaint", appointmentData["chief_complaint"].toString());
     query.bindValue(":fee", consultationFee);
+    query.bindValue(":max_appointments", maxAppointments);
     
     if (!query.exec()) {
         qDebug() << "createAppointment error:" << query.lastError().text()
@@ -1120,10 +1427,18 @@ bool DBManager::createAppointment(const QJsonObject& appointmentData) {
                  << " time=" << appointmentTime
                  << " dept=" << doctorDepartment
                  << " fee=" << consultationFee;
-        return false;
+        return fail(query.lastError().text());
+    }
+    if (query.numRowsAffected() == 0) {
+        qDebug() << "Doctor's appointment slots are full for this day:" << doctorUsername << appointmentDate
+                 << "max:" << maxAppointments;
+        errorMessage = QStringLiteral("当前医生预约数量已达上限，请等待或选择其他医生挂号");
+        return fail(errorMessage);
     }
+    appointmentId = query.lastInsertId().toInt();
+    if (!commitTransaction()) return fail(m_db.lastError().text());
     
-    qDebug() << "Appointment created successfully for patient:" << appointmentData["patient_username"].toString() 
+    qDebug() << "Appointment" << appointmentId << "created for patient:" << appointmentData["patient_username"].toString()
              << "with doctor:" << doctorUsername;
     return true;
 }
@@ -1262,8 +1577,8 @@ bool DBManager::getAppointmentsByDoctor(const QString& doctorUsername, QJsonArra
 }
 
 bool DBManager::updateAppointmentStatus(int appointmentId, const QString& status) {
-    QSqlQuery query(m_db);
-    query.prepare("UPDATE appointments SET status = :status WHERE id = :id");
+    auto queryStmt = statement(Stmt::UpdateAppointmentStatus, "UPDATE appointments SET status = :status WHERE id = :id");
+    QSqlQuery &query = *queryStmt;
     query.bindValue(":status", status);
     query.bindValue(":id", appointmentId);
     
@@ -1274,6 +1589,25 @@ bool DBManager::updateAppointmentStatus(int appointmentId, const QString& status
     return true;
 }
 
+bool DBManager::getAppointmentById(int appointmentId, QJsonObject& appointment) {
+    auto queryStmt = statement(Stmt::GetAppointmentById, R"(
+        SELECT id, doctor_username, patient_username, appointment_date, appointment_time, status
+        FROM appointments WHERE id = ?
+    )");
+    QSqlQuery &query = *queryStmt;
+    query.addBindValue(appointmentId);
+    if (!query.exec() || !query.next()) return false;
+    appointment = QJsonObject{
+        {"id", query.value("id").toInt()},
+        {"doctor_username", query.value("doctor_username").toString()},
+        {"patient_username", query.value("patient_username").toString()},
+        {"appointment_date", query.value("appointment_date").toString()},
+        {"appointment_time", query.value("appointment_time").toString()},
+        {"status", query.value("status").toString()},
+    };
+    return true;
+}
+
 bool DBManager::deleteAppointment(int appointmentId) {
     QSqlQuery query(m_db);
     query.prepare("DELETE FROM appointments WHERE id = :id");
@@ -1993,12 +2327,12 @@ bool DBManager::getPatientStatistics(const QString& patientUsername, QJsonObject
 
 // 获取用户角色
 QString DBManager::getUserRole(const QString& username) {
-    QSqlQuery query(m_db);
-    query.prepare("SELECT role FROM users WHERE username = :username");
-    query.bindValue(":username", username);
+    auto queryStmt = statement(Stmt::GetUserRole, "SELECT role FROM users WHERE username = :u");
+    QSqlQuery &query = *queryStmt;
+    query.bindValue(":u", username);
     
     if (query.exec() && query.next()) {
-        return query.value("role").toString();
+        return query.value(0).toString();
     }
     
     qDebug() << "getUserRole error:" << query.lastError().text();
@@ -2457,29 +2791,30 @@ void DBManager::insertSampleDoctorSchedules() {
 
 // 获取医生的详细排班和预约统计信息
 bool DBManager::getDoctorScheduleWithAppointmentStats(const QString& doctorUsername, QJsonArray& scheduleStats) {
-    QSqlQuery query(m_db);
-    query.prepare(R"(
+    // 未来 7 天内与排班同星期几的日期只有一天：按 (医生, 该日期) 读 appointment_counters 的几行计数即可
+    auto queryStmt = statement(Stmt::GetDoctorScheduleStats, R"(
         SELECT 
             ds.day_of_week, ds.start_time, ds.end_time, ds.max_appointments, ds.is_active,
             d.name as doctor_name, d.title, d.department, d.specialization, d.consultation_fee,
-            (SELECT COUNT(*) FROM appointments a 
-             WHERE a.doctor_username = ds.doctor_username 
-             AND CAST(strftime('%w', a.appointment_date) AS INTEGER) = ds.day_of_week
-             AND a.status != 'cancelled'
-             AND date(a.appointment_date) = date('now')
-            ) as today_appointments,
-            (SELECT COUNT(*) FROM appointments a 
-             WHERE a.doctor_username = ds.doctor_username 
-             AND CAST(strftime('%w', a.appointment_date) AS INTEGER) = ds.day_of_week
-             AND a.status != 'cancelled'
-             AND date(a.appointment_date) >= date('now')
-             AND date(a.appointment_date) < date('now', '+7 days')
-            ) as week_appointments
+            CASE WHEN ds.day_of_week = CAST(strftime('%w', 'now') AS INTEGER) THEN COALESCE((
+                SELECT SUM(c.count) FROM appointment_counters c
+                WHERE c.doctor_username = ds.doctor_username
+                AND c.appointment_date = date('now')
+                AND c.status != 'cancelled'
+            ), 0) ELSE 0 END as today_appointments,
+            COALESCE((
+                SELECT SUM(c.count) FROM appointment_counters c
+                WHERE c.doctor_username = ds.doctor_username
+                AND c.appointment_date = date('now',
+                    '+' || ((ds.day_of_week - CAST(strftime('%w', 'now') AS INTEGER) + 7) % 7) || ' days')
+                AND c.status != 'cancelled'
+            ), 0) as week_appointments
         FROM doctor_schedules ds
         LEFT JOIN doctors d ON ds.doctor_username = d.username
         WHERE ds.doctor_username = :username
         ORDER BY ds.day_of_week
     )");
+    QSqlQuery &query = *queryStmt;
     query.bindValue(":username", doctorUsername);
     
     if (!query.exec()) {
@@ -2526,8 +2861,8 @@ bool DBManager::getDoctorScheduleWithAppointmentStats(const QString& doctorUsern
 
 // 获取所有医生的排班概览（用于患者端选择医生）
 bool DBManager::getAllDoctorsScheduleOverview(QJsonArray& doctorsSchedule) {
-    QSqlQuery query(m_db);
-    query.prepare(R"(
+    // 每位医生的当天预约数取自 appointment_counters（主键查找），代价与医生数成正比，与预约总量无关
+    auto queryStmt = statement(Stmt::GetDoctorsScheduleOverview, R"(
         SELECT 
             d.username, d.name, d.title, d.department, d.specialization, 
             d.consultation_fee, d.max_patients_per_day,
@@ -2541,10 +2876,10 @@ bool DBManager::getAllDoctorsScheduleOverview(QJsonArray& doctorsSchedule) {
             ) as working_days,
             -- 当天预约数（基于当前星期几和对应的排班）
             COALESCE((
-                SELECT COUNT(*) FROM appointments a 
-                WHERE a.doctor_username = d.username 
-                AND date(a.appointment_date) = date('now')
-                AND a.status IN ('pending', 'confirmed')
+                SELECT SUM(c.count) FROM appointment_counters c
+                WHERE c.doctor_username = d.username
+                AND c.appointment_date = date('now')
+                AND c.status IN ('pending', 'confirmed')
                 AND EXISTS (
                     SELECT 1 FROM doctor_schedules ds2
                     WHERE ds2.doctor_username = d.username 
@@ -2566,6 +2901,7 @@ bool DBManager::getAllDoctorsScheduleOverview(QJsonArray& doctorsSchedule) {
                  d.consultation_fee, d.max_patients_per_day
         ORDER BY d.department, d.name
     )");
+    QSqlQuery &query = *queryStmt;
     
     if (!query.exec()) {
         qDebug() << "getAllDoctorsScheduleOverview error:" << query.lastError().text();
@@ -2593,37 +2929,109 @@ bool DBManager::getAllDoctorsScheduleOverview(QJsonArray& doctorsSchedule) {
     return true;
 }
 
-// 创建预约相关的数据库触发器
-void DBManager::createAppointmentTriggers() {
-    QSqlQuery query(m_db);
-    
-    // 删除可能已存在的触发器
-    query.exec("DROP TRIGGER IF EXISTS appointment_stats_update");
-    query.exec("DROP TRIGGER IF EXISTS appointment_stats_insert");
-    query.exec("DROP TRIGGER IF EXISTS appointment_stats_delete");
-    
-    // 创建预约统计缓存表（如果不存在）
-    if (!m_db.tables().contains("appointment_stats_cache")) {
-        QString createCacheTable = R"(
-            CREATE TABLE appointment_stats_cache (
+// 预约统计：清理早期版本遗留的触发器，并创建统计缓存表
+bool DBManager::createAppointmentStatsCache() {
+    return execSchema({
+        "DROP TRIGGER IF EXISTS appointment_stats_update",
+        "DROP TRIGGER IF EXISTS appointment_stats_insert",
+        "DROP TRIGGER IF EXISTS appointment_stats_delete",
+        R"(
+            CREATE TABLE IF NOT EXISTS appointment_stats_cache (
                 doctor_username TEXT PRIMARY KEY,
                 appointment_date DATE,
                 current_count INTEGER DEFAULT 0,
                 last_updated DATETIME DEFAULT CURRENT_TIMESTAMP,
                 UNIQUE(doctor_username, appointment_date)
             )
-        )";
-        if (!query.exec(createCacheTable)) {
-            qDebug() << "创建appointment_stats_cache表失败:" << query.lastError().text();
+        )",
+    });
+}
+
+bool DBManager::createQueryIndexes() {
+    // 按医生/患者列出预约、病历、处方、住院记录的查询此前都是全表扫描
+    return execSchema({
+        "CREATE INDEX IF NOT EXISTS idx_appointments_doctor_date ON appointments(doctor_username, appointment_date)",
+        "CREATE INDEX IF NOT EXISTS idx_appointments_patient ON appointments(patient_username)",
+        "CREATE INDEX IF NOT EXISTS idx_medical_records_patient ON medical_records(patient_username)",
+        "CREATE INDEX IF NOT EXISTS idx_prescriptions_patient ON prescriptions(patient_username)",
+        "CREATE INDEX IF NOT EXISTS idx_hospitalizations_doctor ON hospitalizations(doctor_username)",
+    });
+}
+
+bool DBManager::createAppointmentCounters() {
+    // appointment_counters：每个 (医生, 日期, 状态) 一行预约数，由 appointments 上的触发器在同一事务内增减，
+    // 排班概览直接按主键读取，不再对 appointments 做 COUNT(*)。
+    // 日期统一为 date() 规范形式（无法解析时保留原值），取代只能按医生存一行的 appointment_stats_cache
+    return execSchema({
+        R"(
+            CREATE TABLE IF NOT EXISTS appointment_counters (
+                doctor_username  TEXT NOT NULL,
+                appointment_date TEXT NOT NULL,
+                status           TEXT NOT NULL,
+                count            INTEGER NOT NULL DEFAULT 0,
+                PRIMARY KEY (doctor_username, appointment_date, status)
+            ) WITHOUT ROWID
+        )",
+        R"(
+            INSERT OR REPLACE INTO appointment_counters (doctor_username, appointment_date, status, count)
+            SELECT doctor_username, COALESCE(date(appointment_date), appointment_date), COALESCE(status, ''), COUNT(*)
+            FROM appointments
+            GROUP BY 1, 2, 3
+        )",
+        R"(
+            CREATE TRIGGER IF NOT EXISTS appointment_counters_insert AFTER INSERT ON appointments
+            BEGIN
+                INSERT INTO appointment_counters (doctor_username, appointment_date, status, count)
+                VALUES (NEW.doctor_username, COALESCE(date(NEW.appointment_date), NEW.appointment_date),
+                        COALESCE(NEW.status, ''), 1)
+                ON CONFLICT(doctor_username, appointment_date, status) DO UPDATE SET count = count + 1;
+            END
+        )",
+        R"(
+            CREATE TRIGGER IF NOT EXISTS appointment_counters_delete AFTER DELETE ON appointments
+            BEGIN
+                UPDATE appointment_counters SET count = count - 1
+                WHERE doctor_username = OLD.doctor_username
+                  AND appointment_date = COALESCE(date(OLD.appointment_date), OLD.appointment_date)
+                  AND status = COALESCE(OLD.status, '');
+            END
+        )",
+        R"(
+            CREATE TRIGGER IF NOT EXISTS appointment_counters_update
+            AFTER UPDATE OF doctor_username, appointment_date, status ON appointments
+            WHEN OLD.doctor_username IS NOT NEW.doctor_username
+              OR OLD.appointment_date IS NOT NEW.appointment_date
+              OR OLD.status IS NOT NEW.status
+            BEGIN
+                UPDATE appointment_counters SET count = count - 1
+                WHERE doctor_username = OLD.doctor_username
+                  AND appointment_date = COALESCE(date(OLD.appointment_date), OLD.appointment_date)
+                  AND status = COALESCE(OLD.status, '');
+                INSERT INTO appointment_counters (doctor_username, appointment_date, status, count)
+                VALUES (NEW.doctor_username, COALESCE(date(NEW.appointment_date), NEW.appointment_date),
+                        COALESCE(NEW.status, ''), 1)
+                ON CONFLICT(doctor_username, appointment_date, status) DO UPDATE SET count = count + 1;
+            END
+        )",
+        "DROP TABLE IF EXISTS appointment_stats_cache",
+    });
+}
+
+bool DBManager::execSchema(std::initializer_list<const char*> statements) {
+    QSqlQuery q(m_db);
+    for (const char* sql : statements) {
+        if (!q.exec(QString::fromUtf8(sql))) {
+            qWarning() << "执行表结构语句失败:" << q.lastError().text() << "\n" << sql;
+            return false;
         }
     }
-    
-    qDebug() << "预约统计触发器创建完成";
+    return true;
 }
 
 int DBManager::getLastInsertId() {
-    QSqlQuery query(m_db);
-    if (query.exec("SELECT last_insert_rowid() AS id") && query.next()) {
+    auto queryStmt = statement(Stmt::LastInsertId, "SELECT last_insert_rowid() AS id");
+    QSqlQuery &query = *queryStmt;
+    if (query.exec() && query.next()) {
         return query.value("id").toInt();
     }
     return -1;  // 返回-1表示获取失败
@@ -8,12 +8,30 @@
 #include <QJsonArray>
 #include <QString>
 #include <QDateTime>
+#include <QVector>
+#include <initializer_list>
 
 class DBManager {
 public:
-    DBManager(const QString& path);
+    // Bootstrap：打开连接并执行表结构迁移，并把数据库切换到 WAL 日志模式（仅启动时一次）
+    // Pooled：由 DBConnectionPool 按线程创建的只读连接，不检查表结构
+    // Writer：DBWriteQueue 写线程独占的唯一读写连接，所有写入经由它提交
+    enum class OpenMode { Bootstrap, Pooled, Writer };
+
+    explicit DBManager(const QString& path, OpenMode mode = OpenMode::Bootstrap);
     ~DBManager();
 
+    bool isOpen() const { return m_db.isOpen(); }
+    // 仅对引导连接有意义：表结构是否已迁移到最新版本
+    bool isSchemaReady() const { return m_schemaReady; }
+
+    // 预编译语句缓存的命中/未命中次数（所有连接累计）
+    struct StatementCacheStats {
+        quint64 hits = 0;
+        quint64 misses = 0;
+    };
+    static StatementCacheStats statementCacheStats();
+
     // 原有接口保持兼容
     bool authenticateUser(const QString& username, const QString& password);
     bool addUser(const QString& username, const QString& password, const QString& role);
@@ -35,9 +53,13 @@ public:
 
     // 新增扩展功能
     bool createAppointment(const QJsonObject& appointmentData);
+    // 原子预约：名额检查与插入在同一条语句内完成，成功时返回新预约 id；
+    // 名额已满、预约时间无效或不在出诊时间内时拒绝并设置 errorMessage（面向用户的提示）；医生当天没有排班时不限名额
+    bool bookAppointment(const QJsonObject& appointmentData, int& appointmentId, QString& errorMessage);
     bool getAppointmentsByPatient(const QString& patientUsername, QJsonArray& appointments);
     bool getAppointmentsByDoctor(const QString& doctorUsername, QJsonArray& appointments);
     bool updateAppointmentStatus(int appointmentId, const QString& status);
+    bool getAppointmentById(int appointmentId, QJsonObject& appointment); // {id, doctor_username, patient_username, appointment_date, appointment_time, status}
     bool deleteAppointment(int appointmentId);
     
     // 增强的预约排班管理
@@ -94,7 +116,7 @@ public:
     // 住院信息（统一采用上方“住院管理”的新接口）
 
     // 考勤与请假
-    bool createAttendanceRecord(const QJsonObject &data); // {doctor_username, checkin_date, checkin_time}
+    bool createAttendanceRecord(const QJsonObject &data, int *insertedId = nullptr); // {doctor_username, checkin_date, checkin_time}
     bool createLeaveRequest(const QJsonObject &data);     // {doctor_username, leave_date, reason}
     bool getActiveLeavesByDoctor(const QString &doctorUsername, QJsonArray &leaves); // status='active'
     bool cancelLeaveById(int leaveId);                    // 将 status 置为 'cancelled'
@@ -107,31 +129,130 @@ public:
 
     // 聊天相关（简化实现）
     bool addChatMessage(const QJsonObject &msg, int &insertedId, QString &errorMessage);
+    // 同 addChatMessage 但不自行开启事务，须在外层事务内调用（DBWriteQueue 的批次）
+    bool insertChatMessage(const QJsonObject &msg, int &insertedId, QString &errorMessage);
     bool getChatHistory(const QString &doctorUsername, const QString &patientUsername,
                         qint64 beforeId, int limit, QJsonArray &out);
     bool getMessagesSinceForUser(const QString &username, qint64 cursor, int limit, QJsonArray &out);
-    bool getRecentContactsForUser(const QString &username, int limit, QJsonArray &out);
+    bool getRecentContactsForUser(const QString &username, int limit, QJsonArray &out); // [{username, last_id, unread}]
+    bool markConversationRead(const QString &username, const QString &peer);
+
+    // 内容寻址文件对象（FileStore）的引用计数：上传完成时登记（计数为 0），聊天附件等引用方各加 1
+    bool registerFileObject(const QString &hash, qint64 size);
+    bool getFileObject(const QString &hash, QJsonObject &out);
+    // 上传文件名到内容哈希的映射：按名下载（FileDownloadRequest{ name }）经此解析到 FileStore；同名后传覆盖先传
+    bool registerFileName(const QString &name, const QString &hash);
+    bool getFileHashByName(const QString &name, QString &hash);
+
+    // 患者钱包（健康评估充值）：无记录时余额视为 0
+    bool getWalletBalance(const QString &patientUsername, double &balance);
+    bool adjustWalletBalance(const QString &patientUsername, double delta, double &newBalance, QString &errorMessage);
 
 private:
+    DBManager(const DBManager&) = delete;
+    DBManager& operator=(const DBManager&) = delete;
+
+    // 热点语句的编译期 id：每条连接首次使用时 prepare 一次，之后只重新绑定参数并复位执行
+    // 同一 id 在所有调用处必须对应同一条 SQL
+    enum class Stmt {
+        AuthenticateUser,
+        GetUserRole,
+        GetDoctorInfo,
+        GetPatientInfo,
+        GetAppointmentById,
+        UpdateAppointmentStatus,
+        GetDoctorsScheduleOverview,
+        GetDoctorScheduleStats,
+        GetBookingSchedule,
+        BookAppointment,
+        CreateAttendance,
+        GetAttendanceByDoctor,
+        InsertChatMessage,
+        AddFileObjectRef,
+        InsertChatInbox,
+        UpsertChatConversation,
+        GetChatHistory,
+        GetMessagesSince,
+        GetRecentContacts,
+        MarkConversationRead,
+        RegisterFileObject,
+        GetFileObject,
+        RegisterFileName,
+        GetFileHashByName,
+        GetWalletBalance,
+        AdjustWalletBalance,
+        LastInsertId,
+        Count
+    };
+
+    struct CachedStatement {
+        QSqlQuery query;
+        bool busy = false;
+    };
+
+    // 借用缓存语句：析构时 finish() 复位语句（释放读快照），语句本身留在缓存中；
+    // 同一语句在本连接上已被借出（嵌套调用）时退化为一次性语句
+    class StatementRef {
+    public:
+        StatementRef(CachedStatement* cached, QSqlQuery* transient) : m_cached(cached), m_transient(transient) {}
+        StatementRef(StatementRef&& other) noexcept : m_cached(other.m_cached), m_transient(other.m_transient) {
+            other.m_cached = nullptr;
+            other.m_transient = nullptr;
+        }
+        ~StatementRef();
+        QSqlQuery& operator*() const { return m_cached ? m_cached->query : *m_transient; }
+        QSqlQuery* operator->() const { return &**this; }
+
+    private:
+        StatementRef(const StatementRef&) = delete;
+        StatementRef& operator=(const StatementRef&) = delete;
+
+        CachedStatement* m_cached;
+        QSqlQuery* m_transient;
+    };
+
+    StatementRef statement(Stmt id, const char* sql);
+
+    friend class DBWriteQueue; // 写线程在本连接上管理批次事务与保存点
     QSqlDatabase m_db;
-    void initDatabase();
+    QVector<CachedStatement*> m_statements; // 下标为 Stmt，未用过的为 nullptr
+    quint64 m_statementHits = 0;
+    quint64 m_statementMisses = 0;
+    OpenMode m_mode;
+    bool m_inBatch = false; // 写线程批次事务进行中（由 DBWriteQueue 置位）
+    bool m_schemaReady = true; // 引导连接：表结构是否已迁移到最新版本
+    bool initDatabase();
+    void applyPragmas();
+
+    // 多语句写入的事务：独立使用时 BEGIN/COMMIT；处于写线程批次事务内时改用保存点嵌套
+    bool beginTransaction();
+    bool commitTransaction();
+    void rollbackTransaction();
     
-    // 表创建方法
-    void createUsersTable();
-    void createDoctorsTable();
-    void createPatientsTable();
-    void createAppointmentsTable();
-    void createMedicalRecordsTable();
-    void createMedicalAdvicesTable();
-    void createPrescriptionsTable();
-    void createPrescriptionItemsTable();
-    void createMedicationsTable();
-    void createDoctorSchedulesTable();
-    void createHospitalizationsTable();
-    void createAttendanceTable();
-    void createLeaveRequestsTable();
-    void createChatMessagesTable();
-    void createAppointmentTriggers();
+    // 表结构迁移步骤（仅 Bootstrap 时经 SchemaMigrator 执行一次，均可在已有表的旧库上重复执行）
+    bool createUsersTable();
+    bool createDoctorsTable();
+    bool addDoctorPhotoColumn();
+    bool createPatientsTable();
+    bool createAppointmentsTable();
+    bool createMedicalRecordsTable();
+    bool createMedicalAdvicesTable();
+    bool createPrescriptionsTable();
+    bool createPrescriptionItemsTable();
+    bool createMedicationsTable();
+    bool createDoctorSchedulesTable();
+    bool createHospitalizationsTable();
+    bool createAttendanceTable();
+    bool createLeaveRequestsTable();
+    bool createChatMessagesTable();
+    bool createChatInboxTables();
+    bool createFileObjectsTable();
+    bool createFileNamesTable();
+    bool createPatientWalletsTable();
+    bool createAppointmentStatsCache();
+    bool createQueryIndexes();
+    bool createAppointmentCounters();
+    bool execSchema(std::initializer_list<const char*> statements);
     
     // 示例数据插入
     void insertSampleMedications();
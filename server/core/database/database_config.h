@@ -4,6 +4,8 @@
 #include <QString>
 #include <QDir>
 #include <QCoreApplication>
+#include <QStringList>
+#include <QtGlobal>
 
 class DatabaseConfig {
 public:
@@ -15,6 +17,37 @@ public:
         }
         return dir.filePath("data/user.db");
     }
+
+    // SQLite 连接选项：多个工作线程各持一个连接并发访问同一文件时，
+    // 写锁冲突先等待而不是立即返回 SQLITE_BUSY
+    static QString getConnectOptions() {
+        return QStringLiteral("QSQLITE_BUSY_TIMEOUT=5000");
+    }
+
+    // 读连接以只读方式打开：WAL 模式下读取不阻塞写线程，也不会被写入阻塞
+    static QString getReadOnlyConnectOptions() {
+        return QStringLiteral("QSQLITE_OPEN_READONLY;QSQLITE_BUSY_TIMEOUT=5000");
+    }
+
+    // 每条连接打开后执行的 PRAGMA，可用环境变量覆盖：
+    // - MEDICAL_DB_SYNCHRONOUS：WAL 下默认 NORMAL（只在检查点 fsync，掉电最多丢失最近提交，不会损坏）
+    // - MEDICAL_DB_MMAP_SIZE：内存映射读取的字节数，默认 256MB，0 表示关闭
+    // - MEDICAL_DB_CACHE_KB：每连接页缓存大小（KB），默认 16MB
+    static QStringList getConnectionPragmas() {
+        const QString synchronous = qEnvironmentVariable("MEDICAL_DB_SYNCHRONOUS", QStringLiteral("NORMAL")).toUpper();
+        bool ok = false;
+        qint64 mmapSize = qEnvironmentVariable("MEDICAL_DB_MMAP_SIZE").toLongLong(&ok);
+        if (!ok || mmapSize < 0) mmapSize = 256LL * 1024 * 1024;
+        qint64 cacheKb = qEnvironmentVariable("MEDICAL_DB_CACHE_KB").toLongLong(&ok);
+        if (!ok || cacheKb <= 0) cacheKb = 16 * 1024;
+        static const QStringList modes{"OFF", "NORMAL", "FULL", "EXTRA"};
+        return {
+            QStringLiteral("PRAGMA synchronous=%1").arg(modes.contains(synchronous) ? synchronous : QStringLiteral("NORMAL")),
+            QStringLiteral("PRAGMA mmap_size=%1").arg(mmapSize),
+            QStringLiteral("PRAGMA cache_size=-%1").arg(cacheKb), // 负值按 KB 计
+            QStringLiteral("PRAGMA temp_store=MEMORY"),
+        };
+    }
 };
 
 #endif // DATABASE_CONFIG_H
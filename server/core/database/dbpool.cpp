@@ -0,0 +1,85 @@
+#include "dbpool.h"
+#include "database_config.h"
+#include <QMutexLocker>
+#include <QThread>
+#include <QDebug>
+
+DBConnectionPool& DBConnectionPool::instance() {
+    static DBConnectionPool pool;
+    return pool;
+}
+
+bool DBConnectionPool::bootstrap(const QString& path) {
+    QMutexLocker locker(&m_mutex);
+    if (m_bootstrapped) {
+        return m_path == path;
+    }
+    m_path = path;
+    {
+        // 一次性完成建表/迁移/触发器，随后释放该引导连接
+        DBManager init(path, DBManager::OpenMode::Bootstrap);
+        if (!init.isOpen()) {
+            qWarning() << "[DBPool] 数据库初始化失败:" << path;
+            return false;
+        }
+        if (!init.isSchemaReady()) {
+            qWarning() << "[DBPool] 表结构迁移失败，拒绝使用未迁移完成的数据库:" << path;
+            return false;
+        }
+    }
+    m_bootstrapped = true;
+    qDebug() << "[DBPool] 数据库已初始化:" << path;
+    return true;
+}
+
+DBManager* DBConnectionPool::local() {
+    if (m_local.hasLocalData()) {
+        return m_local.localData();
+    }
+    auto* db = new DBManager(readyPath(), DBManager::OpenMode::Pooled);
+    m_local.setLocalData(db);
+    int count = 0;
+    {
+        QMutexLocker locker(&m_mutex);
+        count = ++m_openConnections;
+    }
+    qDebug() << "[DBPool] 线程" << QThread::currentThread() << "打开连接，当前连接数:" << count;
+    return db;
+}
+
+DBManager* DBConnectionPool::openWriter() {
+    auto* db = new DBManager(readyPath(), DBManager::OpenMode::Writer);
+    qDebug() << "[DBPool] 线程" << QThread::currentThread() << "打开写连接";
+    return db;
+}
+
+QString DBConnectionPool::readyPath() {
+    QString path;
+    bool ready = false;
+    {
+        QMutexLocker locker(&m_mutex);
+        path = m_path;
+        ready = m_bootstrapped;
+    }
+    if (!ready) {
+        // 未显式 bootstrap（如单独调试某模块）时按默认路径懒初始化
+        bootstrap(path.isEmpty() ? DatabaseConfig::getDatabasePath() : path);
+        path = databasePath();
+    }
+    return path;
+}
+
+QString DBConnectionPool::databasePath() const {
+    QMutexLocker locker(&m_mutex);
+    return m_path;
+}
+
+int DBConnectionPool::openConnections() const {
+    QMutexLocker locker(&m_mutex);
+    return m_openConnections;
+}
+
+void DBConnectionPool::connectionClosed() {
+    QMutexLocker locker(&m_mutex);
+    --m_openConnections;
+}
@@ -0,0 +1,66 @@
+#ifndef DBPOOL_H
+#define DBPOOL_H
+
+#include <QString>
+#include <QMutex>
+#include <QThreadStorage>
+#include "database.h"
+
+// 数据库连接池：按线程持有长生命周期的 DBManager 连接
+// - 表结构迁移（SchemaMigrator，按 schema_version 补齐未应用的版本）只在 bootstrap() 时执行一次，并将数据库切换为 WAL 模式
+// - 之后每个线程首次 local() 时按 Pooled 模式打开只读连接，除连接级 PRAGMA 外不做任何表结构检查
+// - 写入不经过池化连接：全部交给 DBWriteQueue，由其写线程通过 openWriter() 持有唯一的读写连接
+// - 连接随线程结束由 QThreadStorage 自动释放
+class DBConnectionPool {
+public:
+    static DBConnectionPool& instance();
+
+    // 启动时调用一次：记录数据库路径并完成表结构初始化；未能迁移到最新版本时返回 false
+    bool bootstrap(const QString& path);
+
+    // 获取当前线程的只读连接（不存在则创建）；未 bootstrap 时按默认路径懒初始化
+    DBManager* local();
+
+    // 打开写连接（调用方拥有，仅供 DBWriteQueue 写线程使用）
+    DBManager* openWriter();
+
+    QString databasePath() const;
+    int openConnections() const;
+
+private:
+    DBConnectionPool() = default;
+    DBConnectionPool(const DBConnectionPool&) = delete;
+    DBConnectionPool& operator=(const DBConnectionPool&) = delete;
+
+    void connectionClosed();
+    QString readyPath();
+
+    mutable QMutex m_mutex;
+    QString m_path;
+    bool m_bootstrapped = false;
+    int m_openConnections = 0;
+    QThreadStorage<DBManager*> m_local;
+
+    friend class DBManager;
+};
+
+// 连接租约：在处理函数内替代 `DBManager db(path)` 的写法
+//   DBLease db;
+//   db->getDoctorInfo(...);
+// 租约本身不拥有连接，只是对当前线程连接的轻量引用，不可跨线程传递。
+class DBLease {
+public:
+    DBLease() : m_db(DBConnectionPool::instance().local()) {}
+
+    DBManager* operator->() const { return m_db; }
+    DBManager& operator*() const { return *m_db; }
+    DBManager* get() const { return m_db; }
+
+private:
+    DBLease(const DBLease&) = delete;
+    DBLease& operator=(const DBLease&) = delete;
+
+    DBManager* m_db;
+};
+
+#endif // DBPOOL_H
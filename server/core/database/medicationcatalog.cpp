@@ -0,0 +1,145 @@
+#include "medicationcatalog.h"
+#include "dbpool.h"
+#include <QMutexLocker>
+#include <QSet>
+#include <QDebug>
+#include <QElapsedTimer>
+#include <algorithm>
+
+namespace {
+// 不在药品检索中展示的医疗器械
+const QSet<QString>& medicalDevices() {
+    static const QSet<QString> devices { "血糖试纸", "电子体温计", "一次性医用口罩" };
+    return devices;
+}
+
+// 升序下标列表求交集
+QVector<int> intersect(const QVector<int>& a, const QVector<int>& b) {
+    QVector<int> out;
+    out.reserve(qMin(a.size(), b.size()));
+    std::set_intersection(a.cbegin(), a.cend(), b.cbegin(), b.cend(), std::back_inserter(out));
+    return out;
+}
+}
+
+MedicationCatalog& MedicationCatalog::instance() {
+    static MedicationCatalog catalog;
+    return catalog;
+}
+
+void MedicationCatalog::invalidate() {
+    QMutexLocker locker(&m_mutex);
+    m_snapshot.reset();
+}
+
+int MedicationCatalog::size() {
+    SnapshotPtr snap = snapshot();
+    return snap ? snap->items.size() : 0;
+}
+
+MedicationCatalog::SnapshotPtr MedicationCatalog::snapshot() {
+    // 重建期间持锁，避免多个线程同时整表载入
+    QMutexLocker locker(&m_mutex);
+    if (!m_snapshot) {
+        bool ok = false;
+        SnapshotPtr snap = build(ok);
+        if (ok) m_snapshot = snap;
+    }
+    return m_snapshot;
+}
+
+MedicationCatalog::SnapshotPtr MedicationCatalog::build(bool& ok) {
+    QElapsedTimer timer;
+    timer.start();
+    QJsonArray rows;
+    DBLease db;
+    ok = db->getMedications(rows);
+    if (!ok) {
+        qWarning() << "[MedicationCatalog] 载入药品失败";
+        return SnapshotPtr();
+    }
+
+    QVector<QJsonObject> items;
+    items.reserve(rows.size());
+    for (const auto& v : rows) {
+        QJsonObject o = v.toObject();
+        if (!medicalDevices().contains(o.value("name").toString())) items.push_back(o);
+    }
+    std::stable_sort(items.begin(), items.end(), [](const QJsonObject& a, const QJsonObject& b) {
+        return a.value("id").toInt() < b.value("id").toInt();
+    });
+
+    auto* snap = new Snapshot;
+    snap->items = items;
+    snap->keys.reserve(items.size());
+    for (int i = 0; i < items.size(); ++i) {
+        const QJsonObject& o = items[i];
+        snap->all.append(o);
+        // 两个字段之间用换行分隔，避免跨字段拼出的二元组产生误命中
+        const QString key = (o.value("name").toString() + QLatin1Char('\n')
+                             + o.value("generic_name").toString()).toCaseFolded();
+        snap->keys.push_back(key);
+        QSet<QChar> seenChars;
+        QSet<quint32> seenPairs;
+        for (int c = 0; c < key.size(); ++c) {
+            if (key[c] == QLatin1Char('\n')) continue;
+            if (!seenChars.contains(key[c])) {
+                seenChars.insert(key[c]);
+                snap->unigrams[key[c]].push_back(i);
+            }
+            if (c + 1 < key.size() && key[c + 1] != QLatin1Char('\n')) {
+                const quint32 k = bigramKey(key[c], key[c + 1]);
+                if (!seenPairs.contains(k)) {
+                    seenPairs.insert(k);
+                    snap->bigrams[k].push_back(i);
+                }
+            }
+        }
+    }
+    qDebug() << "[MedicationCatalog] 已载入药品" << items.size() << "条，二元组" << snap->bigrams.size()
+             << "个，耗时(ms)" << timer.elapsed();
+    return SnapshotPtr(snap);
+}
+
+bool MedicationCatalog::all(QJsonArray& out) {
+    SnapshotPtr snap = snapshot();
+    if (!snap) return false;
+    out = snap->all;
+    return true;
+}
+
+bool MedicationCatalog::search(const QString& keyword, QJsonArray& out) {
+    SnapshotPtr snap = snapshot();
+    if (!snap) return false;
+    const QString kw = keyword.trimmed().toCaseFolded();
+    if (kw.isEmpty()) {
+        out = snap->all;
+        return true;
+    }
+
+    QVector<int> candidates;
+    if (kw.size() == 1) {
+        candidates = snap->unigrams.value(kw[0]);
+    } else {
+        // 以最短的倒排表为起点逐个求交，任一二元组缺失即无结果
+        QVector<const QVector<int>*> lists;
+        for (int c = 0; c + 1 < kw.size(); ++c) {
+            auto it = snap->bigrams.constFind(bigramKey(kw[c], kw[c + 1]));
+            if (it == snap->bigrams.constEnd()) return true;
+            lists.push_back(&it.value());
+        }
+        std::sort(lists.begin(), lists.end(), [](const QVector<int>* a, const QVector<int>* b) {
+            return a->size() < b->size();
+        });
+        candidates = *lists.first();
+        for (int l = 1; l < lists.size() && !candidates.isEmpty(); ++l) {
+            candidates = intersect(candidates, *lists[l]);
+        }
+    }
+
+    // 二元组命中不保证连续出现，最终按子串校验；下标升序即 id 升序
+    for (int i : candidates) {
+        if (kw.size() <= 2 || snap->keys[i].contains(kw)) out.append(snap->items[i]);
+    }
+    return true;
+}
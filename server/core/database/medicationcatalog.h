@@ -0,0 +1,52 @@
+#ifndef MEDICATIONCATALOG_H
+#define MEDICATIONCATALOG_H
+
+#include <QHash>
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QMutex>
+#include <QSharedPointer>
+#include <QString>
+#include <QVector>
+
+// 药品目录：medications 表的只读内存快照 + 预计算检索索引
+// - 首次查询时从数据库整表载入一次，排除医疗器械并按 id 升序排好
+// - 对 name/generic_name（大小写折叠后）建立单字与二元组倒排索引，关键字检索只需求交集再校验候选
+// - 药品写入（DBManager::addMedication）提交后才能调用 invalidate()，下一次查询重建快照：
+//   写操作内以 DBWriteQueue::afterCommit 登记，提交前清空会让读连接按旧数据重建并缓存
+// 快照不可变，查询线程拿到共享指针后无需持锁，可被业务线程池并发访问。
+class MedicationCatalog {
+public:
+    static MedicationCatalog& instance();
+
+    // 全部药品，按 id 升序
+    bool all(QJsonArray& out);
+    // name 或 generic_name 包含关键字（不区分大小写）的药品，按 id 升序；空关键字等同 all()
+    bool search(const QString& keyword, QJsonArray& out);
+
+    void invalidate();
+    int size();
+
+private:
+    MedicationCatalog() = default;
+    MedicationCatalog(const MedicationCatalog&) = delete;
+    MedicationCatalog& operator=(const MedicationCatalog&) = delete;
+
+    struct Snapshot {
+        QJsonArray all;                          // 已排序的完整结果，all() 直接返回（隐式共享）
+        QVector<QJsonObject> items;              // 与 all 同序
+        QVector<QString> keys;                   // 折叠后的 "name\ngeneric_name"
+        QHash<quint32, QVector<int>> bigrams;    // 二元组 -> 升序下标
+        QHash<QChar, QVector<int>> unigrams;     // 单字 -> 升序下标
+    };
+    using SnapshotPtr = QSharedPointer<const Snapshot>;
+
+    SnapshotPtr snapshot();
+    static SnapshotPtr build(bool& ok);
+    static quint32 bigramKey(QChar a, QChar b) { return (quint32(a.unicode()) << 16) | b.unicode(); }
+
+    QMutex m_mutex;
+    SnapshotPtr m_snapshot;
+};
+
+#endif // MEDICATIONCATALOG_H
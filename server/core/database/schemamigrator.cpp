@@ -0,0 +1,60 @@
+#include "schemamigrator.h"
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QSqlError>
+#include <QSqlQuery>
+
+int SchemaMigrator::currentVersion(QSqlDatabase& db) {
+    QSqlQuery q(db);
+    if (!q.exec("SELECT COALESCE(MAX(version), 0) FROM schema_version") || !q.next()) {
+        qWarning() << "[SchemaMigrator] 读取 schema_version 失败:" << q.lastError().text();
+        return -1;
+    }
+    return q.value(0).toInt();
+}
+
+int SchemaMigrator::migrate(QSqlDatabase& db, const QList<Step>& steps) {
+    QSqlQuery q(db);
+    if (!q.exec(R"(
+        CREATE TABLE IF NOT EXISTS schema_version (
+            version     INTEGER PRIMARY KEY,
+            description TEXT,
+            applied_at  DATETIME DEFAULT CURRENT_TIMESTAMP
+        )
+    )")) {
+        qWarning() << "[SchemaMigrator] 创建 schema_version 表失败:" << q.lastError().text();
+        return -1;
+    }
+    int version = currentVersion(db);
+    if (version < 0) return -1;
+
+    for (const Step& step : steps) {
+        if (step.version <= version) continue;
+        QElapsedTimer timer;
+        timer.start();
+        if (!db.transaction()) {
+            qWarning() << "[SchemaMigrator] 无法开启事务:" << db.lastError().text();
+            return version;
+        }
+        bool ok = step.apply();
+        if (ok) {
+            QSqlQuery record(db);
+            record.prepare("INSERT INTO schema_version (version, description) VALUES (:v, :d)");
+            record.bindValue(":v", step.version);
+            record.bindValue(":d", step.description);
+            ok = record.exec();
+            if (!ok) qWarning() << "[SchemaMigrator] 记录版本失败:" << record.lastError().text();
+        }
+        if (!ok || !db.commit()) {
+            db.rollback();
+            qWarning().noquote() << QString("[SchemaMigrator] 迁移到版本 %1（%2）失败，停留在版本 %3")
+                                        .arg(step.version).arg(step.description).arg(version);
+            return version;
+        }
+        version = step.version;
+        qDebug().noquote() << QString("[SchemaMigrator] 已应用版本 %1：%2（%3ms）")
+                                  .arg(step.version).arg(step.description).arg(timer.elapsed());
+    }
+    qDebug() << "[SchemaMigrator] 表结构版本:" << version;
+    return version;
+}
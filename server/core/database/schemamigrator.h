@@ -0,0 +1,27 @@
+#ifndef SCHEMAMIGRATOR_H
+#define SCHEMAMIGRATOR_H
+
+#include <QList>
+#include <QSqlDatabase>
+#include <QString>
+#include <functional>
+
+// 表结构版本迁移：schema_version 表记录已应用的版本，服务启动时（DBConnectionPool::bootstrap）
+// 按版本号升序执行尚未应用的步骤，之后打开连接不再检查表结构
+// - 每一步与它的版本记录在同一事务内提交；失败则回滚并停止，bootstrap 随之失败、服务不启动，下次启动从该步重试
+// - 没有 schema_version 的旧库从版本 0 开始：步骤须能在表已存在的库上安全执行（IF NOT EXISTS 等）
+// - 变更表结构只追加新版本，不修改已发布的步骤
+class SchemaMigrator {
+public:
+    struct Step {
+        int version;
+        QString description;
+        std::function<bool()> apply; // 在迁移事务内执行
+    };
+
+    // 返回迁移后的版本（失败时为最后一个成功应用的版本，出错返回 -1）
+    static int migrate(QSqlDatabase& db, const QList<Step>& steps);
+    static int currentVersion(QSqlDatabase& db);
+};
+
+#endif // SCHEMAMIGRATOR_H
@@ -0,0 +1,179 @@
+#include "writequeue.h"
+#include "database.h"
+#include "dbpool.h"
+#include <QCoreApplication>
+#include <QDeadlineTimer>
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QPointer>
+#include <QScopedPointer>
+#include <QSemaphore>
+#include <QSharedPointer>
+#include <QSqlError>
+#include <QSqlQuery>
+#include <QThread>
+
+DBWriteQueue& DBWriteQueue::instance() {
+    static DBWriteQueue queue;
+    return queue;
+}
+
+DBWriteQueue::DBWriteQueue() {
+    // 写线程的连接由连接池打开：确保连接池先于本对象构造、后于本对象析构
+    DBConnectionPool::instance();
+    m_thread = QThread::create([this]() { run(); });
+    m_thread->setObjectName(QStringLiteral("db-writer"));
+    m_thread->start();
+    if (QCoreApplication::instance()) {
+        QObject::connect(QCoreApplication::instance(), &QCoreApplication::aboutToQuit, [this]() { shutdown(); });
+    }
+}
+
+DBWriteQueue::~DBWriteQueue() {
+    shutdown();
+    delete m_thread;
+}
+
+void DBWriteQueue::submit(WriteOp op, QObject* context, Completion done) {
+    QPointer<QObject> guard(context);
+    enqueue(Pending{std::move(op), [guard, done](bool ok, const QJsonObject& result) {
+        if (!guard || !done) return;
+        QMetaObject::invokeMethod(guard.data(), [guard, done, ok, result]() {
+            if (guard) done(ok, result);
+        }, Qt::QueuedConnection);
+    }});
+}
+
+bool DBWriteQueue::execute(WriteOp op, QJsonObject& result) {
+    Q_ASSERT(QThread::currentThread() != m_thread);
+    struct Waiter {
+        QSemaphore done;
+        bool ok = false;
+        QJsonObject result;
+    };
+    auto waiter = QSharedPointer<Waiter>::create();
+    enqueue(Pending{std::move(op), [waiter](bool ok, const QJsonObject& r) {
+        waiter->ok = ok;
+        waiter->result = r;
+        waiter->done.release();
+    }});
+    waiter->done.acquire();
+    result = waiter->result;
+    return waiter->ok;
+}
+
+bool DBWriteQueue::write(std::function<bool(DBManager&)> op) {
+    QJsonObject ignored;
+    return execute([op = std::move(op)](DBManager& db, QJsonObject&) { return op(db); }, ignored);
+}
+
+void DBWriteQueue::afterCommit(std::function<void()> hook) {
+    Q_ASSERT(QThread::currentThread() == m_thread);
+    m_opHooks.append(std::move(hook));
+}
+
+DBWriteQueue::Stats DBWriteQueue::stats() const {
+    QMutexLocker locker(&m_mutex);
+    return m_stats;
+}
+
+void DBWriteQueue::shutdown() {
+    {
+        QMutexLocker locker(&m_mutex);
+        if (m_stopping) return;
+        m_stopping = true;
+        m_wake.wakeAll();
+    }
+    m_thread->wait();
+}
+
+void DBWriteQueue::enqueue(Pending pending) {
+    QMutexLocker locker(&m_mutex);
+    if (m_stopping) {
+        locker.unlock();
+        if (pending.done) pending.done(false, QJsonObject{{"error", QStringLiteral("write queue stopped")}});
+        return;
+    }
+    m_queue.enqueue(std::move(pending));
+    m_wake.wakeOne();
+}
+
+void DBWriteQueue::run() {
+    // 写线程独占数据库唯一的读写连接，随写线程退出释放
+    QScopedPointer<DBManager> writer(DBConnectionPool::instance().openWriter());
+    DBManager& db = *writer;
+    QList<Pending> batch;
+    for (;;) {
+        {
+            QMutexLocker locker(&m_mutex);
+            while (m_queue.isEmpty() && !m_stopping) m_wake.wait(&m_mutex);
+            if (m_queue.isEmpty()) return; // 已停止且队列排空
+            // 攒批：等更多写入到达，直到凑满或窗口结束
+            QDeadlineTimer window(BATCH_WINDOW_MS);
+            while (m_queue.size() < MAX_BATCH && !m_stopping) {
+                if (!m_wake.wait(&m_mutex, window)) break;
+            }
+            while (!m_queue.isEmpty() && batch.size() < MAX_BATCH) batch.append(m_queue.dequeue());
+        }
+        commitBatch(db, batch);
+        for (Pending& p : batch) {
+            if (p.done) p.done(p.ok, p.result);
+        }
+        batch.clear();
+    }
+}
+
+void DBWriteQueue::commitBatch(DBManager& db, QList<Pending>& batch) {
+    QElapsedTimer timer;
+    timer.start();
+    auto failAll = [&batch](const QString& error) {
+        for (Pending& p : batch) {
+            p.ok = false;
+            p.result = QJsonObject{{"error", error}};
+        }
+    };
+    // 批次开始即取得写锁，批内的“先查后写”（如预约名额检查）看到的快照不会在提交前被其他写者改变
+    QSqlQuery sp(db.m_db);
+    if (!sp.exec(QStringLiteral("BEGIN IMMEDIATE"))) {
+        failAll(sp.lastError().text());
+    } else {
+        db.m_inBatch = true; // 写操作内部的多语句事务改用保存点嵌套
+        for (Pending& p : batch) {
+            // 每项一个保存点：失败时只撤销该项自己的修改
+            sp.exec(QStringLiteral("SAVEPOINT write_op"));
+            m_opHooks.clear();
+            p.ok = p.op(db, p.result);
+            if (!p.ok) sp.exec(QStringLiteral("ROLLBACK TO write_op"));
+            else m_batchHooks.append(m_opHooks);
+            sp.exec(QStringLiteral("RELEASE write_op"));
+        }
+        m_opHooks.clear();
+        db.m_inBatch = false;
+        if (!db.m_db.commit()) {
+            const QString error = db.m_db.lastError().text();
+            db.m_db.rollback();
+            failAll(error);
+        } else {
+            // 提交后其他连接才能读到新数据，此时再清理依赖这些数据的缓存
+            for (const auto& hook : m_batchHooks) hook();
+        }
+    }
+    m_batchHooks.clear();
+    int failed = 0;
+    for (const Pending& p : batch) {
+        if (!p.ok) ++failed;
+    }
+    {
+        QMutexLocker locker(&m_mutex);
+        ++m_stats.batches;
+        m_stats.writes += batch.size();
+        m_stats.failedWrites += failed;
+        m_stats.largestBatch = qMax(m_stats.largestBatch, batch.size());
+    }
+    // 常规批次的数量与耗时只计入 stats()，仅慢批次或含失败项的批次记日志
+    const qint64 elapsed = timer.elapsed();
+    if (failed > 0 || elapsed >= SLOW_BATCH_MS) {
+        qWarning().noquote() << QString("[ DBWriteQueue ] 批量提交 size=%1 失败=%2 耗时=%3ms")
+                                    .arg(batch.size()).arg(failed).arg(elapsed);
+    }
+}
@@ -0,0 +1,83 @@
+#ifndef WRITEQUEUE_H
+#define WRITEQUEUE_H
+
+#include <QJsonObject>
+#include <QList>
+#include <QMutex>
+#include <QObject>
+#include <QQueue>
+#include <QWaitCondition>
+#include <functional>
+
+class DBManager;
+class QThread;
+
+// 组提交写队列：数据库的全部写入都交给唯一的写线程及其读写连接（池化连接只读），按批放进同一个事务提交，
+// 高频插入（聊天消息、考勤打卡）不再各自自动提交（每行一次 fsync）；WAL 模式下提交期间读连接照常读取
+// - 写线程取到第一项后最多再等 BATCH_WINDOW_MS 或凑满 MAX_BATCH 项，然后 BEGIN…COMMIT 一次
+// - 每项在自己的 SAVEPOINT 内执行，单项失败只回滚该项，不影响同批其他写入
+// - 结果异步返回：submit 把回调投递到 context 所在线程（context 已销毁则丢弃，context 须运行事件循环）；
+//   没有事件循环的工作线程（路由器的 Concurrent 处理函数）用 execute 同步等待所在批次提交
+// - stats() 提供累计指标；只有慢批次或含失败项的批次记日志
+class DBWriteQueue {
+public:
+    // 在写线程的连接上执行（已处于批次事务内，不得直接 BEGIN/COMMIT；DBManager 的多语句写入会自动改用保存点）；
+    // result 回传给调用方，如 { id } 或 { error }
+    using WriteOp = std::function<bool(DBManager& db, QJsonObject& result)>;
+    using Completion = std::function<void(bool ok, const QJsonObject& result)>;
+
+    struct Stats {
+        quint64 batches = 0;
+        quint64 writes = 0;
+        quint64 failedWrites = 0;
+        int largestBatch = 0;
+    };
+
+    static constexpr int BATCH_WINDOW_MS = 2;
+    static constexpr int MAX_BATCH = 256;
+    static constexpr int SLOW_BATCH_MS = 100; // 达到此耗时的批次记日志
+
+    static DBWriteQueue& instance();
+
+    void submit(WriteOp op, QObject* context, Completion done);
+    // 阻塞当前线程直到所在批次提交；不可在写线程内调用
+    bool execute(WriteOp op, QJsonObject& result);
+    // 只关心成败的同步写入，如 write([&](DBManager& db) { return db.updatePatientInfo(user, data); })
+    bool write(std::function<bool(DBManager& db)> op);
+    // 仅可在写操作内（写线程）调用：登记在所在批次 COMMIT 成功后、回调结果之前执行的动作（如清空读缓存）；
+    // 该写操作失败或批次提交失败时丢弃
+    void afterCommit(std::function<void()> hook);
+
+    Stats stats() const;
+    // 处理完已排队的写入后停止写线程（应用退出前调用）
+    void shutdown();
+
+private:
+    DBWriteQueue();
+    ~DBWriteQueue();
+    DBWriteQueue(const DBWriteQueue&) = delete;
+    DBWriteQueue& operator=(const DBWriteQueue&) = delete;
+
+    struct Pending {
+        WriteOp op;
+        Completion done; // 在写线程调用
+        bool ok = false;
+        QJsonObject result;
+    };
+
+    void enqueue(Pending pending);
+    void run();
+    void commitBatch(DBManager& db, QList<Pending>& batch);
+
+    mutable QMutex m_mutex;
+    QWaitCondition m_wake;
+    QQueue<Pending> m_queue;
+    bool m_stopping = false;
+    Stats m_stats;
+    QThread* m_thread = nullptr;
+    // 以下仅由写线程访问
+    QList<std::function<void()>> m_opHooks;    // 当前写操作登记的提交后动作
+    QList<std::function<void()>> m_batchHooks; // 本批已成功写操作的提交后动作
+};
+
+#endif // WRITEQUEUE_H
@@ -2,8 +2,11 @@
 #include "core/logging/logging.h"
 #include "core/network/filetransferprocessor.h"
 #include "core/network/streamparser.h"
+#include "core/timer/timerwheel.h"
 #include <QDir>
 #include <QFile>
+#include <QJsonArray>
+#include <QThread>
 
 using namespace Protocol;
 
@@ -11,14 +14,22 @@ ClientHandler::ClientHandler(QObject* parent)
     : QObject(parent)
 {
     m_file = new FileTransferProcessor("files");
+    m_channel.reset(new ResponseChannel(this));
 }
 
 ClientHandler::~ClientHandler()
 {
+    // 先断开投递通道，之后路由器不会再向本对象投递
+    m_channel->detach();
+    // 析构在 I/O 线程执行（deleteLater），与登记定时器的时间轮同属一个线程
+    if (m_idleTimer) TimerWheel::forCurrentThread().cancel(m_idleTimer);
     if (m_socket) {
         m_socket->deleteLater();
         m_socket = nullptr;
     }
+    // I/O 线程常驻复用，连接级资源需随 handler 一并释放
+    delete m_file;
+    m_file = nullptr;
 }
 
 void ClientHandler::initialize(qintptr socketDescriptor)
@@ -34,27 +45,41 @@ void ClientHandler::initialize(qintptr socketDescriptor)
     connect(m_parser, &StreamFrameParser::frameReady, this, [this](Header header, QByteArray payload) {
         this->m_currentHeader = header;
         // 复用原有帧处理逻辑
-        QJsonObject obj = (header.type == MessageType::JsonRequest || header.type == MessageType::ErrorResponse || header.type == MessageType::JsonResponse)
+        QJsonObject obj = (header.type == MessageType::JsonRequest || header.type == MessageType::ErrorResponse || header.type == MessageType::JsonResponse
+                           || header.type == MessageType::ClientHello || header.type == MessageType::FileUploadMeta
+                           || header.type == MessageType::FileUploadComplete || header.type == MessageType::FileDownloadRequest)
                               ? fromJsonPayload(payload)
                               : QJsonObject{};
 
         switch (header.type) {
         case MessageType::JsonRequest:
-            emit requestJsonReady(this, obj);
+            emit requestJsonReady(this, header.requestId, obj);
+            break;
+        case MessageType::CborRequest:
+            // 未协商也接受 CBOR 请求；响应编码仍以协商结果为准
+            emit requestJsonReady(this, header.requestId, fromCborPayload(payload));
+            break;
+        case MessageType::ClientHello:
+            handleClientHello(obj);
             break;
         case MessageType::HeartbeatPing:
             sendMessage(MessageType::HeartbeatPong, QJsonObject());
             break;
+        case MessageType::ClientDisconnect:
+            // 客户端主动告别：发完已排队的响应后正常关闭
+            flushOutbox();
+            if (m_socket) m_socket->disconnectFromHost();
+            break;
         case MessageType::FileUploadMeta: {
-            QJsonObject out;
-            if (!m_file->beginUpload(obj, out)) {
-                sendMessage(MessageType::FileTransferError, out);
-            } else {
-                sendMessage(MessageType::JsonResponse, out);
-            }
+            // 新上传或续传：回送缺失块列表，客户端据此（重新）发送；秒传的 ack 在数据库登记提交后才回送
+            QSharedPointer<ResponseChannel> channel = m_channel;
+            m_file->beginUpload(obj, this, [channel](bool ok, const QJsonObject& out) {
+                channel->send(ok ? MessageType::FileUploadAck : MessageType::FileTransferError, out);
+            });
             break;
         }
         case MessageType::FileUploadChunk: {
+            // 成功的块不逐个确认；失败（如 CRC 不符）带 upload_id/offset 回报，客户端重发该块
             QJsonObject err;
             if (!m_file->appendChunk(payload, err)) {
                 sendMessage(MessageType::FileTransferError, err);
@@ -62,67 +87,182 @@ void ClientHandler::initialize(qintptr socketDescriptor)
             break;
         }
         case MessageType::FileUploadComplete: {
-            QJsonObject result;
-            if (!m_file->finishUpload(result)) {
-                sendMessage(MessageType::FileTransferError, result);
-            } else {
-                sendMessage(MessageType::JsonResponse, result);
-            }
+            // 到齐后的整文件哈希在线程池中进行，应答经 ResponseChannel 回到本线程发送，I/O 线程不被阻塞
+            QSharedPointer<ResponseChannel> channel = m_channel;
+            m_file->finishUpload(obj, [channel](bool ok, const QJsonObject& out) {
+                channel->send(ok ? MessageType::FileUploadAck : MessageType::FileTransferError, out);
+            });
             break;
         }
-        case MessageType::FileDownloadRequest: {
-            QJsonObject complete;
-            bool ok = m_file->downloadWhole(obj, [this](const QByteArray& data) {
-                this->sendBinary(MessageType::FileDownloadChunk, data);
-            }, complete);
-            if (!ok) {
-                sendMessage(MessageType::FileTransferError, complete);
-            } else {
-                sendMessage(MessageType::FileDownloadComplete, complete);
-            }
+        case MessageType::FileDownloadRequest:
+            // { blob } 按内容哈希从 BlobStore 下载，否则按 { name, offset?, length? } 下载文件；
+            // 数据块按发送窗口在 pumpDownloads 中逐步产出，与 JSON 响应交错发送
+            m_file->enqueueDownload(obj);
+            pumpDownloads();
             break;
-        }
         default:
             sendMessage(MessageType::ErrorResponse, QJsonObject{{"errorCode", 400}, {"errorMessage", QStringLiteral("Unsupported message type")}});
             break;
         }
-    });
+    }, Qt::DirectConnection); // payload 为解析器缓冲区视图，必须同步处理
     connect(m_parser, &StreamFrameParser::protocolError, this, [this](const QString& msg) {
         qWarning() << "[ Handler ] 协议错误:" << msg << ", 断开连接";
+        flushOutbox(); // 已排队的响应先交给 socket，disconnectFromHost 会等其发完
         if (m_socket) m_socket->disconnectFromHost();
     });
+    // 对端每消化一部分数据就继续推进下载，socket 写缓冲始终保持在窗口以内
+    if (!connect(m_socket, &QTcpSocket::bytesWritten, this, &ClientHandler::pumpDownloads)) {
+        Log::error("ClientHandler", "Failed to connect QTcpSocket::bytesWritten to ClientHandler::pumpDownloads");
+    }
     if (!connect(m_socket, &QTcpSocket::disconnected, this, &ClientHandler::onDisconnected)) {
         Log::error("ClientHandler", "Failed to connect QTcpSocket::disconnected to ClientHandler::onDisconnected");
     }
+    // 空闲检测挂在 I/O 线程共享的时间轮上：收到数据只记录时间，不逐次重置定时器
+    m_lastActivity.start();
+    m_idleTimer = TimerWheel::forCurrentThread().schedule(IDLE_TIMEOUT_MS, [this]() { onIdleDeadline(); });
 }
 
 void ClientHandler::sendMessage(MessageType type, const QJsonObject& obj)
 {
-    if (!m_socket)
-        return;
-    QByteArray payload = toJsonPayload(obj);
-    QByteArray data = pack(type, payload);
-    // qInfo() << "[ Handler ] 发送消息 type=" << (quint16)type << ", 总字节=" << data.size();
-    m_socket->write(data);
+    queueFrame(type, toJsonPayload(obj), 0, true);
 }
 
 void ClientHandler::sendMessage(MessageType type)
 {
-    if (!m_socket) return;
-    QByteArray data = pack(type, QByteArray());
-    m_socket->write(data);
+    queueFrame(type, QByteArray(), 0, false);
 }
 
 void ClientHandler::sendBinary(MessageType type, const QByteArray& bytes)
+{
+    queueFrame(type, bytes, 0, false);
+}
+
+void ClientHandler::onJsonResponseReady(const QJsonObject& obj, quint64 requestId)
+{
+    const bool cbor = m_encoding == PayloadEncoding::Cbor;
+    const MessageType type = cbor ? MessageType::CborResponse : MessageType::JsonResponse;
+    // v2 头部带回请求 id，客户端无需解析 JSON 即可关联响应
+    queueFrame(type, cbor ? toCborPayload(obj) : toJsonPayload(obj), requestId, true);
+}
+
+void ClientHandler::onPushReady(const QJsonObject& obj)
+{
+    queueFrame(MessageType::Push, toJsonPayload(obj), 0, true);
+}
+
+void ClientHandler::queueFrame(MessageType type, const QByteArray& payload, quint64 requestId, bool compressible)
 {
     if (!m_socket) return;
-    QByteArray frame = pack(type, bytes);
-    m_socket->write(frame);
+    quint16 rawType = static_cast<quint16>(type);
+    const QByteArray body = (compressible && m_compression) ? compressIfWorthwhile(rawType, payload) : payload;
+    // 头部直接写入发送缓冲，负载紧随其后；同一事件循环轮次内的所有帧合并为一次 write
+    appendFrameHeader(m_outbox, rawType, body.size(), frameTag(requestId));
+    m_outbox.append(body);
+    if (m_outbox.size() >= OUTBOX_FLUSH_BYTES) {
+        // 大块数据（如文件下载）不必等到本轮结束，及时交给 socket 以限制内存占用
+        flushOutbox();
+        return;
+    }
+    if (!m_flushScheduled) {
+        m_flushScheduled = true;
+        QMetaObject::invokeMethod(this, &ClientHandler::flushOutbox, Qt::QueuedConnection);
+    }
 }
 
-void ClientHandler::onJsonResponseReady(const QJsonObject& obj)
+void ClientHandler::flushOutbox()
 {
-    sendMessage(MessageType::JsonResponse, obj);
+    m_flushScheduled = false;
+    if (!m_socket || m_outbox.isEmpty()) return;
+    m_socket->write(m_outbox);
+    // 交给 socket 后不再复用原缓冲（socket 写缓冲可能与之共享数据）
+    m_outbox = QByteArray();
+}
+
+void ClientHandler::pumpDownloads()
+{
+    if (!m_socket || !m_file->hasPendingDownload()) return;
+    QByteArray chunk;
+    QJsonObject meta;
+    // 待发数据（socket 写缓冲 + 出站合并缓冲）低于窗口时才产出下一块
+    while (m_socket->bytesToWrite() + m_outbox.size() < DOWNLOAD_WINDOW_BYTES) {
+        switch (m_file->nextDownloadStep(chunk, meta)) {
+        case FileTransferProcessor::DownloadStep::Idle:
+            return;
+        case FileTransferProcessor::DownloadStep::Chunk:
+            sendBinary(MessageType::FileDownloadChunk, chunk);
+            break;
+        case FileTransferProcessor::DownloadStep::Complete:
+            sendMessage(MessageType::FileDownloadComplete, meta);
+            break;
+        case FileTransferProcessor::DownloadStep::Error:
+            sendMessage(MessageType::FileTransferError, meta);
+            break;
+        }
+    }
+}
+
+bool ResponseChannel::deliver(const QJsonObject& payload, quint64 requestId)
+{
+    QMutexLocker locker(&m_mutex);
+    if (!m_handler) return false;
+    ClientHandler* handler = m_handler;
+    return QMetaObject::invokeMethod(handler, [handler, payload, requestId]() {
+        handler->onJsonResponseReady(payload, requestId);
+    }, Qt::QueuedConnection);
+}
+
+bool ResponseChannel::send(Protocol::MessageType type, const QJsonObject& payload)
+{
+    QMutexLocker locker(&m_mutex);
+    if (!m_handler) return false;
+    ClientHandler* handler = m_handler;
+    return QMetaObject::invokeMethod(handler, [handler, type, payload]() {
+        handler->sendMessage(type, payload);
+    }, Qt::QueuedConnection);
+}
+
+bool ResponseChannel::push(const QJsonObject& payload)
+{
+    QMutexLocker locker(&m_mutex);
+    if (!m_handler) return false;
+    ClientHandler* handler = m_handler;
+    return QMetaObject::invokeMethod(handler, [handler, payload]() {
+        handler->onPushReady(payload);
+    }, Qt::QueuedConnection);
+}
+
+void ResponseChannel::detach()
+{
+    QMutexLocker locker(&m_mutex);
+    m_handler = nullptr;
+}
+
+bool ResponseChannel::isAttached() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_handler != nullptr;
+}
+
+void ClientHandler::handleClientHello(const QJsonObject& hello)
+{
+    // 客户端按偏好顺序列出支持的编码，服务端选第一个自己也支持的
+    m_encoding = PayloadEncoding::Json;
+    const QJsonArray encodings = hello.value("encodings").toArray();
+    for (const auto& v : encodings) {
+        const QString name = v.toString();
+        if (name == encodingName(PayloadEncoding::Cbor)) { m_encoding = PayloadEncoding::Cbor; break; }
+        if (name == encodingName(PayloadEncoding::Json)) break;
+    }
+    m_compression = hello.value("compression").toArray().contains(QStringLiteral("zlib"));
+    const quint8 headerVersion = hello.value("header_versions").toArray().contains(int(VERSION_V2)) ? VERSION_V2 : VERSION;
+    // ServerHello 仍以 v1 头部发送，之后的出站帧再切换到协商的头部版本
+    m_headerVersion = VERSION;
+    sendMessage(MessageType::ServerHello, QJsonObject{{"encoding", encodingName(m_encoding)},
+                                                      {"compression", m_compression ? "zlib" : "none"},
+                                                      {"header_version", int(headerVersion)}});
+    m_headerVersion = headerVersion;
+    qInfo() << "[ Handler ] 协商负载编码:" << encodingName(m_encoding) << ", 压缩:" << m_compression
+            << ", 头部版本:" << m_headerVersion;
 }
 
 void ClientHandler::onReadyRead()
@@ -130,7 +270,24 @@ void ClientHandler::onReadyRead()
     if (!m_socket)
         return;
     QByteArray chunk = m_socket->readAll();
-    if (!chunk.isEmpty()) m_parser->append(chunk);
+    if (chunk.isEmpty()) return;
+    m_lastActivity.restart();
+    m_parser->append(chunk);
+}
+
+void ClientHandler::onIdleDeadline()
+{
+    m_idleTimer = 0;
+    if (!m_socket) return;
+    const qint64 remaining = IDLE_TIMEOUT_MS - m_lastActivity.elapsed();
+    if (remaining > 0) {
+        m_idleTimer = TimerWheel::forCurrentThread().schedule(remaining, [this]() { onIdleDeadline(); });
+        return;
+    }
+    qWarning() << "[ Handler ] 连接空闲超过" << IDLE_TIMEOUT_MS << "ms，判定为死连接并回收";
+    // 对端已不可达，写缓冲可能永远发不完：abort 立即关闭，不等待 disconnectFromHost 的优雅关闭
+    m_socket->abort();
+    deleteLater();
 }
 
 void ClientHandler::onDisconnected()
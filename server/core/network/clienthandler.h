@@ -1,12 +1,38 @@
 #pragma once
 
 #include <QDebug>
+#include <QElapsedTimer>
+#include <QMutex>
 #include <QObject>
 #include <QPointer>
+#include <QSharedPointer>
 #include <QTcpSocket>
 
 #include "core/network/protocol.h"
 class FileTransferProcessor;
+class ClientHandler;
+
+// 路由器到某个连接的定向投递通道：
+// 由 ClientHandler 创建并在析构时 detach，路由器持有共享指针作为响应目标。
+// deliver 在持锁期间把响应投递到 handler 所在 I/O 线程，handler 析构需先拿到同一把锁，
+// 因此不会向已销毁的对象投递；投递后 handler 才销毁时，Qt 会一并丢弃其未处理的事件。
+class ResponseChannel {
+public:
+    explicit ResponseChannel(ClientHandler* handler) : m_handler(handler) {}
+
+    // 投递成功返回 true；连接已关闭返回 false。requestId 为客户端在 v2 头部携带的请求 id（v1 为 0）
+    bool deliver(const QJsonObject& payload, quint64 requestId = 0);
+    // 投递服务端推送（PushHub 调用），语义同 deliver
+    bool push(const QJsonObject& payload);
+    // 投递指定类型的消息（如线程池中完成的上传应答），语义同 deliver
+    bool send(Protocol::MessageType type, const QJsonObject& payload);
+    void detach();
+    bool isAttached() const;
+
+private:
+    mutable QMutex m_mutex;
+    ClientHandler* m_handler;
+};
 
 // 每个客户端连接对应一个 ClientHandler，在独立线程中解析协议并通过信号交给路由器/业务层处理
 class ClientHandler : public QObject {
@@ -16,13 +42,16 @@ public:
     ~ClientHandler();
 
     void initialize(qintptr socketDescriptor);
+    // 供路由器定向回送响应（须在 handler 创建线程、移交 I/O 线程之前获取）
+    QSharedPointer<ResponseChannel> channel() const { return m_channel; }
 
 signals:
-    // 仅向路由层发送 JSON 请求（已过滤非 JSON 类型的数据包）
-    void requestJsonReady(ClientHandler* sender, QJsonObject payload);
+    // 仅向路由层发送 JSON 请求（已过滤非 JSON 类型的数据包）；requestId 来自 v2 头部，v1 请求为 0
+    void requestJsonReady(ClientHandler* sender, quint64 requestId, QJsonObject payload);
 
 public slots:
-    void onJsonResponseReady(const QJsonObject& obj);
+    void onJsonResponseReady(const QJsonObject& obj, quint64 requestId = 0);
+    void onPushReady(const QJsonObject& obj);
     // 发送不同类型消息的便捷重载
     void sendMessage(Protocol::MessageType type, const QJsonObject& obj);
     void sendMessage(Protocol::MessageType type);                 // 空payload
@@ -31,6 +60,12 @@ public slots:
 private slots:
     void onReadyRead();
     void onDisconnected();
+    // 将本轮累积的出站帧一次性写入 socket
+    void flushOutbox();
+    // 在发送窗口内推进排队中的文件下载（新请求到达或 socket 写出数据后调用）
+    void pumpDownloads();
+    // 空闲检测定时器到期：期间仍有数据到达则顺延，否则视为死连接强制断开
+    void onIdleDeadline();
 
 private:
     QTcpSocket* m_socket = nullptr;
@@ -38,6 +73,29 @@ private:
     class StreamFrameParser* m_parser = nullptr;
     Protocol::Header m_currentHeader;
     FileTransferProcessor* m_file = nullptr;
+    QSharedPointer<ResponseChannel> m_channel;
+    // 与该客户端协商的业务负载编码（未协商时为 JSON）
+    Protocol::PayloadEncoding m_encoding = Protocol::PayloadEncoding::Json;
+    // 对端是否声明支持 zlib 压缩（是则对超过阈值的 JSON/CBOR 负载压缩发送）
+    bool m_compression = false;
+    // 出站帧头部版本（对端在 ClientHello 中声明支持 v2 时切换）
+    quint8 m_headerVersion = Protocol::VERSION;
+
+    // 出站合并缓冲：各发送接口只追加帧，由 flushOutbox 每个事件循环轮次写一次 socket
+    static constexpr int OUTBOX_FLUSH_BYTES = 256 * 1024; // 超过即立即写出
+    QByteArray m_outbox;
+    bool m_flushScheduled = false;
+    // 单个连接上下载数据的在途上限：限制每个下载占用的内存，也让 JSON 响应不必排在整个文件之后
+    static constexpr qint64 DOWNLOAD_WINDOW_BYTES = 4 * Protocol::FILE_CHUNK_SIZE;
+    // 超过该时长未收到任何数据（客户端每 HEARTBEAT_INTERVAL_MS 发一次心跳）即回收连接，
+    // 用于清理未发送 ClientDisconnect、也未触发 TCP 断开的死连接（如对端掉电、NAT 超时）
+    static constexpr qint64 IDLE_TIMEOUT_MS = 3 * Protocol::HEARTBEAT_INTERVAL_MS;
+    QElapsedTimer m_lastActivity;
+    quint64 m_idleTimer = 0; // 本线程 TimerWheel 中的定时器 id
+
+    void handleClientHello(const QJsonObject& hello);
+    void queueFrame(Protocol::MessageType type, const QByteArray& payload, quint64 requestId, bool compressible);
+    Protocol::FrameTag frameTag(quint64 requestId = 0) const { return Protocol::FrameTag{m_headerVersion, requestId, 0}; }
 
     // 解析已移入 m_parser
 };
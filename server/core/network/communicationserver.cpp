@@ -5,30 +5,89 @@
 #include <QThread>
 #include "core/logging/logging.h"
 
-CommunicationServer::CommunicationServer(QObject* parent)
+CommunicationServer::CommunicationServer(QObject* parent, int ioThreadCount)
     : QTcpServer(parent)
 {
+    const int count = ioThreadCount > 0 ? ioThreadCount : qMax(1, QThread::idealThreadCount());
+    m_ioThreads.reserve(count);
+    for (int i = 0; i < count; ++i) {
+        IoThread io;
+        io.thread = new QThread(this);
+        io.thread->setObjectName(QString("io-%1").arg(i));
+        io.thread->start();
+        m_ioThreads.append(io);
+    }
+    qInfo() << "[ Server ] I/O 线程已启动，数量=" << count;
+}
+
+CommunicationServer::~CommunicationServer()
+{
+    for (const IoThread& io : m_ioThreads) {
+        io.thread->quit();
+        io.thread->wait();
+    }
+}
+
+int CommunicationServer::connectionCount() const
+{
+    int total = 0;
+    for (const IoThread& io : m_ioThreads) total += io.connections;
+    return total;
+}
+
+QVector<int> CommunicationServer::connectionsPerThread() const
+{
+    QVector<int> counts;
+    counts.reserve(m_ioThreads.size());
+    for (const IoThread& io : m_ioThreads) counts.append(io.connections);
+    return counts;
+}
+
+int CommunicationServer::pickIoThread()
+{
+    // 最少连接优先；并列时从上次位置之后轮询，避免总压在第一个线程上
+    const int n = m_ioThreads.size();
+    int best = -1;
+    for (int k = 0; k < n; ++k) {
+        const int i = (m_nextThread + k) % n;
+        if (best < 0 || m_ioThreads[i].connections < m_ioThreads[best].connections) best = i;
+    }
+    m_nextThread = (best + 1) % n;
+    return best;
+}
+
+void CommunicationServer::onHandlerDestroyed(int threadIndex)
+{
+    if (threadIndex < 0 || threadIndex >= m_ioThreads.size()) return;
+    --m_ioThreads[threadIndex].connections;
+    logConnectionStats(QStringLiteral("断开"));
+}
+
+void CommunicationServer::logConnectionStats(const QString& event) const
+{
+    QStringList perThread;
+    for (int c : connectionsPerThread()) perThread << QString::number(c);
+    qInfo().noquote() << QString("[ Server ] 连接%1：连接数=%2, I/O线程=%3, 各线程连接数=[%4]")
+                             .arg(event)
+                             .arg(connectionCount())
+                             .arg(ioThreadCount())
+                             .arg(perThread.join(", "));
 }
 
 void CommunicationServer::incomingConnection(qintptr socketDescriptor)
 {
     qInfo() << "[ Server ] 新连接到达，socketDescriptor=" << socketDescriptor;
-    QThread* thread = new QThread;
+    const int index = pickIoThread();
+    QThread* thread = m_ioThreads[index].thread;
     ClientHandler* handler = new ClientHandler;
+    // 响应经 handler 自己的投递通道定向送达，无需每个连接都监听路由器的广播
+    MessageRouter::instance().attachClient(handler);
     handler->moveToThread(thread);
+    ++m_ioThreads[index].connections;
 
-    if (!connect(handler, &QObject::destroyed, thread, &QThread::quit)) {
-        Log::error("CommunicationServer", "Failed to connect ClientHandler::destroyed to QThread::quit");
-    }
-    if (!connect(thread, &QThread::finished, thread, &QThread::deleteLater)) {
-        Log::error("CommunicationServer", "Failed to connect QThread::finished to QThread::deleteLater");
-    }
-    // 当线程启动后，通过信号和槽机制调用 handler 的初始化方法
-    if (!connect(thread, &QThread::started, handler, [handler, socketDescriptor]() {
-        qInfo() << "[ Server ] 在线程" << QThread::currentThread() << "中初始化 ClientHandler";
-        handler->initialize(socketDescriptor);
-    })) {
-        Log::error("CommunicationServer", "Failed to connect QThread::started to handler lambda");
+    // handler 销毁时回到监听线程更新计数（lambda 不解引用 handler）
+    if (!connect(handler, &QObject::destroyed, this, [this, index]() { onHandlerDestroyed(index); })) {
+        Log::error("CommunicationServer", "Failed to connect ClientHandler::destroyed to connection counter");
     }
 
     if (!QObject::connect(handler, &ClientHandler::requestJsonReady,
@@ -41,15 +100,12 @@ void CommunicationServer::incomingConnection(qintptr socketDescriptor)
                           Qt::QueuedConnection)) {
         Log::error("CommunicationServer", "Failed to connect ClientHandler::destroyed to MessageRouter::onClientHandlerDestroyed");
     }
-    
-    // 将调度器的响应信号转发到对应的 handler::sendMessage（仅当目标是该 handler 时）
-    if (!QObject::connect(&MessageRouter::instance(), &MessageRouter::responseReady, handler, [handler](ClientHandler* target, QJsonObject payload) {
-                         if (target != handler) return; // 只处理发给该 handler 的响应
-                         handler->onJsonResponseReady(payload);
-                     }, Qt::QueuedConnection)) {
-        Log::error("CommunicationServer", "Failed to connect MessageRouter::responseReady to handler lambda");
-    }
 
-    qInfo() << "[ Server ] 启动处理线程" << thread;
-    thread->start();
+    // 在目标 I/O 线程中完成 socket 初始化（socket 必须在其所属线程创建）
+    QMetaObject::invokeMethod(handler, [handler, socketDescriptor]() {
+        qInfo() << "[ Server ] 在线程" << QThread::currentThread() << "中初始化 ClientHandler";
+        handler->initialize(socketDescriptor);
+    }, Qt::QueuedConnection);
+
+    logConnectionStats(QStringLiteral("建立"));
 }
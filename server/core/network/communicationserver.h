@@ -2,15 +2,38 @@
 
 #include <QDebug>
 #include <QTcpServer>
+#include <QVector>
 
 class ClientHandler;
+class QThread;
 
-// 服务端监听器：负责接收新连接并将处理工作委派到 ClientHandler（独立线程）
+// 服务端监听器：负责接收新连接并将处理工作委派到 ClientHandler
+// I/O 模型：固定数量的 I/O 线程（默认等于 CPU 核数），每个线程内复用事件循环承载多个 ClientHandler；
+// 新连接分配给当前连接数最少的线程（并列时轮询），线程随服务器常驻，不随连接创建/销毁。
 class CommunicationServer : public QTcpServer {
     Q_OBJECT
 public:
-    explicit CommunicationServer(QObject* parent = nullptr);
+    // ioThreadCount <= 0 时使用 QThread::idealThreadCount()
+    explicit CommunicationServer(QObject* parent = nullptr, int ioThreadCount = 0);
+    ~CommunicationServer() override;
+
+    // 运行指标：用于核对空闲连接的资源占用
+    int ioThreadCount() const { return m_ioThreads.size(); }
+    int connectionCount() const;
+    QVector<int> connectionsPerThread() const;
 
 protected:
     void incomingConnection(qintptr socketDescriptor) override;
+
+private:
+    struct IoThread {
+        QThread* thread = nullptr;
+        int connections = 0;
+    };
+    QVector<IoThread> m_ioThreads;
+    int m_nextThread = 0; // 负载相同时的轮询起点
+
+    int pickIoThread();
+    void onHandlerDestroyed(int threadIndex);
+    void logConnectionStats(const QString& event) const;
 };
@@ -1,4 +1,9 @@
 #include "core/network/filetransferprocessor.h"
+#include "core/network/protocol.h"
+#include "core/storage/blobstore.h"
+#include "core/storage/filestore.h"
+#include "core/storage/uploadstore.h"
+#include "core/database/dbpool.h"
 #include <QDir>
 #include <QFileInfo>
 
@@ -9,92 +14,129 @@ FileTransferProcessor::FileTransferProcessor(const QString& baseDir)
 
 FileTransferProcessor::~FileTransferProcessor()
 {
-    if (m_uploadFile.isOpen()) m_uploadFile.close();
+    for (DownloadJob& job : m_downloads) closeDownload(job);
 }
 
-void FileTransferProcessor::reset()
+void FileTransferProcessor::beginUpload(const QJsonObject& meta, QObject* context, UploadStore::AckCallback done)
 {
-    if (m_uploadFile.isOpen()) m_uploadFile.close();
-    m_name.clear();
-    m_expectedSize = -1;
-    m_received = 0;
+    UploadStore::instance().begin(m_baseDir, meta, context, std::move(done));
 }
 
-bool FileTransferProcessor::beginUpload(const QJsonObject& meta, QJsonObject& ackOrErr)
+bool FileTransferProcessor::appendChunk(const QByteArray& payload, QJsonObject& err)
 {
-    reset();
-    m_name = meta.value("name").toString();
-    m_expectedSize = meta.value("size").toVariant().toLongLong();
-    if (m_name.isEmpty() || m_expectedSize < 0) {
-        ackOrErr = QJsonObject{{"code", 400}, {"message", "invalid meta"}};
-        return false;
-    }
-    QDir().mkpath(m_baseDir);
-    const QString path = QDir(m_baseDir).filePath(m_name);
-    m_uploadFile.setFileName(path);
-    if (!m_uploadFile.open(QIODevice::WriteOnly)) {
-        ackOrErr = QJsonObject{{"code", 500}, {"message", "open failed"}};
-        reset();
-        return false;
-    }
-    ackOrErr = QJsonObject{{"file", m_name}, {"ready", true}};
-    return true;
+    return UploadStore::instance().writeChunk(payload, err);
 }
 
-bool FileTransferProcessor::appendChunk(const QByteArray& data, QJsonObject& err)
+void FileTransferProcessor::finishUpload(const QJsonObject& req, UploadStore::AckCallback done)
 {
-    if (!m_uploadFile.isOpen()) {
-        err = QJsonObject{{"code", 409}, {"message", "no meta"}};
-        return false;
-    }
-    const qint64 written = m_uploadFile.write(data);
-    if (written != data.size()) {
-        err = QJsonObject{{"code", 500}, {"message", "write failed"}};
-        return false;
-    }
-    m_received += written;
-    return true;
+    UploadStore::instance().finish(req, std::move(done));
 }
 
-bool FileTransferProcessor::finishUpload(QJsonObject& resultOrErr)
+void FileTransferProcessor::enqueueDownload(const QJsonObject& req)
 {
-    if (!m_uploadFile.isOpen() || m_name.isEmpty()) {
-        resultOrErr = QJsonObject{{"code", 409}, {"message", "no upload in progress"}};
-        return false;
+    // 打开与校验推迟到成为队首时进行，错误也按请求顺序回送
+    DownloadJob job;
+    job.request = req;
+    m_downloads.enqueue(job);
+}
+
+bool FileTransferProcessor::openDownload(DownloadJob& job, QJsonObject& err)
+{
+    const QJsonObject& req = job.request;
+    job.opened = true;
+    // 错误中回带请求的标识（name 或 blob），客户端据此匹配
+    const bool byHash = req.contains("blob");
+    const QString key = byHash ? QStringLiteral("blob") : QStringLiteral("name");
+    const QString id = req.value(key).toString();
+    QString path;
+    if (byHash) {
+        // 常驻内存的 blob（如药品图片）优先，否则在磁盘 FileStore 中按哈希查找
+        if (!id.isEmpty() && BlobStore::instance().get(id, job.blob)) {
+            job.totalSize = job.blob.size();
+            job.data = reinterpret_cast<const uchar*>(job.blob.constData());
+        } else if (FileStore::instance().contains(id)) {
+            path = FileStore::instance().pathFor(id);
+        } else {
+            err = QJsonObject{{"code", 404}, {"message", "blob not found"}, {"blob", id}};
+            return false;
+        }
+    } else {
+        if (id.isEmpty()) {
+            err = QJsonObject{{"code", 400}, {"message", "invalid name"}};
+            return false;
+        }
+        // 下载目录下的同名文件（上传改为内容寻址之前的文件）优先，否则按上传登记的文件名解析到 FileStore
+        path = QDir(m_baseDir).filePath(id);
+        QString hash;
+        if (!QFileInfo::exists(path) && DBLease()->getFileHashByName(id, hash) && FileStore::instance().contains(hash)) {
+            path = FileStore::instance().pathFor(hash);
+        }
+    }
+
+    if (!path.isEmpty()) {
+        job.file.reset(new QFile(path));
+        if (!job.file->open(QIODevice::ReadOnly)) {
+            err = QJsonObject{{"code", 404}, {"message", "not found"}, {key, id}};
+            job.file.reset();
+            return false;
+        }
+        job.totalSize = job.file->size();
     }
-    m_uploadFile.flush();
-    m_uploadFile.close();
-    if (m_expectedSize >= 0 && m_received != m_expectedSize) {
-        resultOrErr = QJsonObject{{"code", 422}, {"message", "size mismatch"}};
-        reset();
+    // 区间：offset 缺省为 0，length 缺省或越界时取到末尾
+    job.offset = req.value("offset").toVariant().toLongLong();
+    if (job.offset < 0 || job.offset > job.totalSize) {
+        err = QJsonObject{{"code", 416}, {"message", "range not satisfiable"}, {key, id}};
+        closeDownload(job);
         return false;
     }
-    resultOrErr = QJsonObject{{"uploaded", true}, {"file", m_name}, {"size", m_received}};
-    reset();
+    const qint64 remaining = job.totalSize - job.offset;
+    const qint64 requested = req.contains("length") ? req.value("length").toVariant().toLongLong() : remaining;
+    job.length = (requested < 0 || requested > remaining) ? remaining : requested;
+    if (!job.file) {
+        job.data += job.offset;
+    } else if (job.length > 0) {
+        job.data = job.file->map(job.offset, job.length);
+        if (!job.data) {
+            err = QJsonObject{{"code", 500}, {"message", "map failed"}, {key, id}};
+            closeDownload(job);
+            return false;
+        }
+    }
     return true;
 }
 
-bool FileTransferProcessor::downloadWhole(const QJsonObject& req,
-                                          const std::function<void(const QByteArray&)>& sendChunk,
-                                          QJsonObject& completeOrErr)
+void FileTransferProcessor::closeDownload(DownloadJob& job)
 {
-    const QString name = req.value("name").toString();
-    if (name.isEmpty()) {
-        completeOrErr = QJsonObject{{"code", 400}, {"message", "invalid name"}};
-        return false;
+    if (job.file) {
+        if (job.data) job.file->unmap(const_cast<uchar*>(job.data));
+        job.file->close();
+        job.file.reset();
     }
-    const QString path = QDir(m_baseDir).filePath(name);
-    QFile f(path);
-    if (!f.open(QIODevice::ReadOnly)) {
-        completeOrErr = QJsonObject{{"code", 404}, {"message", "not found"}};
-        return false;
+    job.data = nullptr;
+    job.blob.clear();
+}
+
+FileTransferProcessor::DownloadStep FileTransferProcessor::nextDownloadStep(QByteArray& chunk, QJsonObject& meta)
+{
+    if (m_downloads.isEmpty()) return DownloadStep::Idle;
+    DownloadJob& job = m_downloads.head();
+    if (!job.opened && !openDownload(job, meta)) {
+        m_downloads.dequeue();
+        return DownloadStep::Error;
     }
-    while (!f.atEnd()) {
-        QByteArray chunk = f.read(64 * 1024);
-        sendChunk(chunk);
+    if (job.sent < job.length) {
+        const int len = static_cast<int>(qMin<qint64>(Protocol::FILE_CHUNK_SIZE, job.length - job.sent));
+        chunk = QByteArray::fromRawData(reinterpret_cast<const char*>(job.data) + job.sent, len);
+        job.sent += len;
+        return DownloadStep::Chunk;
     }
-    const qint64 size = QFileInfo(f).size();
-    f.close();
-    completeOrErr = QJsonObject{{"name", name}, {"size", size}};
-    return true;
+    meta = job.request.contains("blob")
+        ? QJsonObject{{"blob", job.request.value("blob")}}
+        : QJsonObject{{"name", job.request.value("name")}};
+    meta["size"] = job.totalSize;
+    meta["offset"] = job.offset;
+    meta["length"] = job.length;
+    closeDownload(job);
+    m_downloads.dequeue();
+    return DownloadStep::Complete;
 }
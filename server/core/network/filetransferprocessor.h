@@ -3,8 +3,10 @@
 #include <QByteArray>
 #include <QFile>
 #include <QJsonObject>
+#include <QQueue>
+#include <QSharedPointer>
 #include <QString>
-#include <functional>
+#include "core/storage/uploadstore.h"
 
 // 负责处理文件上传/下载的payload解析与生成（与网络发送解耦）
 class FileTransferProcessor {
@@ -12,22 +14,43 @@ public:
     explicit FileTransferProcessor(const QString& baseDir = QStringLiteral("files"));
     ~FileTransferProcessor();
 
-    // 上传流程
-    bool beginUpload(const QJsonObject& meta, QJsonObject& ackOrErr); // {name, size}
-    bool appendChunk(const QByteArray& data, QJsonObject& err);       // 仅在 begin 成功后调用
-    bool finishUpload(QJsonObject& resultOrErr);                       // 返回 {uploaded, file, size}
+    // 上传流程：会话由 UploadStore 按 upload_id 管理，不属于某个连接，因此可并发、可跨连接续传
+    // 应答经 done 回送（见 UploadStore：可能异步，done 须线程安全）；context 为秒传等待数据库登记时的回调线程对象
+    void beginUpload(const QJsonObject& meta, QObject* context, UploadStore::AckCallback done);  // {upload_id, name, size} -> {upload_id, chunk_size, missing}
+    bool appendChunk(const QByteArray& payload, QJsonObject& err);     // payload 为块头部 + 数据
+    // {upload_id} -> {upload_id, uploaded, file, size} 或缺失块列表
+    void finishUpload(const QJsonObject& req, UploadStore::AckCallback done);
 
-    // 下载：读取整个文件并通过回调逐块“生成”payload
-    bool downloadWhole(const QJsonObject& req,
-                       const std::function<void(const QByteArray&)>& sendChunk,
-                       QJsonObject& completeOrErr); // req={name}; complete={name,size}
-
-    void reset();
+    // 下载：请求按到达顺序排队，同一时刻只推进队首，保证每个下载的 Chunk...Complete 在线上连续。
+    // req={name | blob, offset?, length?}：name 为下载目录下的文件或上传时登记的文件名（file_names 表，解析到 FileStore），
+    // blob 为内容哈希（BlobStore 或 FileStore），可指定区间用于断点续传。
+    // 文件通过 mmap 映射，调用方按发送窗口逐块拉取，内存占用与文件大小无关。
+    enum class DownloadStep {
+        Idle,     // 没有待发送的下载
+        Chunk,    // chunk 为下一块数据（指向映射内存的视图，须在返回后立即发送/拷贝）
+        Complete, // meta={name|blob, size, offset, length}
+        Error     // meta={code, message, name|blob}
+    };
+    void enqueueDownload(const QJsonObject& req);
+    bool hasPendingDownload() const { return !m_downloads.isEmpty(); }
+    DownloadStep nextDownloadStep(QByteArray& chunk, QJsonObject& meta);
 
 private:
     QString m_baseDir;
-    QFile m_uploadFile;
-    QString m_name;
-    qint64 m_expectedSize = -1;
-    qint64 m_received = 0;
+
+    struct DownloadJob {
+        QJsonObject request;
+        bool opened = false;
+        QSharedPointer<QFile> file;   // 文件下载：映射期间保持打开
+        QByteArray blob;              // 内存 blob 下载：共享 BlobStore 中的字节
+        const uchar* data = nullptr;  // 本次区间的起始地址（映射区或 blob 内偏移 offset 处）
+        qint64 totalSize = 0;         // 文件/blob 总长度
+        qint64 offset = 0;            // 本次下载区间 [offset, offset + length)
+        qint64 length = 0;
+        qint64 sent = 0;
+    };
+    QQueue<DownloadJob> m_downloads;
+
+    bool openDownload(DownloadJob& job, QJsonObject& err);
+    void closeDownload(DownloadJob& job);
 };
@@ -1,7 +1,9 @@
 #include "core/network/clienthandler.h"
 #include "core/network/messagerouter.h"
+#include "core/network/pushhub.h"
+#include <QCoreApplication>
 #include <QDateTime>
-#include <QUuid>
+#include <QThread>
 
 using namespace Protocol;
 
@@ -14,71 +16,231 @@ MessageRouter& MessageRouter::instance()
 MessageRouter::MessageRouter(QObject* parent)
     : QObject(parent)
 {
-    // 注册用于跨线程队列连接的元类型（仅需 MessageType 给 responseReady 使用）
-    qRegisterMetaType<Protocol::MessageType>("Protocol::MessageType");
+    // 有界工作线程池：线程常驻，避免过期重建导致每线程数据库连接反复打开
+    m_workers.setMaxThreadCount(qMax(2, QThread::idealThreadCount()));
+    m_workers.setExpiryTimeout(-1);
+    qInfo() << "[ Router ] 业务工作线程数:" << m_workers.maxThreadCount();
+
+    if (QCoreApplication::instance()) {
+        connect(QCoreApplication::instance(), &QCoreApplication::aboutToQuit, this, &MessageRouter::shutdown);
+    }
+}
+
+void MessageRouter::attachClient(ClientHandler* handler)
+{
+    if (!handler) return;
+    // 地址可能被刚销毁、尚未清理的旧 handler 复用：先清掉旧连接的路由（旧通道已 detach）
+    cleanupRoutesFor(handler);
+    m_connections.insert(handler, Connection{handler->channel(), 0});
+}
+
+void MessageRouter::shutdown()
+{
+    if (m_shuttingDown) return;
+    m_shuttingDown = true;
+    m_strands.clear();
+    m_workers.clear();
+    m_workers.waitForDone();
 }
 
-void MessageRouter::onJsonRequest(ClientHandler* sender, QJsonObject payload)
+bool MessageRouter::registerActions(QObject* owner, const QStringList& actions, ActionHandler handler,
+                                    DispatchPolicy policy)
 {
-    Q_UNUSED(sender);
-    qInfo() << "[ Router ] 广播JSON请求给业务层";
-    handleJson(sender, payload);
+    if (!handler) return false;
+    return registerConnectionActions(owner, actions,
+                                     [handler](const QJsonObject& payload, const QSharedPointer<ResponseChannel>&) {
+                                         handler(payload);
+                                     },
+                                     policy);
 }
 
-void MessageRouter::handleJson(ClientHandler* sender, QJsonObject payload)
+bool MessageRouter::registerConnectionActions(QObject* owner, const QStringList& actions, ConnectionHandler handler,
+                                              DispatchPolicy policy)
 {
-    // 1) 确保存在 uuid 字段；如无则创建
-    QString uuid = payload.value("uuid").toString();
-    if (uuid.isEmpty()) {
-        uuid = QUuid::createUuid().toString(QUuid::WithoutBraces);
-        payload.insert("uuid", uuid);
+    if (!owner || !handler) return false;
+    bool ok = true;
+    for (const QString& action : actions) {
+        auto it = m_actions.constFind(action);
+        if (it != m_actions.constEnd() && it->owner && it->owner != owner) {
+            qWarning() << "[ Router ] action 重复注册，已忽略:" << action
+                       << "已有处理者" << it->owner->metaObject()->className();
+            ok = false;
+            continue;
+        }
+        m_actions.insert(action, ActionEntry{QPointer<QObject>(owner), handler, policy});
     }
+    // 模块销毁时移除其注册的所有 action（同一 owner 多次注册只需一次连接）
+    connect(owner, &QObject::destroyed, this, &MessageRouter::onActionOwnerDestroyed, Qt::UniqueConnection);
+    return ok;
+}
 
-    // 2) 记录路由关系：uuid -> sender（弱引用）
-    m_uuidToHandler.insert(uuid, QPointer<ClientHandler>(sender));
+void MessageRouter::onActionOwnerDestroyed(QObject* owner)
+{
+    for (auto it = m_actions.begin(); it != m_actions.end();) {
+        if (!it->owner || it->owner == owner) it = m_actions.erase(it);
+        else ++it;
+    }
+}
 
-    // 3) 广播给业务层
-    qInfo() << "[ Router ] 广播业务请求 uuid=" << uuid;
-    emit requestReceived(payload);
+void MessageRouter::onJsonRequest(ClientHandler* sender, quint64 requestId, QJsonObject payload)
+{
+    handleJson(sender, requestId, payload);
 }
 
-void MessageRouter::onBusinessResponse(QJsonObject payload)
+void MessageRouter::handleJson(ClientHandler* sender, quint64 requestId, QJsonObject payload)
 {
-    // 从响应 payload 中读取 request_uuid
-    const QString uuid = payload.value("request_uuid").toString();
-    if (uuid.isEmpty()) {
-        qWarning() << "[ Router ] 响应缺少 request_uuid 字段，已丢弃";
+    auto conn = m_connections.find(sender);
+    if (conn == m_connections.end() || !conn->channel->isAttached()) {
+        qWarning() << "[ Router ] 请求来源连接已关闭，丢弃请求";
         return;
     }
-    auto it = m_uuidToHandler.find(uuid);
-    if (it == m_uuidToHandler.end()) {
-        qWarning() << "[ Router ] 未找到 uuid 的目标连接，丢弃响应 uuid=" << uuid;
+
+    // 1) 查表定位处理者：优先 action 字段，兼容仅携带 type 的旧请求
+    const QString action = payload.value("action").toString(payload.value("type").toString());
+    auto it = m_actions.constFind(action);
+    if (it == m_actions.constEnd() || !it->owner) {
+        qWarning() << "[ Router ] 未知 action，回复错误 action=" << action << "request=" << requestId;
+        QJsonObject resp{{"type", "error_response"},
+                         {"success", false},
+                         {"action", action},
+                         {"error", QStringLiteral("Unknown action: %1").arg(action)}};
+        if (payload.contains("uuid")) resp.insert("request_uuid", payload.value("uuid").toString());
+        conn->channel->deliver(resp, requestId);
+        return;
+    }
+
+    // 2) 分配整数路由 id 并记录到该连接的路由链表；业务模块通过 stampReply 原样带回
+    const quint64 routeId = addRoute(sender, *conn, requestId);
+    payload.insert("request_id", static_cast<qint64>(routeId));
+
+    // 3) 投递给唯一处理者
+    qInfo() << "[ Router ] 分发业务请求 action=" << action << "route=" << routeId;
+    QObject* owner = it->owner;
+    const ConnectionHandler handler = it->handler;
+    const QSharedPointer<ResponseChannel> channel = conn->channel;
+    if (it->policy == DispatchPolicy::Concurrent) {
+        // 工作线程执行；同一连接串行，保证响应按请求顺序返回
+        enqueueOnStrand(sender, [handler, payload, channel]() { handler(payload, channel); });
+    } else if (owner->thread() == QThread::currentThread()) {
+        handler(payload, channel);
+    } else {
+        QMetaObject::invokeMethod(owner, [handler, payload, channel]() { handler(payload, channel); },
+                                  Qt::QueuedConnection);
+    }
+}
+
+quint64 MessageRouter::addRoute(ClientHandler* owner, Connection& conn, quint64 clientRequestId)
+{
+    const quint64 id = ++m_nextRouteId;
+    Route route;
+    route.channel = conn.channel;
+    route.owner = owner;
+    route.clientRequestId = clientRequestId;
+    route.next = conn.routeHead;
+    if (conn.routeHead) m_routes[conn.routeHead].prev = id;
+    conn.routeHead = id;
+    m_routes.insert(id, route);
+    return id;
+}
+
+bool MessageRouter::takeRoute(quint64 id, Route& out)
+{
+    auto it = m_routes.find(id);
+    if (it == m_routes.end()) return false;
+    out = it.value();
+    m_routes.erase(it);
+    // 从所属连接的链表中摘除
+    if (out.prev) {
+        m_routes[out.prev].next = out.next;
+    } else {
+        auto conn = m_connections.find(out.owner);
+        if (conn != m_connections.end() && conn->routeHead == id) conn->routeHead = out.next;
+    }
+    if (out.next) m_routes[out.next].prev = out.prev;
+    return true;
+}
+
+void MessageRouter::enqueueOnStrand(ClientHandler* key, std::function<void()> task)
+{
+    if (m_shuttingDown) return;
+    auto it = m_strands.find(key);
+    if (it == m_strands.end()) {
+        it = m_strands.insert(key, Strand{});
+        it->serial = ++m_nextStrandSerial;
+    }
+    it->pending.enqueue(std::move(task));
+    if (!it->running) runNextOnStrand(key);
+}
+
+void MessageRouter::runNextOnStrand(ClientHandler* key)
+{
+    auto it = m_strands.find(key);
+    if (it == m_strands.end()) return;
+    if (it->pending.isEmpty()) {
+        m_strands.erase(it);
+        return;
+    }
+    it->running = true;
+    const quint64 serial = it->serial;
+    std::function<void()> task = it->pending.dequeue();
+    m_workers.start([this, key, serial, task]() {
+        task();
+        // 处理函数内发出的响应已先于此通知进入路由器的事件队列，因此顺序得以保持
+        QMetaObject::invokeMethod(this, [this, key, serial]() { onStrandTaskFinished(key, serial); },
+                                  Qt::QueuedConnection);
+    });
+}
+
+void MessageRouter::onStrandTaskFinished(ClientHandler* key, quint64 serial)
+{
+    auto it = m_strands.find(key);
+    if (it == m_strands.end() || it->serial != serial) return; // handler 已销毁
+    it->running = false;
+    runNextOnStrand(key);
+}
+
+void MessageRouter::onBusinessResponse(QJsonObject payload)
+{
+    // 从响应 payload 中读取整数路由 id
+    const quint64 routeId = static_cast<quint64>(payload.value("request_id").toDouble());
+    Route route;
+    if (!routeId || !takeRoute(routeId, route)) {
+        qWarning() << "[ Router ] 未找到响应的目标连接（缺少或未知 request_id），已丢弃 route=" << routeId;
         return;
     }
-    QPointer<ClientHandler> target = it.value();
-    m_uuidToHandler.erase(it);
-    if (!target) {
-        qWarning() << "[ Router ] 目标连接已失效，丢弃响应 uuid=" << uuid;
+    // 路由 id 仅在服务端内部使用，不回传给客户端
+    payload.remove("request_id");
+    // 只投递到目标连接所在线程，开销与连接总数无关
+    if (!route.channel->deliver(payload, route.clientRequestId)) {
+        qWarning() << "[ Router ] 目标连接已失效，丢弃响应 route=" << routeId;
         return;
     }
-    // 统一为 JSON 响应类型
-    qInfo() << "[ Router ] 路由响应给目标连接 uuid=" << uuid;
-    emit responseReady(target, payload);
+    qInfo() << "[ Router ] 路由响应给目标连接 route=" << routeId;
 }
 
 void MessageRouter::cleanupRoutesFor(ClientHandler* handler)
 {
-    // 移除所有映射到该 handler 的 uuid
-    QList<QString> toRemove;
-    for (auto it = m_uuidToHandler.constBegin(); it != m_uuidToHandler.constEnd(); ++it) {
-        if (it.value() == handler) toRemove.append(it.key());
+    // 地址已被新连接复用（新通道仍有效）时，旧连接的状态已被覆盖，不能误删新连接的
+    auto conn = m_connections.find(handler);
+    if (conn == m_connections.end()) return;
+    if (conn->channel->isAttached()) return;
+    // 只遍历该连接自己的路由链表
+    for (quint64 id = conn->routeHead; id;) {
+        auto it = m_routes.find(id);
+        if (it == m_routes.end()) break;
+        id = it->next;
+        m_routes.erase(it);
     }
-    for (const auto& k : toRemove) m_uuidToHandler.remove(k);
+    PushHub::instance().unsubscribeChannel(conn->channel.data());
+    m_connections.erase(conn);
+    // 丢弃尚未执行的排队任务；正在执行的任务完成后按 serial 校验自动忽略
+    m_strands.remove(handler);
 }
 
 void MessageRouter::onClientHandlerDestroyed(QObject* obj)
 {
-    auto* handler = qobject_cast<ClientHandler*>(obj);
+    // 队列连接到达时对象已析构，只能把指针当作键使用，不可 qobject_cast/解引用
+    auto* handler = static_cast<ClientHandler*>(obj);
     if (!handler) return;
     cleanupRoutesFor(handler);
     qInfo() << "[ Router ] 处理 handler 销毁清理完成";
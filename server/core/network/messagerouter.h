@@ -4,40 +4,136 @@
 #include <QObject>
 #include <QPointer>
 #include <QHash>
+#include <QQueue>
+#include <QSharedPointer>
+#include <QStringList>
+#include <QThreadPool>
+#include <functional>
 #include "core/network/protocol.h"
 
 class ClientHandler;
+class ResponseChannel;
 
-// 消息路由器（单例）：
-// - 广播 JSON 请求（payload 内自带 uuid）给业务层
-// - 接收业务层响应（payload 内自带 request_uuid）并路由回对应的 ClientHandler
+// 消息路由器（单例，位于主线程）：
+// - 按 action 查表，将 JSON 请求投递给唯一注册的业务处理函数；投递前为请求分配整数路由 id（payload.request_id）
+// - Concurrent 处理函数在有界工作线程池中执行，同一连接的请求按到达顺序串行（strand），保证响应顺序
+// - 接收业务层响应（经 stampReply 带回 request_id），按整数 id 查表，经该连接的 ResponseChannel 只投递给目标 ClientHandler
 class MessageRouter : public QObject {
     Q_OBJECT
 public:
+    using ActionHandler = std::function<void(const QJsonObject&)>;
+    // 需要绑定到请求所在连接的 action（如推送订阅）：处理函数额外收到该连接的 ResponseChannel，接受请求后自行登记
+    using ConnectionHandler = std::function<void(const QJsonObject&, const QSharedPointer<ResponseChannel>&)>;
+
+    // 处理函数的执行位置
+    enum class DispatchPolicy {
+        Concurrent, // 无状态处理函数：在工作线程池执行，数据库连接由 DBConnectionPool 按线程提供
+        Affine      // 有状态/依赖线程亲和对象（定时器、QNetworkAccessManager 等）：在 owner 所在线程执行
+    };
+
     static MessageRouter& instance();
 
+    // 业务模块在构造时声明自己处理的 action；同一 action 只能注册一次，重复注册返回 false。
+    // owner 销毁后对应 action 自动失效。Concurrent 处理函数可能在任意工作线程执行，
+    // 其中发出的 businessResponse 会经队列连接回到路由器所在线程。
+    bool registerActions(QObject* owner, const QStringList& actions, ActionHandler handler,
+                         DispatchPolicy policy = DispatchPolicy::Concurrent);
+
+    template <typename Module>
+    bool registerActions(Module* owner, const QStringList& actions,
+                         void (Module::*method)(const QJsonObject&),
+                         DispatchPolicy policy = DispatchPolicy::Concurrent) {
+        return registerActions(static_cast<QObject*>(owner), actions,
+                               [owner, method](const QJsonObject& payload) { (owner->*method)(payload); },
+                               policy);
+    }
+
+    // 与 registerActions 相同，但处理函数同时收到请求来源连接的 ResponseChannel
+    bool registerConnectionActions(QObject* owner, const QStringList& actions, ConnectionHandler handler,
+                                   DispatchPolicy policy = DispatchPolicy::Concurrent);
+
+    template <typename Module>
+    bool registerConnectionActions(Module* owner, const QStringList& actions,
+                                   void (Module::*method)(const QJsonObject&, const QSharedPointer<ResponseChannel>&),
+                                   DispatchPolicy policy = DispatchPolicy::Concurrent) {
+        return registerConnectionActions(static_cast<QObject*>(owner), actions,
+                                         [owner, method](const QJsonObject& payload, const QSharedPointer<ResponseChannel>& channel) {
+                                             (owner->*method)(payload, channel);
+                                         },
+                                         policy);
+    }
+
+    // 登记新连接的投递通道（CommunicationServer 在创建 handler 后、移交 I/O 线程前调用）
+    void attachClient(ClientHandler* handler);
+
+    // 停止接收新任务并等待工作线程完成（应用退出前调用）
+    void shutdown();
+
+    // 业务模块回复前调用：带回路由所需的 request_id；请求自带 uuid（v1 客户端）时同时回显为 request_uuid
+    static void stampReply(QJsonObject& resp, const QJsonObject& request)
+    {
+        resp.insert(QStringLiteral("request_id"), request.value(QStringLiteral("request_id")));
+        const QJsonValue uuid = request.value(QStringLiteral("uuid"));
+        if (!uuid.isUndefined()) resp.insert(QStringLiteral("request_uuid"), uuid.toString());
+    }
+
 public slots:
-    // 仅接收 JSON 请求（由 CommunicationServer 连接）
-    void onJsonRequest(ClientHandler* sender, QJsonObject payload);
+    // 仅接收 JSON 请求（由 CommunicationServer 连接）；requestId 为 v2 头部中的客户端请求 id
+    void onJsonRequest(ClientHandler* sender, quint64 requestId, QJsonObject payload);
 
-    // 业务层回馈响应：payload 内需包含 request_uuid，用于路由回对应连接
+    // 业务层回馈响应：payload 内需包含 request_id（见 stampReply），用于路由回对应连接
     void onBusinessResponse(QJsonObject payload);
     // ClientHandler 销毁或断开时的清理
     void onClientHandlerDestroyed(QObject* obj);
 
-signals:
-    // 向指定的 ClientHandler 返回响应（由路由器发射，具体发送在对应 handler 线程执行）
-    void responseReady(ClientHandler* target, QJsonObject payload);
-
-    // 向业务层广播一条 JSON 请求（payload 内含 uuid 字段）
-    void requestReceived(QJsonObject payload);
-
 private:
     explicit MessageRouter(QObject* parent = nullptr);
-    void handleJson(ClientHandler* sender, QJsonObject payload);
+    void handleJson(ClientHandler* sender, quint64 requestId, QJsonObject payload);
+    void onActionOwnerDestroyed(QObject* owner);
+
+    struct ActionEntry {
+        QPointer<QObject> owner;
+        ConnectionHandler handler; // 普通 ActionHandler 注册时包装为忽略通道参数
+        DispatchPolicy policy = DispatchPolicy::Concurrent;
+    };
+    // action -> 处理函数（一次哈希查找即可定位唯一处理者）
+    QHash<QString, ActionEntry> m_actions;
+
+    // 每个连接一条 strand：同一时刻最多一个任务在工作线程中执行，其余按 FIFO 排队
+    struct Strand {
+        quint64 serial = 0;   // 区分地址复用的不同 handler
+        bool running = false;
+        QQueue<std::function<void()>> pending;
+    };
+    QHash<ClientHandler*, Strand> m_strands;
+    quint64 m_nextStrandSerial = 0;
+    QThreadPool m_workers;
+    bool m_shuttingDown = false;
+
+    void enqueueOnStrand(ClientHandler* key, std::function<void()> task);
+    void runNextOnStrand(ClientHandler* key);
+    void onStrandTaskFinished(ClientHandler* key, quint64 serial);
+
+    // 未完成请求的路由：整数 id -> 目标连接；同一连接的路由串成双向链表，断开时只遍历该连接自己的路由
+    struct Route {
+        QSharedPointer<ResponseChannel> channel;
+        ClientHandler* owner = nullptr;
+        quint64 clientRequestId = 0; // v2 头部请求 id，响应时原样带回
+        quint64 prev = 0;            // 链表前驱/后继路由 id（0 表示无）
+        quint64 next = 0;
+    };
+    QHash<quint64, Route> m_routes;
+    quint64 m_nextRouteId = 0;
+
+    // 每个连接的投递通道与其未完成路由链表头；handler 销毁后通道失效，随 onClientHandlerDestroyed 移除
+    struct Connection {
+        QSharedPointer<ResponseChannel> channel;
+        quint64 routeHead = 0;
+    };
+    QHash<ClientHandler*, Connection> m_connections;
 
-    // 记录 uuid -> ClientHandler，用于响应路由
-    QHash<QString, QPointer<ClientHandler>> m_uuidToHandler;
+    quint64 addRoute(ClientHandler* owner, Connection& conn, quint64 clientRequestId);
+    bool takeRoute(quint64 id, Route& out);
     // 清理所有属于某个 handler 的未完成路由（当其销毁时）
     void cleanupRoutesFor(ClientHandler* handler);
 };
\ No newline at end of file
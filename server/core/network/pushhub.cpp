@@ -0,0 +1,100 @@
+#include "core/network/pushhub.h"
+#include "core/network/clienthandler.h"
+#include <QDebug>
+
+PushHub& PushHub::instance()
+{
+    static PushHub hub;
+    return hub;
+}
+
+quint64 PushHub::subscribe(const QString& user, const QSharedPointer<ResponseChannel>& channel)
+{
+    QMutexLocker locker(&m_mutex);
+    for (auto it = m_byChannel.constFind(channel.data()); it != m_byChannel.constEnd() && it.key() == channel.data(); ++it) {
+        if (m_subscriptions.value(it.value()).user == user) return it.value();
+    }
+    const quint64 id = ++m_nextId;
+    m_subscriptions.insert(id, Subscription{user, channel});
+    m_byUser.insert(user, id);
+    m_byChannel.insert(channel.data(), id);
+    qInfo() << "[ PushHub ] 用户订阅推送 user=" << user << "subscription=" << id
+            << "设备数=" << m_byUser.count(user);
+    return id;
+}
+
+void PushHub::unsubscribeChannel(const ResponseChannel* channel)
+{
+    QMutexLocker locker(&m_mutex);
+    const QList<quint64> ids = m_byChannel.values(channel);
+    for (quint64 id : ids) {
+        auto it = m_subscriptions.find(id);
+        if (it != m_subscriptions.end()) removeLocked(it);
+    }
+}
+
+void PushHub::removeLocked(QHash<quint64, Subscription>::iterator it)
+{
+    m_byUser.remove(it->user, it.key());
+    m_byChannel.remove(it->channel.data(), it.key());
+    m_subscriptions.erase(it);
+}
+
+int PushHub::publish(const QString& user, const QString& topic, const QJsonObject& data)
+{
+    QList<quint64> ids;
+    {
+        QMutexLocker locker(&m_mutex);
+        ids = m_byUser.values(user);
+    }
+    return ids.isEmpty() ? 0 : deliver(ids, topic, data);
+}
+
+int PushHub::broadcast(const QString& topic, const QJsonObject& data)
+{
+    QList<quint64> ids;
+    {
+        QMutexLocker locker(&m_mutex);
+        ids = m_subscriptions.keys();
+    }
+    return ids.isEmpty() ? 0 : deliver(ids, topic, data);
+}
+
+bool PushHub::pushTo(quint64 subscriptionId, const QString& topic, const QJsonObject& data)
+{
+    return deliver({subscriptionId}, topic, data) == 1;
+}
+
+bool PushHub::hasSubscribers(const QString& user) const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_byUser.contains(user);
+}
+
+int PushHub::deliver(const QList<quint64>& ids, const QString& topic, const QJsonObject& data)
+{
+    const QJsonObject payload{{"topic", topic}, {"data", data}};
+    // 持锁只为取出通道；投递本身加的是通道锁，不在本锁内进行
+    QList<QPair<quint64, QSharedPointer<ResponseChannel>>> targets;
+    {
+        QMutexLocker locker(&m_mutex);
+        for (quint64 id : ids) {
+            auto it = m_subscriptions.constFind(id);
+            if (it != m_subscriptions.constEnd()) targets.append({id, it->channel});
+        }
+    }
+    int delivered = 0;
+    QList<quint64> stale;
+    for (const auto& target : targets) {
+        if (target.second->push(payload)) ++delivered;
+        else stale.append(target.first);
+    }
+    if (!stale.isEmpty()) {
+        QMutexLocker locker(&m_mutex);
+        for (quint64 id : stale) {
+            auto it = m_subscriptions.find(id);
+            if (it != m_subscriptions.end()) removeLocked(it);
+        }
+    }
+    return delivered;
+}
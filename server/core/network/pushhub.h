@@ -0,0 +1,54 @@
+#pragma once
+
+#include <QHash>
+#include <QJsonObject>
+#include <QMultiHash>
+#include <QMutex>
+#include <QSharedPointer>
+#include <QString>
+
+class ResponseChannel;
+
+// 服务端推送中心（单例，线程安全）：用户 -> 已订阅的连接
+// - 需要按连接订阅的业务模块以 MessageRouter::registerConnectionActions 注册 action（如聊天的 push_subscribe），
+//   收到请求所在连接的 ResponseChannel 后调用 subscribe 绑定到 user；同一用户可在多台设备（多个连接）上同时订阅
+// - 业务模块在事件发生时调用 publish，经 ResponseChannel 以 Protocol::MessageType::Push 帧直接送达，
+//   无需客户端轮询；pushTo 只发给某个订阅（用于订阅时按游标补发）
+// - 连接关闭后 deliver 失败的订阅在下次推送时顺带清理，路由器清理连接时也会主动移除
+class PushHub {
+public:
+    static PushHub& instance();
+
+    // 同一连接重复订阅同一用户时返回已有 id
+    quint64 subscribe(const QString& user, const QSharedPointer<ResponseChannel>& channel);
+    void unsubscribeChannel(const ResponseChannel* channel);
+
+    // 推送给用户所有在线设备，返回成功投递的连接数（0 表示该用户当前无订阅）
+    int publish(const QString& user, const QString& topic, const QJsonObject& data);
+    // 推送给所有订阅者（如影响所有患者的号源变化）
+    int broadcast(const QString& topic, const QJsonObject& data);
+    bool pushTo(quint64 subscriptionId, const QString& topic, const QJsonObject& data);
+
+    bool hasSubscribers(const QString& user) const;
+
+private:
+    PushHub() = default;
+    PushHub(const PushHub&) = delete;
+    PushHub& operator=(const PushHub&) = delete;
+
+    struct Subscription {
+        QString user;
+        QSharedPointer<ResponseChannel> channel;
+    };
+    // 持锁调用：从三张表中移除一个订阅
+    void removeLocked(QHash<quint64, Subscription>::iterator it);
+    // 投递到给定订阅，返回成功数；投递失败的订阅被移除
+    int deliver(const QList<quint64>& ids, const QString& topic, const QJsonObject& data);
+
+    mutable QMutex m_mutex;
+    QHash<quint64, Subscription> m_subscriptions;
+    QMultiHash<QString, quint64> m_byUser;
+    // 连接 -> 其订阅 id：断开时只移除该连接自己的订阅，开销与全服订阅数无关
+    QMultiHash<const ResponseChannel*, quint64> m_byChannel;
+    quint64 m_nextId = 0;
+};
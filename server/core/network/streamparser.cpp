@@ -1,56 +1,99 @@
 #include "core/network/streamparser.h"
+#include <QtEndian>
 
 using namespace Protocol;
 
 void StreamFrameParser::append(const QByteArray& data)
 {
-    if (!data.isEmpty())
-        m_buffer.append(data);
+    if (m_readPos > 0 && m_readPos >= m_buffer.size()) {
+        // 上一轮已全部消费：直接复位，避免无谓的搬移
+        m_buffer.resize(0);
+        m_readPos = 0;
+    }
+    if (!data.isEmpty()) {
+        if (m_buffer.isEmpty())
+            m_buffer = data; // 常见情形：一次 read 即包含完整帧，直接共享数据不拷贝
+        else
+            m_buffer.append(data);
+    }
 
     // 尽量多地解析完整帧
-    while (true) {
-        if (m_buffer.size() < FIXED_HEADER_SIZE)
-            return;
-
-        QDataStream ds(m_buffer);
-        ds.setByteOrder(QDataStream::BigEndian);
-        ds.setVersion(QDataStream::Qt_5_15);
-
-        quint32 magic;
-        quint8 version;
-        quint16 type;
-        quint32 payloadSize;
-        ds >> magic >> version >> type >> payloadSize;
+    while (m_buffer.size() - m_readPos >= FIXED_HEADER_SIZE) {
+        const auto* p = reinterpret_cast<const uchar*>(m_buffer.constData()) + m_readPos;
+        const quint32 magic = qFromBigEndian<quint32>(p);
+        const quint8 version = p[4];
+        const quint16 type = qFromBigEndian<quint16>(p + 5);
+        const quint32 payloadSize = qFromBigEndian<quint32>(p + 7);
 
-        if (magic != MAGIC || version != VERSION) {
+        if (magic != MAGIC || (version != VERSION && version != VERSION_V2)) {
             emit protocolError(QStringLiteral("Invalid header: magic/version mismatch"));
-            m_buffer.clear();
+            reset();
             return;
         }
         if (payloadSize > (quint32)MAX_PACKET_SIZE) {
             emit protocolError(QStringLiteral("Payload too large"));
-            m_buffer.clear();
+            reset();
             return;
         }
 
-        const int total = FIXED_HEADER_SIZE + static_cast<int>(payloadSize);
-        if (m_buffer.size() < total)
-            return; // incomplete
-
-        QByteArray payload = m_buffer.mid(FIXED_HEADER_SIZE, payloadSize);
-        m_buffer.remove(0, total);
+        const int hdrSize = headerSize(version);
+        const int total = hdrSize + static_cast<int>(payloadSize);
+        if (m_buffer.size() - m_readPos < total)
+            break; // incomplete
 
         Header header;
         header.magic = magic;
         header.version = version;
-        header.type = static_cast<MessageType>(type);
+        header.type = static_cast<MessageType>(type & ~COMPRESSED_FLAG);
         header.payloadSize = payloadSize;
+        header.compressed = (type & COMPRESSED_FLAG) != 0;
+        if (version == VERSION_V2) {
+            header.flags = qFromBigEndian<quint16>(p + FIXED_HEADER_SIZE);
+            header.requestId = qFromBigEndian<quint64>(p + FIXED_HEADER_SIZE + 2);
+        }
+
+        const QByteArray raw = QByteArray::fromRawData(
+            m_buffer.constData() + m_readPos + hdrSize, static_cast<int>(payloadSize));
+        m_readPos += total;
+
+        if (!header.compressed) {
+            emit frameReady(header, raw);
+            continue;
+        }
+        // 压缩帧：qCompress 格式前 4 字节为大端原始长度，先校验上限再解压
+        const quint32 expected = payloadSize >= 4 ? qFromBigEndian<quint32>(raw.constData()) : 0;
+        const QByteArray payload = (expected > 0 && expected <= (quint32)MAX_UNCOMPRESSED_SIZE)
+            ? qUncompress(raw)
+            : QByteArray();
+        if (payload.isEmpty()) {
+            emit protocolError(QStringLiteral("Invalid compressed payload"));
+            reset();
+            return;
+        }
         emit frameReady(header, payload);
-        // loop to parse more if available
+        // loop to parse more if available（槽内调用 reset() 时 m_readPos 归零，循环自然结束）
+    }
+    compact();
+}
+
+void StreamFrameParser::compact()
+{
+    if (m_readPos == 0)
+        return;
+    if (m_readPos >= m_buffer.size()) {
+        m_buffer.resize(0);
+        m_readPos = 0;
+        return;
+    }
+    // 仅当已消费部分足够大时才整体前移一次，摊还为线性开销
+    if (m_readPos >= COMPACT_THRESHOLD && m_readPos * 2 >= m_buffer.size()) {
+        m_buffer.remove(0, m_readPos);
+        m_readPos = 0;
     }
 }
 
 void StreamFrameParser::reset()
 {
     m_buffer.clear();
+    m_readPos = 0;
 }
@@ -2,10 +2,18 @@
 
 #include <QObject>
 #include <QByteArray>
-#include <QDataStream>
 #include "core/network/protocol.h"
 
 // 增量流解析器：将输入字节流按协议拆分为完整帧（服务端复用）
+//
+// 解析采用“读偏移 + 延迟整理”的方式：
+// - 头部用大端直接读取（qFromBigEndian），不再为每帧构造 QDataStream；
+// - 已消费的字节只推进 m_readPos，不逐帧 remove；缓冲区整体消费完时直接清空，
+//   已消费部分超过阈值且占一半以上时才整体前移一次；
+// - frameReady 中的 payload 是指向内部缓冲区的只读视图（QByteArray::fromRawData），
+//   仅在信号的同步处理期间有效。槽函数必须以 Qt::DirectConnection 连接；
+//   若需在返回后保留数据，请显式深拷贝：QByteArray(payload.constData(), payload.size())。
+// - 压缩帧（type 含 COMPRESSED_FLAG）在此统一解压，header.type 已去除标志位，下游无需关心压缩。
 class StreamFrameParser : public QObject {
     Q_OBJECT
 public:
@@ -23,5 +31,11 @@ signals:
     void protocolError(const QString& message);
 
 private:
+    // 已消费字节超过该值（且超过缓冲区一半）时才整理缓冲区
+    static constexpr int COMPACT_THRESHOLD = 64 * 1024;
+
+    void compact();
+
     QByteArray m_buffer;
+    int m_readPos = 0; // m_buffer 中尚未解析数据的起始偏移
 };
@@ -0,0 +1,77 @@
+#include "core/storage/blobstore.h"
+#include <QCryptographicHash>
+#include <QFile>
+#include <QFileInfo>
+#include <QDebug>
+
+BlobStore& BlobStore::instance()
+{
+    static BlobStore store;
+    return store;
+}
+
+QString BlobStore::put(const QByteArray& bytes)
+{
+    const QString hash = QString::fromLatin1(QCryptographicHash::hash(bytes, QCryptographicHash::Sha256).toHex());
+    QWriteLocker locker(&m_lock);
+    if (!m_blobs.contains(hash)) {
+        m_blobs.insert(hash, bytes);
+        m_totalBytes += bytes.size();
+    }
+    return hash;
+}
+
+QString BlobStore::putFile(const QString& path)
+{
+    const QString key = QFileInfo(path).absoluteFilePath();
+    {
+        QReadLocker locker(&m_lock);
+        auto it = m_pathToHash.constFind(key);
+        if (it != m_pathToHash.constEnd())
+            return it.value();
+    }
+    QFile f(path);
+    if (!f.open(QIODevice::ReadOnly)) {
+        qWarning() << "[ BlobStore ] 无法读取文件:" << path;
+        return QString();
+    }
+    const QString hash = put(f.readAll());
+    QWriteLocker locker(&m_lock);
+    m_pathToHash.insert(key, hash);
+    return hash;
+}
+
+bool BlobStore::get(const QString& hash, QByteArray& out) const
+{
+    QReadLocker locker(&m_lock);
+    auto it = m_blobs.constFind(hash);
+    if (it == m_blobs.constEnd())
+        return false;
+    out = it.value();
+    return true;
+}
+
+bool BlobStore::contains(const QString& hash) const
+{
+    QReadLocker locker(&m_lock);
+    return m_blobs.contains(hash);
+}
+
+qint64 BlobStore::sizeOf(const QString& hash) const
+{
+    QReadLocker locker(&m_lock);
+    auto it = m_blobs.constFind(hash);
+    return it == m_blobs.constEnd() ? -1 : it.value().size();
+}
+
+int BlobStore::count() const
+{
+    QReadLocker locker(&m_lock);
+    return m_blobs.size();
+}
+
+qint64 BlobStore::totalBytes() const
+{
+    QReadLocker locker(&m_lock);
+    return m_totalBytes;
+}
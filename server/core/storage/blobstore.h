@@ -0,0 +1,38 @@
+#pragma once
+
+#include <QByteArray>
+#include <QHash>
+#include <QReadWriteLock>
+#include <QString>
+
+// 内容寻址的内存 blob 存储：以 SHA-256（十六进制）作为键保存不可变字节
+// - 同一内容只保存一份，重复 put 直接返回已有哈希
+// - 写入一般发生在模块初始化阶段，之后读多写少，使用读写锁保证线程安全
+// - 客户端通过 FileDownloadRequest{ blob: hash } 按哈希拉取，哈希不变即可长期缓存
+class BlobStore {
+public:
+    static BlobStore& instance();
+
+    // 保存字节并返回其哈希
+    QString put(const QByteArray& bytes);
+    // 读取文件并保存，失败返回空字符串；同一路径只读取一次
+    QString putFile(const QString& path);
+
+    bool get(const QString& hash, QByteArray& out) const;
+    bool contains(const QString& hash) const;
+    // 未找到返回 -1
+    qint64 sizeOf(const QString& hash) const;
+
+    int count() const;
+    qint64 totalBytes() const;
+
+private:
+    BlobStore() = default;
+    BlobStore(const BlobStore&) = delete;
+    BlobStore& operator=(const BlobStore&) = delete;
+
+    mutable QReadWriteLock m_lock;
+    QHash<QString, QByteArray> m_blobs;
+    QHash<QString, QString> m_pathToHash;
+    qint64 m_totalBytes = 0;
+};
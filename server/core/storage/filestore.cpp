@@ -0,0 +1,71 @@
+#include "core/storage/filestore.h"
+#include <QCryptographicHash>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+
+FileStore& FileStore::instance()
+{
+    static FileStore store;
+    return store;
+}
+
+bool FileStore::isValidHash(const QString& hash)
+{
+    if (hash.size() != 64) return false;
+    for (const QChar c : hash) {
+        if (!((c >= QLatin1Char('0') && c <= QLatin1Char('9')) || (c >= QLatin1Char('a') && c <= QLatin1Char('f'))))
+            return false;
+    }
+    return true;
+}
+
+QString FileStore::pathFor(const QString& hash) const
+{
+    return QStringLiteral("%1/%2/%3/%4").arg(m_root, hash.left(2), hash.mid(2, 2), hash);
+}
+
+bool FileStore::contains(const QString& hash) const
+{
+    return isValidHash(hash) && QFileInfo::exists(pathFor(hash));
+}
+
+qint64 FileStore::sizeOf(const QString& hash) const
+{
+    if (!isValidHash(hash)) return -1;
+    const QFileInfo info(pathFor(hash));
+    return info.exists() ? info.size() : -1;
+}
+
+bool FileStore::adopt(const QString& tempPath, const QString& hash, QString& error)
+{
+    if (!isValidHash(hash)) {
+        error = QStringLiteral("invalid hash");
+        return false;
+    }
+    const QString target = pathFor(hash);
+    if (QFileInfo::exists(target)) {
+        // 内容已存在：丢弃重复的副本
+        QFile::remove(tempPath);
+        return true;
+    }
+    QDir().mkpath(QFileInfo(target).absolutePath());
+    // 临时文件与对象目录位于同一文件系统，rename 为原子操作；并发收入同一内容时后到者改名失败，丢弃其副本即可
+    if (!QFile::rename(tempPath, target) && !QFileInfo::exists(target)) {
+        qWarning() << "[ FileStore ] 收入文件失败:" << tempPath << "->" << target;
+        error = QStringLiteral("rename failed");
+        return false;
+    }
+    QFile::remove(tempPath);
+    return true;
+}
+
+QString FileStore::hashFile(const QString& path)
+{
+    QFile f(path);
+    if (!f.open(QIODevice::ReadOnly)) return QString();
+    QCryptographicHash hash(QCryptographicHash::Sha256);
+    if (!hash.addData(&f)) return QString();
+    return QString::fromLatin1(hash.result().toHex());
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <QString>
+
+// 内容寻址的磁盘文件存储：以 SHA-256（十六进制）作为文件名保存上传内容
+// - 路径按哈希前缀分两级目录：<root>/ab/cd/abcd...，避免单目录文件过多
+// - 同一内容只保存一份；上传完成后临时文件经 rename 原子地放入最终位置，读者不会看到半个文件
+// - 对象的引用计数记录在数据库 file_objects 表中（聊天附件等引用方增加计数），本类只负责磁盘布局
+// - 客户端通过 FileDownloadRequest{ blob: hash } 下载（BlobStore 中没有时由本存储提供）
+class FileStore {
+public:
+    static FileStore& instance();
+
+    QString root() const { return m_root; }
+    QString pathFor(const QString& hash) const;
+    bool contains(const QString& hash) const;
+    // 未找到返回 -1
+    qint64 sizeOf(const QString& hash) const;
+
+    // 将已写完的临时文件收入存储；hash 为调用方计算好的内容哈希。已存在同内容时删除临时文件
+    bool adopt(const QString& tempPath, const QString& hash, QString& error);
+
+    // 流式计算文件的 SHA-256，失败返回空字符串
+    static QString hashFile(const QString& path);
+    static bool isValidHash(const QString& hash);
+
+private:
+    FileStore() = default;
+    FileStore(const FileStore&) = delete;
+    FileStore& operator=(const FileStore&) = delete;
+
+    QString m_root = QStringLiteral("files/objects");
+};
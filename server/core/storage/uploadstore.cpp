@@ -0,0 +1,287 @@
+#include "core/storage/uploadstore.h"
+#include "core/network/protocol.h"
+#include "core/storage/filestore.h"
+#include "core/database/database.h"
+#include "core/database/writequeue.h"
+#include <QDateTime>
+#include <QDebug>
+#include <QDir>
+#include <QFileInfo>
+#include <QThreadPool>
+#include <limits>
+
+namespace {
+// 秒传（begin 在 I/O 线程）时登记文件对象及其上传名：交给写线程异步执行，不阻塞 I/O；
+// 提交后才在 context 线程回调成功应答（客户端收到 ack 即可按名下载），失败时回 500，客户端按上传失败处理
+void registerObject(const QJsonObject& ack, QObject* context, const UploadStore::AckCallback& done)
+{
+    const QString hash = ack.value("hash").toString();
+    const qint64 size = ack.value("size").toVariant().toLongLong();
+    const QString name = ack.value("file").toString();
+    DBWriteQueue::instance().submit([hash, size, name](DBManager& db, QJsonObject&) {
+        return db.registerFileObject(hash, size) && db.registerFileName(name, hash);
+    }, context, [ack, done](bool ok, const QJsonObject&) {
+        if (ok) done(true, ack);
+        else done(false, QJsonObject{{"code", 500}, {"message", "register failed"}, {"upload_id", ack.value("upload_id")}});
+    });
+}
+}
+
+UploadStore& UploadStore::instance()
+{
+    static UploadStore store;
+    return store;
+}
+
+QSharedPointer<UploadStore::Session> UploadStore::find(quint64 id) const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_sessions.value(id);
+}
+
+void UploadStore::begin(const QString& baseDir, const QJsonObject& meta, QObject* context, AckCallback done)
+{
+    QJsonObject ackOrErr;
+    const bool ok = open(baseDir, meta, ackOrErr);
+    if (ok && ackOrErr.value("deduplicated").toBool()) {
+        registerObject(ackOrErr, context, done);
+        return;
+    }
+    done(ok, ackOrErr);
+}
+
+bool UploadStore::open(const QString& baseDir, const QJsonObject& meta, QJsonObject& ackOrErr)
+{
+    const QString idText = meta.value("upload_id").toString();
+    const quint64 id = Protocol::uploadIdFromString(idText);
+    const QString name = meta.value("name").toString();
+    const qint64 size = meta.value("size").toVariant().toLongLong();
+    if (id == 0 || name.isEmpty() || size < 0) {
+        ackOrErr = QJsonObject{{"code", 400}, {"message", "invalid meta"}, {"upload_id", idText}};
+        return false;
+    }
+    const qint64 chunks = (size + Protocol::FILE_CHUNK_SIZE - 1) / Protocol::FILE_CHUNK_SIZE;
+    if (chunks > std::numeric_limits<int>::max()) {
+        ackOrErr = QJsonObject{{"code", 413}, {"message", "file too large"}, {"upload_id", idText}};
+        return false;
+    }
+    // 客户端可预先声明内容哈希：服务端已有同内容时直接完成，不再传输任何数据
+    const QString hash = meta.value("hash").toString().toLower();
+    if (!hash.isEmpty() && !FileStore::isValidHash(hash)) {
+        ackOrErr = QJsonObject{{"code", 400}, {"message", "invalid hash"}, {"upload_id", idText}};
+        return false;
+    }
+    if (!hash.isEmpty() && FileStore::instance().sizeOf(hash) == size) {
+        ackOrErr = QJsonObject{{"upload_id", idText}, {"uploaded", true}, {"file", name},
+                               {"hash", hash}, {"size", size}, {"deduplicated", true}};
+        return true;
+    }
+    purgeStale();
+
+    if (QSharedPointer<Session> existing = find(id)) {
+        // 续传：同一 upload_id 必须对应同一文件
+        QMutexLocker locker(&existing->mutex);
+        if (existing->name != name || existing->size != size || existing->expectedHash != hash) {
+            ackOrErr = QJsonObject{{"code", 409}, {"message", "upload_id conflict"}, {"upload_id", idText}};
+            return false;
+        }
+        existing->lastActive = QDateTime::currentMSecsSinceEpoch();
+        ackOrErr = ackFor(*existing);
+        return true;
+    }
+
+    QSharedPointer<Session> session(new Session);
+    session->id = id;
+    session->name = name;
+    session->size = size;
+    session->expectedHash = hash;
+    session->partPath = QDir(baseDir).filePath(QStringLiteral(".uploads/%1.part").arg(Protocol::uploadIdToString(id)));
+    session->received.resize(static_cast<int>(chunks));
+    session->lastActive = QDateTime::currentMSecsSinceEpoch();
+    QDir().mkpath(QFileInfo(session->partPath).absolutePath());
+    session->file.setFileName(session->partPath);
+    // 预分配完整大小，之后各块按偏移直接写入
+    if (!session->file.open(QIODevice::ReadWrite | QIODevice::Truncate) || !session->file.resize(size)) {
+        qWarning() << "[ UploadStore ] 创建上传文件失败:" << session->partPath << session->file.errorString();
+        session->file.close();
+        QFile::remove(session->partPath);
+        ackOrErr = QJsonObject{{"code", 500}, {"message", "open failed"}, {"upload_id", idText}};
+        return false;
+    }
+
+    QMutexLocker locker(&m_mutex);
+    // 并发的同 id meta：以先登记者为准
+    auto it = m_sessions.constFind(id);
+    if (it != m_sessions.constEnd()) {
+        locker.unlock();
+        session->file.close();
+        QFile::remove(session->partPath);
+        return open(baseDir, meta, ackOrErr);
+    }
+    m_sessions.insert(id, session);
+    locker.unlock();
+    ackOrErr = ackFor(*session);
+    return true;
+}
+
+bool UploadStore::writeChunk(const QByteArray& payload, QJsonObject& err)
+{
+    quint64 id = 0;
+    qint64 offset = 0;
+    quint32 crc = 0;
+    QByteArray data;
+    if (!Protocol::parseUploadChunk(payload, id, offset, crc, data)) {
+        err = QJsonObject{{"code", 400}, {"message", "invalid chunk"}};
+        return false;
+    }
+    const QString idText = Protocol::uploadIdToString(id);
+    QSharedPointer<Session> session = find(id);
+    if (!session) {
+        err = QJsonObject{{"code", 404}, {"message", "unknown upload"}, {"upload_id", idText}};
+        return false;
+    }
+    if (Protocol::crc32(data.constData(), data.size()) != crc) {
+        err = QJsonObject{{"code", 422}, {"message", "crc mismatch"}, {"upload_id", idText}, {"offset", offset}};
+        return false;
+    }
+    // 块必须对齐且长度与其位置匹配（末块可短）
+    const qint64 expected = qMin<qint64>(Protocol::FILE_CHUNK_SIZE, session->size - offset);
+    if (offset < 0 || offset % Protocol::FILE_CHUNK_SIZE != 0 || offset >= session->size || data.size() != expected) {
+        err = QJsonObject{{"code", 416}, {"message", "bad chunk range"}, {"upload_id", idText}, {"offset", offset}};
+        return false;
+    }
+    const int index = static_cast<int>(offset / Protocol::FILE_CHUNK_SIZE);
+
+    QMutexLocker locker(&session->mutex);
+    if (!session->file.isOpen()) {
+        // 会话已完成或已被清理
+        err = QJsonObject{{"code", 404}, {"message", "unknown upload"}, {"upload_id", idText}};
+        return false;
+    }
+    session->lastActive = QDateTime::currentMSecsSinceEpoch();
+    if (session->received.testBit(index)) return true; // 重传的块直接确认
+    if (!session->file.seek(offset) || session->file.write(data) != data.size()) {
+        err = QJsonObject{{"code", 500}, {"message", "write failed"}, {"upload_id", idText}, {"offset", offset}};
+        return false;
+    }
+    session->received.setBit(index);
+    ++session->receivedCount;
+    return true;
+}
+
+void UploadStore::finish(const QJsonObject& req, AckCallback done)
+{
+    const QString idText = req.value("upload_id").toString();
+    const quint64 id = Protocol::uploadIdFromString(idText);
+    QSharedPointer<Session> session = find(id);
+    if (!session) {
+        done(false, QJsonObject{{"code", 404}, {"message", "unknown upload"}, {"upload_id", idText}});
+        return;
+    }
+
+    {
+        QMutexLocker locker(&session->mutex);
+        if (session->finishing) {
+            // 重复的完成请求：结果由第一次请求的应答带回
+            done(false, QJsonObject{{"code", 409}, {"message", "finish in progress"}, {"upload_id", idText}});
+            return;
+        }
+        if (!session->file.isOpen()) {
+            done(false, QJsonObject{{"code", 404}, {"message", "unknown upload"}, {"upload_id", idText}});
+            return;
+        }
+        session->lastActive = QDateTime::currentMSecsSinceEpoch();
+        if (session->receivedCount < session->received.size()) {
+            done(true, ackFor(*session));
+            return;
+        }
+        session->file.flush();
+        session->file.close();
+        session->finishing = true;
+    }
+    // 文件已关闭、会话标记为完成中，之后的块与完成请求都会被拒绝，线程池中可不持锁读取 .part
+    QThreadPool::globalInstance()->start([this, session, done]() { complete(session, done); });
+}
+
+void UploadStore::complete(const QSharedPointer<Session>& session, const AckCallback& done)
+{
+    const QString idText = Protocol::uploadIdToString(session->id);
+    // 块乱序到达，只能在到齐后整体计算内容哈希，再按哈希收入 FileStore（同内容只保存一份）
+    const QString hash = FileStore::hashFile(session->partPath);
+    QString error;
+    QJsonObject ackOrErr;
+    if (hash.isEmpty()) {
+        QFile::remove(session->partPath);
+        ackOrErr = QJsonObject{{"code", 500}, {"message", "read failed"}, {"upload_id", idText}};
+    } else if (!session->expectedHash.isEmpty() && hash != session->expectedHash) {
+        QFile::remove(session->partPath);
+        ackOrErr = QJsonObject{{"code", 422}, {"message", "hash mismatch"}, {"upload_id", idText}};
+    } else if (!FileStore::instance().adopt(session->partPath, hash, error)) {
+        QFile::remove(session->partPath);
+        ackOrErr = QJsonObject{{"code", 500}, {"message", error}, {"upload_id", idText}};
+    } else {
+        ackOrErr = QJsonObject{{"upload_id", idText}, {"uploaded", true}, {"file", session->name},
+                               {"hash", hash}, {"size", session->size}};
+    }
+    {
+        QMutexLocker tableLocker(&m_mutex);
+        m_sessions.remove(session->id);
+    }
+    if (!ackOrErr.value("uploaded").toBool()) {
+        done(false, ackOrErr);
+        return;
+    }
+    // 线程池线程可以阻塞：登记提交后再应答，客户端收到 ack 即可按名下载；登记失败按上传失败回报
+    const QString name = session->name;
+    const qint64 size = session->size;
+    const bool registered = DBWriteQueue::instance().write([&](DBManager& db) {
+        return db.registerFileObject(hash, size) && db.registerFileName(name, hash);
+    });
+    if (registered) done(true, ackOrErr);
+    else done(false, QJsonObject{{"code", 500}, {"message", "register failed"}, {"upload_id", idText}});
+}
+
+void UploadStore::purgeStale()
+{
+    const qint64 cutoff = QDateTime::currentMSecsSinceEpoch() - SESSION_TTL_MS;
+    QList<QSharedPointer<Session>> stale;
+    {
+        QMutexLocker locker(&m_mutex);
+        for (auto it = m_sessions.begin(); it != m_sessions.end();) {
+            if (it.value()->lastActive < cutoff) {
+                stale.append(it.value());
+                it = m_sessions.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+    for (const auto& session : stale) {
+        QMutexLocker locker(&session->mutex);
+        session->file.close();
+        QFile::remove(session->partPath);
+        qInfo() << "[ UploadStore ] 清理闲置上传:" << session->name;
+    }
+}
+
+QJsonArray UploadStore::missingRanges(const Session& session)
+{
+    QJsonArray ranges;
+    const int count = session.received.size();
+    for (int i = 0; i < count;) {
+        if (session.received.testBit(i)) { ++i; continue; }
+        const int first = i;
+        while (i < count && !session.received.testBit(i)) ++i;
+        ranges.append(QJsonArray{first, i - 1});
+    }
+    return ranges;
+}
+
+QJsonObject UploadStore::ackFor(const Session& session)
+{
+    return QJsonObject{
+        {"upload_id", Protocol::uploadIdToString(session.id)},
+        {"chunk_size", Protocol::FILE_CHUNK_SIZE},
+        {"missing", missingRanges(session)},
+    };
+}
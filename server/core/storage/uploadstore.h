@@ -0,0 +1,70 @@
+#pragma once
+
+#include <QBitArray>
+#include <QFile>
+#include <QHash>
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QMutex>
+#include <QSharedPointer>
+#include <QString>
+
+class QObject;
+#include <atomic>
+#include <functional>
+
+// 可续传上传的会话表（进程级，各 I/O 线程共享）：以客户端生成的 upload_id 为键
+// - meta 到达时在 <baseDir>/.uploads/<upload_id>.part 按完整大小预分配文件，并记录每个块是否已落盘
+// - 块携带绝对偏移与 CRC-32，校验通过后 seek + write 定位写入，允许乱序、重复到达，也允许多个连接写同一会话
+// - 会话不随连接销毁：客户端重连后以同一 upload_id 重发 meta，即可取得缺失块列表继续上传
+// - 所有块到齐后 finish 在全局线程池中计算内容哈希（耗时与文件大小成正比，不占用 I/O 线程），
+//   将 .part 原子改名收入 FileStore，并在 file_objects/file_names 表登记，提交后才应答；内容按哈希存放，不同上传同名也不会互相覆盖
+// 会话仅登记在内存中，服务端重启后客户端需从头上传；闲置超过 SESSION_TTL_MS 的会话在下次 begin 时清理
+class UploadStore {
+public:
+    static UploadStore& instance();
+
+    // 应答回调须线程安全：可能在 context 所在线程或线程池线程调用
+    using AckCallback = std::function<void(bool ok, const QJsonObject& ackOrErr)>;
+
+    // meta={upload_id, name, size, hash?}；成功时 ack={upload_id, chunk_size, missing:[[first, last], ...]}（块序号闭区间）。
+    // 带 hash 且 FileStore 已有该内容时直接完成：ack={upload_id, uploaded, file, hash, size, deduplicated}，
+    // 该 ack 在文件对象与文件名登记提交后才经 context 线程回调，登记失败回 500
+    void begin(const QString& baseDir, const QJsonObject& meta, QObject* context, AckCallback done);
+    // payload 为完整的 FileUploadChunk 负载（块头部 + 数据）
+    bool writeChunk(const QByteArray& payload, QJsonObject& err);
+    // req={upload_id}；块已到齐时 ack={upload_id, uploaded, file, hash, size}，否则 ack 仍为缺失块列表，客户端补发后再次完成。
+    // 未到齐或出错时在当前线程立即回调；到齐时哈希、入库与登记在线程池进行，登记提交后在线程池线程回调，登记失败回 500
+    void finish(const QJsonObject& req, AckCallback done);
+
+    static constexpr qint64 SESSION_TTL_MS = 24LL * 60 * 60 * 1000; // 24h
+
+private:
+    UploadStore() = default;
+    UploadStore(const UploadStore&) = delete;
+    UploadStore& operator=(const UploadStore&) = delete;
+
+    struct Session {
+        QMutex mutex;               // 保护 file/received/receivedCount
+        quint64 id = 0;
+        QString name;
+        QString partPath;
+        QString expectedHash;       // 客户端声明的内容哈希（可空），完成时校验
+        qint64 size = 0;
+        QFile file;
+        QBitArray received;
+        int receivedCount = 0;
+        bool finishing = false;     // 已到齐、正在线程池中计算哈希（此时文件已关闭）
+        std::atomic<qint64> lastActive {0}; // 毫秒时间戳，清理时无需持有会话锁
+    };
+
+    QSharedPointer<Session> find(quint64 id) const;
+    void purgeStale();
+    static QJsonArray missingRanges(const Session& session);
+    static QJsonObject ackFor(const Session& session);
+    bool open(const QString& baseDir, const QJsonObject& meta, QJsonObject& ackOrErr);
+    void complete(const QSharedPointer<Session>& session, const AckCallback& done);
+
+    mutable QMutex m_mutex; // 保护 m_sessions；持有期间不获取会话锁
+    QHash<quint64, QSharedPointer<Session>> m_sessions;
+};
@@ -0,0 +1,135 @@
+#include "core/timer/timerwheel.h"
+#include "core/logging/logging.h"
+#include <QThreadStorage>
+
+namespace {
+constexpr quint64 SLOT_MASK = TimerWheel::SLOTS - 1;
+// 最高层也放不下的延时按此上限处理
+constexpr quint64 MAX_DELTA = (quint64(1) << (TimerWheel::SLOT_BITS * TimerWheel::LEVELS)) - 1;
+}
+
+TimerWheel& TimerWheel::forCurrentThread()
+{
+    // QThreadStorage 在线程结束时（主线程为 QCoreApplication 销毁时）于该线程内删除实例
+    static QThreadStorage<TimerWheel*> wheels;
+    if (!wheels.hasLocalData()) wheels.setLocalData(new TimerWheel);
+    return *wheels.localData();
+}
+
+TimerWheel::TimerWheel(QObject* parent)
+    : QObject(parent)
+{
+    m_clock.start();
+    m_ticker.setInterval(TICK_MS);
+    if (!connect(&m_ticker, &QTimer::timeout, this, &TimerWheel::onTick)) {
+        Log::error("TimerWheel", "Failed to connect QTimer::timeout to TimerWheel::onTick");
+    }
+}
+
+quint64 TimerWheel::ticksFor(qint64 delayMs) const
+{
+    // 向上取整再多留一个 tick：当前 tick 已过去的部分不计入，保证不会早于 delayMs 触发
+    const quint64 ticks = delayMs > 0 ? static_cast<quint64>((delayMs + TICK_MS - 1) / TICK_MS) : 0;
+    return elapsedTicks() + ticks + 1;
+}
+
+quint64 TimerWheel::schedule(qint64 delayMs, Callback callback)
+{
+    // 空轮期间 m_now 不前进：直接对齐到当前时间，无需逐 tick 追赶
+    if (m_timers.isEmpty()) m_now = elapsedTicks();
+    const quint64 id = ++m_nextId;
+    auto it = m_timers.insert(id, Timer{});
+    it->expires = ticksFor(delayMs);
+    it->callback = std::move(callback);
+    link(id, *it);
+    if (!m_ticker.isActive()) m_ticker.start();
+    return id;
+}
+
+bool TimerWheel::cancel(quint64 id)
+{
+    auto it = m_timers.find(id);
+    if (it == m_timers.end()) return false;
+    unlink(*it);
+    m_timers.erase(it);
+    if (m_timers.isEmpty()) m_ticker.stop();
+    return true;
+}
+
+bool TimerWheel::reschedule(quint64 id, qint64 delayMs)
+{
+    auto it = m_timers.find(id);
+    if (it == m_timers.end()) return false;
+    unlink(*it);
+    it->expires = ticksFor(delayMs);
+    link(id, *it);
+    return true;
+}
+
+void TimerWheel::link(quint64 id, Timer& timer)
+{
+    if (timer.expires < m_now) timer.expires = m_now;
+    quint64 delta = timer.expires - m_now;
+    if (delta > MAX_DELTA) {
+        delta = MAX_DELTA;
+        timer.expires = m_now + MAX_DELTA;
+    }
+    // 第 n 层容纳 delta < SLOTS^(n+1) 的定时器，槽号取 expires 的第 n 组 SLOT_BITS 位
+    int level = 0;
+    while (level < LEVELS - 1 && delta >= (quint64(1) << (SLOT_BITS * (level + 1)))) ++level;
+    timer.level = level;
+    timer.slot = static_cast<int>((timer.expires >> (SLOT_BITS * level)) & SLOT_MASK);
+
+    quint64& head = m_slots[level][timer.slot];
+    timer.prev = 0;
+    timer.next = head;
+    if (head) m_timers.find(head)->prev = id;
+    head = id;
+}
+
+void TimerWheel::unlink(Timer& timer)
+{
+    if (timer.prev) m_timers.find(timer.prev)->next = timer.next;
+    else m_slots[timer.level][timer.slot] = timer.next;
+    if (timer.next) m_timers.find(timer.next)->prev = timer.prev;
+    timer.prev = timer.next = 0;
+}
+
+void TimerWheel::cascade(int level, int slot)
+{
+    // 整槽摘下后按剩余时间重新挂入更低层
+    quint64 id = m_slots[level][slot];
+    m_slots[level][slot] = 0;
+    while (id) {
+        Timer& timer = *m_timers.find(id);
+        const quint64 next = timer.next;
+        link(id, timer);
+        id = next;
+    }
+}
+
+void TimerWheel::onTick()
+{
+    // 事件循环繁忙导致 QTimer 迟到时逐 tick 追上，保证高层槽按序下放
+    const quint64 target = elapsedTicks();
+    while (m_now <= target && !m_timers.isEmpty()) {
+        const int index = static_cast<int>(m_now & SLOT_MASK);
+        if (index == 0) {
+            for (int level = 1; level < LEVELS; ++level) {
+                const int slot = static_cast<int>((m_now >> (SLOT_BITS * level)) & SLOT_MASK);
+                cascade(level, slot);
+                if (slot != 0) break;
+            }
+        }
+        // 回调可能 schedule/cancel 其他定时器，每次都从槽头重新取
+        while (const quint64 id = m_slots[0][index]) {
+            auto it = m_timers.find(id);
+            unlink(*it);
+            const Callback callback = std::move(it->callback);
+            m_timers.erase(it);
+            callback();
+        }
+        ++m_now;
+    }
+    if (m_timers.isEmpty()) m_ticker.stop();
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <QElapsedTimer>
+#include <QHash>
+#include <QObject>
+#include <QTimer>
+#include <functional>
+
+// 分层时间轮（每线程一个实例，非线程安全）：集中承载长轮询超时、连接空闲检测等大量低精度定时任务
+// - 精度为 TICK_MS；共 LEVELS 层、每层 SLOTS 个槽，第 n 层每槽跨度为 SLOTS^n 个 tick，
+//   最长可表示约 19 天，更长的延时按上限处理
+// - 定时器以整数 id 标识，存放在哈希表中，同槽定时器按 id 串成双向链表：schedule/cancel/reschedule 均为 O(1)
+// - 高层槽在低层转完一圈时整体下放（cascade），每个定时器最多被搬动 LEVELS-1 次
+// - 回调在调用 schedule 的线程中执行；没有待触发定时器时底层 QTimer 停止，空闲线程不会被周期唤醒
+// 使用方须在对象销毁前 cancel 自己登记的定时器（回调通常捕获 this）
+class TimerWheel : public QObject {
+    Q_OBJECT
+public:
+    using Callback = std::function<void()>;
+
+    static constexpr int TICK_MS = 100;
+    static constexpr int SLOT_BITS = 6;
+    static constexpr int SLOTS = 1 << SLOT_BITS; // 64
+    static constexpr int LEVELS = 4;
+
+    // 当前线程的时间轮（首次调用时创建，线程结束时随线程销毁）；该线程须运行事件循环
+    static TimerWheel& forCurrentThread();
+
+    // delayMs 后执行一次 callback，返回定时器 id（非 0）；delayMs <= 0 时在下一个 tick 执行
+    quint64 schedule(qint64 delayMs, Callback callback);
+    // 取消未触发的定时器；已触发或不存在返回 false
+    bool cancel(quint64 id);
+    // 把未触发的定时器改为从现在起 delayMs 后触发（回调不变）
+    bool reschedule(quint64 id, qint64 delayMs);
+
+    int pendingCount() const { return m_timers.size(); }
+
+private:
+    explicit TimerWheel(QObject* parent = nullptr);
+
+    struct Timer {
+        quint64 expires = 0; // 绝对 tick
+        Callback callback;
+        int level = 0;
+        int slot = 0;
+        quint64 prev = 0;    // 同槽链表前驱/后继定时器 id（0 表示无）
+        quint64 next = 0;
+    };
+
+    void link(quint64 id, Timer& timer);
+    void unlink(Timer& timer);
+    void cascade(int level, int slot);
+    void onTick();
+    quint64 elapsedTicks() const { return static_cast<quint64>(m_clock.elapsed()) / TICK_MS; }
+    quint64 ticksFor(qint64 delayMs) const;
+
+    QHash<quint64, Timer> m_timers;
+    quint64 m_slots[LEVELS][SLOTS] = {}; // 各槽链表头定时器 id
+    quint64 m_nextId = 0;
+    quint64 m_now = 0;                   // 已处理到的 tick
+    QElapsedTimer m_clock;
+    QTimer m_ticker;
+};
@@ -4,7 +4,9 @@
 #include "core/network/protocol.h"
 #include "core/network/communicationserver.h"
 #include "core/network/messagerouter.h"
-// 已有的模块（自身在构造时会连接 MessageRouter::requestReceived）
+#include "core/database/database_config.h"
+#include "core/database/dbpool.h"
+// 已有的模块（自身在构造时会向 MessageRouter 注册所处理的 action）
 #include "modules/patientmodule/medicine/medicine.h"
 #include "modules/patientmodule/evaluate/evaluate.h"
 #include "modules/patientmodule/prescription/prescription.h"
@@ -28,8 +30,14 @@ int main(int argc, char *argv[]) {
     QCoreApplication a(argc, argv);
     qRegisterMetaType<Protocol::Header>("Protocol::Header");
 
+    // 启动时一次性完成建表/迁移，之后各线程复用池化连接；迁移未完成时不启动服务
+    if (!DBConnectionPool::instance().bootstrap(DatabaseConfig::getDatabasePath())) {
+        qCritical() << "Database bootstrap failed:" << DatabaseConfig::getDatabasePath();
+        return 1;
+    }
+
     CommunicationServer server;
-    // 实例化并注册所有业务模块：它们会在构造时各自连接 MessageRouter
+    // 实例化并注册所有业务模块：它们会在构造时各自向 MessageRouter 注册 action
     MedicineModule medicineModule;
     EvaluateModule evaluateModule;
     PrescriptionModule prescriptionModule;
@@ -1,32 +1,42 @@
 #include "modules/chatmodule/chatmodule.h"
 #include "core/network/messagerouter.h"
+#include "core/network/pushhub.h"
 #include "core/database/database.h"
-#include "core/database/database_config.h"
+#include "core/database/dbpool.h"
+#include "core/database/writequeue.h"
 #include "core/logging/logging.h"
+#include "core/storage/filestore.h"
+#include "core/timer/timerwheel.h"
+#include <QDateTime>
 #include <QJsonArray>
 #include <QJsonDocument>
-#include <QTimer>
 
-ChatModule::ChatModule(QObject *parent):QObject(parent), m_db(new DBManager(DatabaseConfig::getDatabasePath())) {
-    // 订阅总线
-    QObject::connect(&MessageRouter::instance(), &MessageRouter::requestReceived,
-                     this, &ChatModule::onRequest);
+ChatModule::ChatModule(QObject *parent):QObject(parent) {
+    // 向路由器注册本模块处理的 action：事件队列与挂起轮询定时器均为模块内状态，需在本模块线程执行
+    MessageRouter::instance().registerActions(this, {
+            "request_chat", "accept_chat", "send_message", "get_history_messages", "poll_events",
+            "recent_contacts", "mark_read"},
+            &ChatModule::onRequest, MessageRouter::DispatchPolicy::Affine);
+    // 推送订阅需绑定请求所在连接：路由器随请求交来该连接的 ResponseChannel
+    MessageRouter::instance().registerConnectionActions(this, {"push_subscribe"},
+            &ChatModule::onPushSubscribe, MessageRouter::DispatchPolicy::Affine);
     QObject::connect(this, &ChatModule::businessResponse,
                      &MessageRouter::instance(), &MessageRouter::onBusinessResponse);
 }
 
-ChatModule::~ChatModule(){ delete m_db; }
+ChatModule::~ChatModule() {
+    // 挂起轮询的超时回调捕获了 this，销毁前全部取消
+    for (const quint64 id : qAsConst(m_pendingPollTimers)) TimerWheel::forCurrentThread().cancel(id);
+}
 
 void ChatModule::reply(QJsonObject resp, const QJsonObject &orig) {
-    if (orig.contains("uuid")) resp["request_uuid"] = orig.value("uuid").toString();
+    MessageRouter::stampReply(resp, orig);
     Log::response("ChatModule", resp);
     emit businessResponse(resp);
 }
 
 void ChatModule::onRequest(const QJsonObject &payload) {
     const QString a = payload.value("action").toString();
-    if (a != "request_chat" && a != "accept_chat" && a != "send_message"
-        && a != "get_history_messages" && a != "poll_events" && a != "recent_contacts") return; // 非本模块
     Log::request("ChatModule", payload, "action", a);
     QJsonObject resp;
     if (a == "request_chat") resp = handleRequestChat(payload);
@@ -35,7 +45,8 @@ void ChatModule::onRequest(const QJsonObject &payload) {
     else if (a == "get_history_messages") resp = handleGetHistory(payload);
     else if (a == "poll_events") resp = handlePollEvents(payload);
     else if (a == "recent_contacts") resp = handleRecentContacts(payload);
-    // handlePollEvents 可能异步应答（长轮询），若返回了空对象表示已挂起，不要立即reply
+    else if (a == "mark_read") resp = handleMarkRead(payload);
+    // handlePollEvents（长轮询挂起）与 handleSendMessage/handleMarkRead（等待写队列提交）可能异步应答，返回空对象时不要立即reply
     if (!resp.isEmpty()) reply(resp, payload);
 }
 
@@ -58,7 +69,6 @@ QJsonObject ChatModule::handleAcceptChat(const QJsonObject &req) {
 
 QJsonObject ChatModule::handleSendMessage(const QJsonObject &req) {
     // 将消息写入数据库
-    int id = 0; QString err;
     QJsonObject toInsert{
         {"doctor_username", req.value("doctor_user").toString()},
         {"patient_username", req.value("patient_user").toString()},
@@ -67,22 +77,57 @@ QJsonObject ChatModule::handleSendMessage(const QJsonObject &req) {
         {"message_type", req.value("message_type").toString()},
         {"text_content", req.value("text_content").toString()}
     };
-    if (req.contains("file_metadata") && req.value("file_metadata").isObject())
-        toInsert.insert("file_metadata", req.value("file_metadata").toObject());
-    if (!m_db->addChatMessage(toInsert, id, err)) {
-        return QJsonObject{{"type","send_message_response"},{"success",false},{"message",err}};
+    if (req.contains("file_metadata") && req.value("file_metadata").isObject()) {
+        QJsonObject meta = req.value("file_metadata").toObject();
+        // 附件按内容哈希引用 FileStore 中的对象：同一文件转发到多个会话只保存一份，入库时引用计数加一
+        const QString hash = meta.value("hash").toString();
+        if (!hash.isEmpty()) {
+            const qint64 size = FileStore::instance().sizeOf(hash);
+            if (size < 0) {
+                return QJsonObject{{"type","send_message_response"},{"success",false},{"message","file not uploaded"}};
+            }
+            meta["size"] = size;
+        }
+        toInsert.insert("file_metadata", meta);
     }
+    // 经组提交写队列入库：与同一时段的其他写入合并为一个事务，完成后回到本模块线程再应答与推送
+    DBWriteQueue::instance().submit([toInsert](DBManager &db, QJsonObject &result) {
+        int id = 0; QString err;
+        if (!db.insertChatMessage(toInsert, id, err)) { result["error"] = err; return false; }
+        result["id"] = id;
+        return true;
+    }, this, [this, req, toInsert](bool ok, const QJsonObject &result) {
+        onMessageStored(req, toInsert, ok, result);
+    });
+    return QJsonObject();
+}
+
+void ChatModule::onMessageStored(const QJsonObject &req, const QJsonObject &toInsert, bool ok, const QJsonObject &result) {
+    if (!ok) {
+        reply(QJsonObject{{"type","send_message_response"},{"success",false},{"message",result.value("error").toString()}}, req);
+        return;
+    }
+    const int id = result.value("id").toInt();
+    const QDateTime now = QDateTime::currentDateTimeUtc();
     QJsonObject data{{"id", id},
                      {"doctor_user", req.value("doctor_user").toString()},
                      {"patient_user", req.value("patient_user").toString()},
                      {"message_id", req.value("message_id").toString()},
-                     {"timestamp", QDateTime::currentDateTimeUtc().toString(Qt::ISODate)}};
-    // 唤醒双方的挂起轮询
+                     {"timestamp", now.toString(Qt::ISODate)}};
+    // 按入库字段直接构造消息推送给双方所有在线设备（与 getMessagesSinceForUser 的行格式一致），不再回查数据库
     const QString doctor = toInsert.value("doctor_username").toString();
     const QString patient = toInsert.value("patient_username").toString();
+    QJsonObject message = toInsert;
+    message["id"] = id;
+    if (!message.contains("file_metadata")) message["file_metadata"] = QJsonValue();
+    message["created_at"] = now.toString("yyyy-MM-dd HH:mm:ss"); // 与 SQLite CURRENT_TIMESTAMP 格式一致
+    const QJsonObject push{{"messages", QJsonArray{message}}, {"next_cursor", id}};
+    PushHub::instance().publish(doctor, "chat.messages", push);
+    if (patient != doctor) PushHub::instance().publish(patient, "chat.messages", push);
+    // 唤醒双方的挂起轮询（旧客户端）
     fulfillPendingPoll(doctor);
     fulfillPendingPoll(patient);
-    return QJsonObject{{"type","send_message_response"},{"success",true},{"data",data}};
+    reply(QJsonObject{{"type","send_message_response"},{"success",true},{"data",data}}, req);
 }
 
 QJsonObject ChatModule::handleGetHistory(const QJsonObject &req) {
@@ -91,7 +136,7 @@ QJsonObject ChatModule::handleGetHistory(const QJsonObject &req) {
     const qint64 beforeId = req.value("before_id").toVariant().toLongLong();
     const int limit = qMax(1, req.value("limit").toInt(20));
     QJsonArray arr;
-    if (!m_db->getChatHistory(doctor, patient, beforeId, limit, arr)) {
+    if (!DBLease()->getChatHistory(doctor, patient, beforeId, limit, arr)) {
         return QJsonObject{{"type","get_history_messages_response"},{"success",false},{"message","db error"}};
     }
     return QJsonObject{{"type","get_history_messages_response"},{"success",true},{"data", QJsonObject{{"doctor_user", doctor},{"patient_user", patient},{"messages", arr}, {"has_more", arr.size()>=limit}}}};
@@ -101,12 +146,31 @@ QJsonObject ChatModule::handleRecentContacts(const QJsonObject &req) {
     const QString user = req.value("user").toString();
     const int limit = qBound(1, req.value("limit").toInt(20), 100);
     QJsonArray arr;
-    if (!m_db->getRecentContactsForUser(user, limit, arr)) {
+    if (!DBLease()->getRecentContactsForUser(user, limit, arr)) {
         return QJsonObject{{"type","recent_contacts_response"},{"success",false},{"message","db error"}};
     }
     return QJsonObject{{"type","recent_contacts_response"},{"success",true},{"data", QJsonObject{{"contacts", arr}}}};
 }
 
+QJsonObject ChatModule::handleMarkRead(const QJsonObject &req) {
+    // 清零 user 与 peer 会话的未读数（recent_contacts 返回的 unread）
+    const QString user = req.value("user").toString();
+    const QString peer = req.value("peer").toString();
+    const QJsonObject resp{{"type","mark_read_response"},{"data", QJsonObject{{"peer", peer}}}};
+    if (user.isEmpty() || peer.isEmpty()) {
+        QJsonObject failed = resp; failed["success"] = false;
+        return failed;
+    }
+    // 本模块运行在主线程，不能同步等待写线程：提交后返回空对象，写入完成时再应答
+    DBWriteQueue::instance().submit([user, peer](DBManager &db, QJsonObject &) {
+        return db.markConversationRead(user, peer);
+    }, this, [this, req, resp](bool ok, const QJsonObject &) {
+        QJsonObject out = resp; out["success"] = ok;
+        reply(out, req);
+    });
+    return QJsonObject();
+}
+
 QJsonObject ChatModule::handlePollEvents(const QJsonObject &req) {
     const QString user = req.value("user").toString();
     const qint64 cursor = req.value("cursor").toVariant().toLongLong();
@@ -117,7 +181,7 @@ QJsonObject ChatModule::handlePollEvents(const QJsonObject &req) {
     bool hasInstant = m_instantEvents.contains(user) && !m_instantEvents[user].isEmpty();
     QJsonArray probe;
     if (!hasInstant) {
-        m_db->getMessagesSinceForUser(user, cursor, 1, probe);
+        DBLease()->getMessagesSinceForUser(user, cursor, 1, probe);
     }
     if (hasInstant || !probe.isEmpty()) {
         QJsonObject data = buildPollDataForUser(user, cursor, limit);
@@ -130,12 +194,11 @@ QJsonObject ChatModule::handlePollEvents(const QJsonObject &req) {
     }
 
     m_pendingPollRequests.insert(user, req);
-    auto timer = new QTimer(this);
-    timer->setSingleShot(true);
-    QObject::connect(timer, &QTimer::timeout, this, [this, user]() {
+    // 超时登记到本线程共享的时间轮，大量挂起轮询不再各占一个 QTimer
+    const quint64 timer = TimerWheel::forCurrentThread().schedule(timeoutSec * 1000LL, [this, user]() {
+        m_pendingPollTimers.remove(user);
         fulfillPendingPoll(user);
     });
-    timer->start(timeoutSec * 1000);
     m_pendingPollTimers.insert(user, timer);
 
     // 返回空对象，表示异步应答
@@ -144,21 +207,56 @@ QJsonObject ChatModule::handlePollEvents(const QJsonObject &req) {
 
 void ChatModule::enqueueInstantForPair(const QString &doctor, const QString &patient, const QJsonObject &event) {
     // 事件推送给双方
-    m_instantEvents[doctor].enqueue(event);
-    m_instantEvents[patient].enqueue(event);
+    deliverInstant(doctor, event);
+    deliverInstant(patient, event);
     // 尝试唤醒挂起的轮询
     fulfillPendingPoll(doctor);
     fulfillPendingPoll(patient);
 }
 
+void ChatModule::deliverInstant(const QString &user, const QJsonObject &event) {
+    if (PushHub::instance().publish(user, "chat.events", QJsonObject{{"events", QJsonArray{event}}}) > 0) return;
+    m_instantEvents[user].enqueue(event);
+}
+
+void ChatModule::onPushSubscribe(const QJsonObject &payload, const QSharedPointer<ResponseChannel> &channel) {
+    Log::request("ChatModule", payload, "action", payload.value("action").toString());
+    const QString user = payload.value("user").toString();
+    if (user.isEmpty()) {
+        reply(QJsonObject{{"type","push_subscribe_response"},{"success",false},{"error",QStringLiteral("缺少 user")}}, payload);
+        return;
+    }
+    // 连接随后关闭时，路由器清理连接会一并移除其订阅
+    const quint64 subscription = PushHub::instance().subscribe(user, channel);
+    reply(handlePushSubscribe(payload, subscription), payload);
+}
+
+QJsonObject ChatModule::handlePushSubscribe(const QJsonObject &req, quint64 subscription) {
+    // 订阅已绑定到本连接；此处按游标把离线期间的消息与积压事件只补发给这一台设备
+    const QString user = req.value("user").toString();
+    qint64 cursor = req.value("cursor").toVariant().toLongLong();
+    const int pageSize = 200;
+    for (;;) {
+        QJsonArray msgs;
+        if (!DBLease()->getMessagesSinceForUser(user, cursor, pageSize, msgs) || msgs.isEmpty()) break;
+        cursor = msgs.last().toObject().value("id").toVariant().toLongLong();
+        PushHub::instance().pushTo(subscription, "chat.messages", QJsonObject{{"messages", msgs}, {"next_cursor", cursor}});
+        if (msgs.size() < pageSize) break;
+    }
+    if (m_instantEvents.contains(user)) {
+        QJsonArray events;
+        for (const auto &e : m_instantEvents.take(user)) events.append(e);
+        PushHub::instance().pushTo(subscription, "chat.events", QJsonObject{{"events", events}});
+    }
+    return QJsonObject{{"type","push_subscribe_response"},{"success",true},
+                       {"data", QJsonObject{{"subscription_id", static_cast<qint64>(subscription)}, {"next_cursor", cursor}}}};
+}
+
 void ChatModule::fulfillPendingPoll(const QString &user) {
     if (!m_pendingPollRequests.contains(user)) return;
     QJsonObject orig = m_pendingPollRequests.take(user);
-    if (m_pendingPollTimers.contains(user) && m_pendingPollTimers[user]) {
-        m_pendingPollTimers[user]->stop();
-        m_pendingPollTimers[user]->deleteLater();
-        m_pendingPollTimers.remove(user);
-    }
+    const quint64 timer = m_pendingPollTimers.take(user);
+    if (timer) TimerWheel::forCurrentThread().cancel(timer);
     const qint64 cursor = orig.value("cursor").toVariant().toLongLong();
     const int limit = qBound(1, orig.value("limit").toInt(50), 200);
     QJsonObject data = buildPollDataForUser(user, cursor, limit);
@@ -176,7 +274,7 @@ QJsonObject ChatModule::buildPollDataForUser(const QString &user, qint64 cursor,
     }
     // 取新消息
     QJsonArray msgs;
-    m_db->getMessagesSinceForUser(user, cursor, limit, msgs);
+    DBLease()->getMessagesSinceForUser(user, cursor, limit, msgs);
     qint64 nextCursor = cursor;
     if (!msgs.isEmpty()) nextCursor = msgs.last().toObject().value("id").toVariant().toLongLong();
     return QJsonObject{{"messages", msgs}, {"instant_events", instant}, {"next_cursor", nextCursor}, {"has_more", msgs.size()>=limit}};
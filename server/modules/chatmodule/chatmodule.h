@@ -3,12 +3,13 @@
 #include <QJsonObject>
 #include <QQueue>
 #include <QHash>
-#include <QPointer>
-class QTimer;
+#include <QSharedPointer>
 
-class DBManager;
+class ResponseChannel;
 
-// 简化聊天模块：系统事件不入库，仅通过内存队列分发；消息入库
+
+// 简化聊天模块：消息入库；系统事件不入库。
+// 已订阅推送（push_subscribe）的连接由 PushHub 实时送达消息与事件，未订阅的旧客户端仍走 poll_events 长轮询
 class ChatModule : public QObject {
     Q_OBJECT
 public:
@@ -20,6 +21,8 @@ signals:
 
 private slots:
     void onRequest(const QJsonObject &payload);
+    // push_subscribe：校验通过后由本模块把请求所在连接登记到 PushHub
+    void onPushSubscribe(const QJsonObject &payload, const QSharedPointer<ResponseChannel> &channel);
 
 private:
     void reply(QJsonObject resp, const QJsonObject &orig);
@@ -27,9 +30,6 @@ private:
     // 系统事件队列：按参与用户聚合
     QHash<QString, QQueue<QJsonObject>> m_instantEvents; // key: username
 
-    // 数据库
-    DBManager *m_db = nullptr;
-
     // 处理动作
     QJsonObject handleRequestChat(const QJsonObject &req);
     QJsonObject handleAcceptChat(const QJsonObject &req);
@@ -37,12 +37,20 @@ private:
     QJsonObject handleGetHistory(const QJsonObject &req);
     QJsonObject handlePollEvents(const QJsonObject &req);
     QJsonObject handleRecentContacts(const QJsonObject &req);
+    QJsonObject handleMarkRead(const QJsonObject &req);
+    QJsonObject handlePushSubscribe(const QJsonObject &req, quint64 subscription);
+
+    // 消息经 DBWriteQueue 提交后（本模块线程）应答、推送并唤醒轮询
+    void onMessageStored(const QJsonObject &req, const QJsonObject &toInsert, bool ok, const QJsonObject &result);
 
     void enqueueInstantForPair(const QString &doctor, const QString &patient, const QJsonObject &event);
 
-    // 长轮询：挂起中的请求（按用户聚合）
+    // 推送给用户的在线设备；用户没有推送订阅时转入内存队列，等待长轮询取走
+    void deliverInstant(const QString &user, const QJsonObject &event);
+
+    // 长轮询（兼容未订阅推送的旧客户端）：挂起中的请求（按用户聚合）
     QHash<QString, QJsonObject> m_pendingPollRequests; // 保存原始请求（用于 request_uuid 回传与参数）
-    QHash<QString, QPointer<QTimer>> m_pendingPollTimers; // 超时计时器
+    QHash<QString, quint64> m_pendingPollTimers; // 超时定时器（本线程 TimerWheel 中的 id）
 
     // 工具方法
     void fulfillPendingPoll(const QString &user);
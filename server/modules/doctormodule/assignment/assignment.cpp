@@ -3,7 +3,8 @@
 #include <QJsonArray>
 #include <QDebug>
 #include "core/database/database.h"
-#include "core/database/database_config.h"
+#include "core/database/dbpool.h"
+#include "core/database/writequeue.h"
 
 QJsonObject DoctorAssignmentModule::handle(const QJsonObject& payload) {
 	const QString action = payload.value("action").toString();
@@ -14,8 +15,8 @@ QJsonObject DoctorAssignmentModule::handle(const QJsonObject& payload) {
 
 QJsonObject DoctorAssignmentModule::handleGet(const QJsonObject& payload) {
 	const QString username = payload.value("username").toString(payload.value("doctor_username").toString());
-	DBManager db(DatabaseConfig::getDatabasePath());
-	QJsonObject info; bool ok = db.getDoctorInfo(username, info);
+	DBLease db;
+	QJsonObject info; bool ok = db->getDoctorInfo(username, info);
 	QJsonObject data;
 	data["username"] = username;
 	data["work_time"] = info.value("title").toString();
@@ -31,8 +32,7 @@ QJsonObject DoctorAssignmentModule::handleUpdate(const QJsonObject& payload) {
 	if (data.contains("work_time")) patch["title"] = data.value("work_time").toString();
 	if (data.contains("max_patients_per_day")) patch["max_patients_per_day"] = data.value("max_patients_per_day");
 
-	DBManager db(DatabaseConfig::getDatabasePath());
-	bool ok = db.updateDoctorInfo(username, patch);
+	bool ok = DBWriteQueue::instance().write([&](DBManager &db) { return db.updateDoctorInfo(username, patch); });
 	QJsonObject resp; resp["type"] = "update_doctor_assignment_response"; resp["success"] = ok; return resp;
 }
 
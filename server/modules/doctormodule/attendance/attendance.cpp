@@ -1,6 +1,7 @@
 #include "attendance.h"
 #include "core/database/database.h"
-#include "core/database/database_config.h"
+#include "core/database/dbpool.h"
+#include "core/database/writequeue.h"
 #include <QDate>
 #include <QTime>
 
@@ -17,8 +18,8 @@ QJsonObject DoctorAttendanceModule::handle(const QJsonObject &request) {
 		const QString username = request.value("doctor_username").toString(request.value("username").toString());
 		int limit = request.value("limit").toInt(100);
 		if (username.isEmpty()) { resp["message"] = "doctor_username required"; return resp; }
-		DBManager db(DatabaseConfig::getDatabasePath());
-		QJsonArray arr; bool ok = db.getAttendanceByDoctor(username, arr, limit);
+		DBLease db;
+		QJsonArray arr; bool ok = db->getAttendanceByDoctor(username, arr, limit);
 		resp["success"] = ok; if (ok) { resp["data"] = arr; } else { resp["message"] = QStringLiteral("query failed"); }
 		return resp;
 	}
@@ -33,15 +34,23 @@ QJsonObject DoctorAttendanceModule::handleCheckin(const QJsonObject &request) {
 	if (date.isEmpty()) date = QDate::currentDate().toString("yyyy-MM-dd");
 	if (time.isEmpty()) time = QTime::currentTime().toString("HH:mm:ss");
 	if (username.isEmpty()) { resp["message"] = "doctor_username required"; return resp; }
-	DBManager db(DatabaseConfig::getDatabasePath());
 	QJsonObject data {{"doctor_username", username}, {"checkin_date", date}, {"checkin_time", time}};
-	bool ok = db.createAttendanceRecord(data);
+	// 早高峰集中打卡：经组提交写队列与其他写入合并为一个事务，本工作线程等待所在批次提交
+	QJsonObject written;
+	bool ok = DBWriteQueue::instance().execute([data](DBManager &writer, QJsonObject &result) {
+		int id = 0;
+		if (!writer.createAttendanceRecord(data, &id)) return false;
+		result["id"] = id;
+		return true;
+	}, written);
 	resp["success"] = ok;
 	if (ok) {
+		DBLease db;
 		// 返回最新一条打卡记录（包含 created_at 等）
-		QJsonArray arr; if (db.getAttendanceByDoctor(username, arr, 1) && !arr.isEmpty()) {
+		QJsonArray arr; if (db->getAttendanceByDoctor(username, arr, 1) && !arr.isEmpty()) {
 			resp["data"] = arr.first().toObject();
 		} else {
+			data["id"] = written.value("id");
 			resp["data"] = data;
 		}
 	}
@@ -55,9 +64,8 @@ QJsonObject DoctorAttendanceModule::handleLeave(const QJsonObject &request) {
 	const QString reason = request.value("reason").toString();
 	if (leaveDate.isEmpty()) leaveDate = QDate::currentDate().toString("yyyy-MM-dd");
 	if (username.isEmpty()) { resp["message"] = "doctor_username required"; return resp; }
-	DBManager db(DatabaseConfig::getDatabasePath());
 	QJsonObject data {{"doctor_username", username}, {"leave_date", leaveDate}, {"reason", reason}};
-	bool ok = db.createLeaveRequest(data);
+	bool ok = DBWriteQueue::instance().write([&data](DBManager &db) { return db.createLeaveRequest(data); });
 	resp["success"] = ok; if (ok) { resp["data"] = data; }
 	return resp;
 }
@@ -66,20 +74,21 @@ QJsonObject DoctorAttendanceModule::handleGetActiveLeaves(const QJsonObject &req
 	QJsonObject resp; resp["type"] = "active_leaves_response"; resp["success"] = false;
 	const QString username = request.value("doctor_username").toString(request.value("username").toString());
 	if (username.isEmpty()) { resp["message"] = "doctor_username required"; return resp; }
-	DBManager db(DatabaseConfig::getDatabasePath());
-	QJsonArray arr; bool ok = db.getActiveLeavesByDoctor(username, arr);
+	DBLease db;
+	QJsonArray arr; bool ok = db->getActiveLeavesByDoctor(username, arr);
 	resp["success"] = ok; if (ok) resp["data"] = arr; return resp;
 }
 
 QJsonObject DoctorAttendanceModule::handleCancelLeave(const QJsonObject &request) {
 	QJsonObject resp; resp["type"] = "cancel_leave_response"; resp["success"] = false;
-	DBManager db(DatabaseConfig::getDatabasePath());
+	DBWriteQueue& writer = DBWriteQueue::instance();
 	if (request.contains("leave_id")) {
-		bool ok = db.cancelLeaveById(request.value("leave_id").toInt());
+		const int leaveId = request.value("leave_id").toInt();
+		bool ok = writer.write([leaveId](DBManager &db) { return db.cancelLeaveById(leaveId); });
 		resp["success"] = ok; return resp;
 	}
 	const QString username = request.value("doctor_username").toString(request.value("username").toString());
 	if (username.isEmpty()) { resp["message"] = "doctor_username or leave_id required"; return resp; }
-	bool ok = db.cancelActiveLeaveForDoctor(username);
+	bool ok = writer.write([&username](DBManager &db) { return db.cancelActiveLeaveForDoctor(username); });
 	resp["success"] = ok; return resp;
 }
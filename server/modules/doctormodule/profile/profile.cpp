@@ -1,6 +1,7 @@
 #include "profile.h"
 #include "core/database/database.h"
-#include "core/database/database_config.h"
+#include "core/database/dbpool.h"
+#include "core/database/writequeue.h"
 
 QJsonObject DoctorProfileModule::handle(const QJsonObject& request) {
     const QString action = request.value("action").toString();
@@ -17,9 +18,9 @@ QJsonObject DoctorProfileModule::handleGet(const QJsonObject& request) {
     QJsonObject resp; resp["type"] = "doctor_info_response"; resp["success"] = false;
     const QString username = request.value("username").toString();
     if (username.isEmpty()) { resp["message"] = "username required"; return resp; }
-    DBManager db(DatabaseConfig::getDatabasePath());
+    DBLease db;
     QJsonObject data;
-    if (db.getDoctorInfo(username, data)) {
+    if (db->getDoctorInfo(username, data)) {
         resp["success"] = true; resp["data"] = data;
     } else {
         // 未找到医生信息时，返回成功并给出可编辑的默认结构，便于前端填充后提交
@@ -44,7 +45,6 @@ QJsonObject DoctorProfileModule::handleUpdate(const QJsonObject& request) {
     const QString username = request.value("username").toString();
     const QJsonObject data = request.value("data").toObject();
     if (username.isEmpty()) { resp["message"] = "username required"; return resp; }
-    DBManager db(DatabaseConfig::getDatabasePath());
     // 可选：最小化兜底，保证缺失键有默认值，避免绑定异常
     QJsonObject patched = data;
     if (!patched.contains("name")) patched["name"] = username;
@@ -57,7 +57,7 @@ QJsonObject DoctorProfileModule::handleUpdate(const QJsonObject& request) {
     if (!patched.contains("consultation_fee")) patched["consultation_fee"] = 0.0;
     if (!patched.contains("max_patients_per_day")) patched["max_patients_per_day"] = 0;
 
-    if (db.updateDoctorInfo(username, patched)) {
+    if (DBWriteQueue::instance().write([&](DBManager &db) { return db.updateDoctorInfo(username, patched); })) {
         resp["success"] = true;
     } else {
         resp["message"] = QStringLiteral("update failed");
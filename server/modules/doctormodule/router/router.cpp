@@ -6,9 +6,12 @@
 #include "core/logging/logging.h"
 
 DoctorRouterModule::DoctorRouterModule(QObject *parent):QObject(parent) {
-    if (!connect(&MessageRouter::instance(), &MessageRouter::requestReceived,
-            this, &DoctorRouterModule::onRequest)) {
-        Log::error("DoctorRouterModule", "Failed to connect MessageRouter::requestReceived to DoctorRouterModule::onRequest");
+    if (!MessageRouter::instance().registerActions(this, {
+            "get_doctor_info", "update_doctor_info", "get_doctor_assignment",
+            "update_doctor_assignment", "doctor_checkin", "doctor_leave", "get_active_leaves",
+            "cancel_leave", "get_attendance_history"},
+            &DoctorRouterModule::onRequest)) {
+        Log::error("DoctorRouterModule", "Failed to register DoctorRouterModule actions with MessageRouter");
     }
     if (!connect(this, &DoctorRouterModule::businessResponse,
             &MessageRouter::instance(), &MessageRouter::onBusinessResponse)) {
@@ -26,15 +29,13 @@ void DoctorRouterModule::onRequest(const QJsonObject &payload) {
         DoctorAssignmentModule m; resp = m.handle(payload);
     } else if (a == "doctor_checkin" || a == "doctor_leave" || a == "get_active_leaves" || a == "cancel_leave" || a == "get_attendance_history") {
         DoctorAttendanceModule m; resp = m.handle(payload);
-    } else {
-        return; // 非本模块处理
     }
     // 统一在 reply 时打印 response
     reply(resp, payload);
 }
 
 void DoctorRouterModule::reply(QJsonObject resp, const QJsonObject &orig) {
-    if (orig.contains("uuid")) resp["request_uuid"] = orig.value("uuid").toString();
+    MessageRouter::stampReply(resp, orig);
     Log::response("DoctorRouter", resp);
     emit businessResponse(resp);
 }
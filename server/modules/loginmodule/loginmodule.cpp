@@ -3,11 +3,13 @@
 #include <QCoreApplication>
 #include <QDir>
 #include "core/database/database.h"
-#include "core/database/database_config.h"
+#include "core/database/dbpool.h"
+#include "core/database/writequeue.h"
 
-LoginModule::LoginModule(QObject *parent) : QObject(parent), m_db(new DBManager(DatabaseConfig::getDatabasePath())) {}
+// 连接由 DBConnectionPool 按线程复用，LoginModule 本身不再持有连接
+LoginModule::LoginModule(QObject *parent) : QObject(parent) {}
 
-LoginModule::~LoginModule() { delete m_db; }
+LoginModule::~LoginModule() = default;
 
 QJsonObject LoginModule::handleLogin(const QJsonObject &request)
 {
@@ -16,11 +18,12 @@ QJsonObject LoginModule::handleLogin(const QJsonObject &request)
 
     QJsonObject response;
     response["type"] = "login_response";
-    bool ok = m_db->authenticateUser(username, password);
+    DBLease db;
+    bool ok = db->authenticateUser(username, password);
     response["success"] = ok;
     if (ok) {
         QString role;
-        if (m_db->getUserRole(username, role)) {
+        if (db->getUserRole(username, role)) {
             response["role"] = role;
         }
     }
@@ -39,6 +42,8 @@ QJsonObject LoginModule::handleRegister(const QJsonObject &request)
     response["type"] = "register_response";
     bool ok = false;
     QString errorMessage = "";
+    // 注册是写操作：交给写线程执行（当前为路由器工作线程，可同步等待）
+    DBWriteQueue& writer = DBWriteQueue::instance();
     
     if (role == "doctor") {
         QString department = request.value("department").toString();
@@ -48,7 +53,7 @@ QJsonObject LoginModule::handleRegister(const QJsonObject &request)
         if (username.isEmpty() || password.isEmpty() || department.isEmpty() || phone.isEmpty()) {
             errorMessage = "医生注册失败，所有字段都必须填写。";
         } else {
-            ok = m_db->registerDoctor(username, password, department, phone);
+            ok = writer.write([&](DBManager &db) { return db.registerDoctor(username, password, department, phone); });
             if (!ok) {
                 errorMessage = "医生注册失败，用户名可能已存在或数据库错误。";
             }
@@ -62,7 +67,7 @@ QJsonObject LoginModule::handleRegister(const QJsonObject &request)
         if (username.isEmpty() || password.isEmpty() || age <= 0 || phone.isEmpty() || address.isEmpty()) {
             errorMessage = "病人注册失败，所有字段都必须正确填写（年龄必须大于0）。";
         } else {
-            ok = m_db->registerPatient(username, password, age, phone, address);
+            ok = writer.write([&](DBManager &db) { return db.registerPatient(username, password, age, phone, address); });
             if (!ok) {
                 errorMessage = "病人注册失败，用户名可能已存在或数据库错误。";
             }
@@ -3,7 +3,6 @@
 
 #include <QObject>
 #include <QJsonObject>
-class DBManager; // forward declaration
 
 class LoginModule : public QObject {
     Q_OBJECT
@@ -14,9 +13,6 @@ public:
 public slots:
     QJsonObject handleLogin(const QJsonObject &request);
     QJsonObject handleRegister(const QJsonObject &request);
-
-private:
-    DBManager *m_db;
 };
 
 #endif // LOGINMODULE_H
@@ -5,9 +5,9 @@
 #include <QDebug>
 
 LoginRouter::LoginRouter(QObject *parent):QObject(parent) {
-    if (!connect(&MessageRouter::instance(), &MessageRouter::requestReceived,
-        this, &LoginRouter::onRequest)) {
-        Log::error("LoginRouter", "Failed to connect MessageRouter::requestReceived to LoginRouter::onRequest");
+    if (!MessageRouter::instance().registerActions(this, {"login", "register"},
+            &LoginRouter::onRequest)) {
+        Log::error("LoginRouter", "Failed to register LoginRouter actions with MessageRouter");
     }
     // 将业务模块的响应信号连到路由器
     if (!connect(this, &LoginRouter::businessResponse,
@@ -18,7 +18,6 @@ LoginRouter::LoginRouter(QObject *parent):QObject(parent) {
 
 void LoginRouter::onRequest(const QJsonObject &payload) {
     const QString action = payload.value("action").toString();
-    if (action != "login" && action != "register") return;
     const QString uuid = payload.value("uuid").toString();
     const QString username = payload.value("username").toString();
     Log::request("LoginRouter", payload, "user", username);
@@ -31,7 +30,7 @@ void LoginRouter::onRequest(const QJsonObject &payload) {
 }
 
 void LoginRouter::reply(QJsonObject resp, const QJsonObject &orig) {
-    if (orig.contains("uuid")) resp["request_uuid"] = orig.value("uuid").toString();
+    MessageRouter::stampReply(resp, orig);
     Log::response("LoginRouter", resp);
     emit businessResponse(resp);
 }
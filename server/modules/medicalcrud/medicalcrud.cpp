@@ -1,16 +1,19 @@
 #include "medicalcrud.h"
 #include "core/network/messagerouter.h"
 #include "core/database/database.h"
-#include "core/database/database_config.h"
+#include "core/database/dbpool.h"
+#include "core/database/writequeue.h"
 #include "core/logging/logging.h"
 #include <QSqlQuery>
 #include <QJsonArray>
 #include <QDebug>
 
 MedicalCrudModule::MedicalCrudModule(QObject *parent):QObject(parent) {
-    if (!connect(&MessageRouter::instance(), &MessageRouter::requestReceived,
-            this, &MedicalCrudModule::onRequest)) {
-        Log::error("MedicalCrudModule", "Failed to connect MessageRouter::requestReceived to MedicalCrudModule::onRequest");
+    if (!MessageRouter::instance().registerActions(this, {
+            "create_medical_record", "update_medical_record", "get_medical_advices_by_record",
+            "create_medical_advice", "create_prescription", "get_prescriptions_by_patient"},
+            &MedicalCrudModule::onRequest)) {
+        Log::error("MedicalCrudModule", "Failed to register MedicalCrudModule actions with MessageRouter");
     }
     if (!connect(this, &MedicalCrudModule::businessResponse,
             &MessageRouter::instance(), &MessageRouter::onBusinessResponse)) {
@@ -31,40 +34,45 @@ void MedicalCrudModule::onRequest(const QJsonObject &payload) {
 }
 
 void MedicalCrudModule::handleCreateRecord(const QJsonObject &payload) {
-    DBManager db(DatabaseConfig::getDatabasePath());
-    bool ok = db.createMedicalRecord(payload.value("data").toObject());
+    // 写入交给写线程；自增 ID 须在同一连接上紧随插入读取
+    const QJsonObject data = payload.value("data").toObject();
+    int id = 0;
+    bool ok = DBWriteQueue::instance().write([&](DBManager &db) {
+        if (!db.createMedicalRecord(data)) return false;
+        id = db.getLastInsertId();
+        return true;
+    });
     QJsonObject out; out["type"] = "create_medical_record_response"; out["success"] = ok;
-    if (ok) { QSqlQuery q; q.exec("SELECT last_insert_rowid() AS id"); if (q.next()) out["record_id"] = q.value("id").toInt(); }
+    if (ok && id > 0) out["record_id"] = id;
     Log::result("MedicalCrud", ok, "create_medical_record");
     reply(out, payload);
 }
 
 void MedicalCrudModule::handleUpdateRecord(const QJsonObject &payload) {
-    DBManager db(DatabaseConfig::getDatabasePath());
-    bool ok = db.updateMedicalRecord(payload.value("record_id").toInt(), payload.value("data").toObject());
+    const int recordId = payload.value("record_id").toInt();
+    const QJsonObject data = payload.value("data").toObject();
+    bool ok = DBWriteQueue::instance().write([&](DBManager &db) { return db.updateMedicalRecord(recordId, data); });
     QJsonObject out; out["type"] = "update_medical_record_response"; out["success"] = ok;
     Log::result("MedicalCrud", ok, "update_medical_record");
     reply(out, payload);
 }
 
 void MedicalCrudModule::handleGetAdvicesByRecord(const QJsonObject &payload) {
-    DBManager db(DatabaseConfig::getDatabasePath()); QJsonArray arr; bool ok = db.getMedicalAdviceByRecord(payload.value("record_id").toInt(), arr);
+    DBLease db; QJsonArray arr; bool ok = db->getMedicalAdviceByRecord(payload.value("record_id").toInt(), arr);
     QJsonObject out; out["type"] = "medical_advices_response"; out["success"] = ok; if (ok) out["data"] = arr;
     Log::resultCount("MedicalCrud", ok, arr.size(), "advices_by_record");
     reply(out, payload);
 }
 
 void MedicalCrudModule::handleCreateAdvice(const QJsonObject &payload) {
-    DBManager db(DatabaseConfig::getDatabasePath());
-    bool ok = db.createMedicalAdvice(payload.value("data").toObject());
+    const QJsonObject data = payload.value("data").toObject();
+    bool ok = DBWriteQueue::instance().write([&](DBManager &db) { return db.createMedicalAdvice(data); });
     QJsonObject out; out["type"] = "create_medical_advice_response"; out["success"] = ok; if (!ok) out["message"] = "Failed to create medical advice";
     Log::result("MedicalCrud", ok, "create_medical_advice");
     reply(out, payload);
 }
 
 void MedicalCrudModule::handleCreatePrescription(const QJsonObject &payload) {
-    DBManager db(DatabaseConfig::getDatabasePath());
-    
     QJsonObject prescriptionData = payload.value("data").toObject();
     QJsonArray items = prescriptionData.value("items").toArray();
     
@@ -84,24 +92,19 @@ void MedicalCrudModule::handleCreatePrescription(const QJsonObject &payload) {
         return;
     }
     
-    // 直接创建处方并获取ID
-    int prescriptionId = db.createPrescriptionAndGetId(prescriptionData);
-    bool ok = (prescriptionId > 0);
-    qDebug() << "创建处方记录结果:" << ok << "处方ID:" << prescriptionId;
-    
-    QJsonObject out; 
-    out["type"] = "create_prescription_response"; 
-    out["success"] = ok;
-    
-    if (ok) {
-        qDebug() << "新处方ID:" << prescriptionId;
-        out["prescription_id"] = prescriptionId;
-        
+    // 处方、处方项与状态更新作为一次写操作交给写线程
+    int prescriptionId = 0;
+    bool itemsOk = true;
+    double totalAmount = 0.0;
+    QString errorMsg;
+    bool statusUpdated = false;
+    // 任一处方项失败则整单作废：返回 false 让写线程回滚该操作的保存点；批次提交失败同样视为失败
+    bool ok = DBWriteQueue::instance().write([&](DBManager &db) {
+        // 直接创建处方并获取ID
+        prescriptionId = db.createPrescriptionAndGetId(prescriptionData);
+        if (prescriptionId <= 0) return false;
+
         // 添加处方项
-        bool itemsOk = true;
-        double totalAmount = 0.0;
-        QString errorMsg;
-        
         for (int i = 0; i < items.size(); ++i) {
             QJsonObject itemData = items[i].toObject();
             itemData["prescription_id"] = prescriptionId;
@@ -126,21 +129,30 @@ void MedicalCrudModule::handleCreatePrescription(const QJsonObject &payload) {
                 qDebug() << "成功添加处方项:" << itemData.value("medication_name").toString();
             }
         }
-        
-        qDebug() << "所有处方项添加结果:" << itemsOk << "总金额:" << totalAmount;
-        
-        if (!itemsOk) {
-            out["success"] = false;
-            out["message"] = errorMsg;
-        } else {
-            // 成功添加所有处方项，将状态更新为"已配药"
-            bool statusUpdated = db.updatePrescriptionStatus(prescriptionId, "dispensed");
-            qDebug() << "成功添加所有处方项，总金额:" << totalAmount << "状态更新结果:" << statusUpdated;
-            out["message"] = "处方创建成功";
-        }
-        
-        out["items_added"] = itemsOk;
+
+        if (!itemsOk) return false;
+
+        // 成功添加所有处方项，将状态更新为"已配药"
+        statusUpdated = db.updatePrescriptionStatus(prescriptionId, "dispensed");
+        return true;
+    });
+    qDebug() << "创建处方记录结果:" << ok << "处方ID:" << prescriptionId;
+    
+    QJsonObject out; 
+    out["type"] = "create_prescription_response"; 
+    out["success"] = ok;
+    
+    if (ok) {
+        qDebug() << "新处方ID:" << prescriptionId;
+        out["prescription_id"] = prescriptionId;
+        qDebug() << "成功添加所有处方项，总金额:" << totalAmount << "状态更新结果:" << statusUpdated;
+        out["message"] = "处方创建成功";
+        out["items_added"] = true;
         out["total_amount"] = totalAmount;
+    } else if (!itemsOk) {
+        // 整张处方已回滚，不返回处方ID
+        out["message"] = errorMsg;
+        out["items_added"] = false;
     } else {
         qDebug() << "创建处方记录失败";
         out["message"] = "创建处方记录失败";
@@ -152,15 +164,15 @@ void MedicalCrudModule::handleCreatePrescription(const QJsonObject &payload) {
 }
 
 void MedicalCrudModule::handleGetPrescriptionsByPatient(const QJsonObject &payload) {
-    DBManager db(DatabaseConfig::getDatabasePath());
-    QJsonArray arr; bool ok = db.getPrescriptionsByPatient(payload.value("patient_username").toString(), arr);
+    DBLease db;
+    QJsonArray arr; bool ok = db->getPrescriptionsByPatient(payload.value("patient_username").toString(), arr);
     QJsonObject out; out["type"] = "prescriptions_response"; out["success"] = ok; if (ok) out["data"] = arr;
     Log::resultCount("MedicalCrud", ok, arr.size(), "prescriptions_by_patient");
     reply(out, payload);
 }
 
 void MedicalCrudModule::reply(QJsonObject resp, const QJsonObject &orig) {
-    if (orig.contains("uuid")) resp["request_uuid"] = orig.value("uuid").toString();
+    MessageRouter::stampReply(resp, orig);
     Log::response("MedicalCrud", resp);
     emit businessResponse(resp);
 }
@@ -1,6 +1,6 @@
 #include "advice.h"
 #include "core/database/database.h"
-#include "core/database/database_config.h"
+#include "core/database/dbpool.h"
 #include "core/network/messagerouter.h"
 #include "core/logging/logging.h"
 #include <QJsonArray>
@@ -9,9 +9,9 @@
 
 AdviceModule::AdviceModule(QObject* parent) : QObject(parent) {
     // 连接消息路由器
-    if (!connect(&MessageRouter::instance(), &MessageRouter::requestReceived,
-            this, &AdviceModule::onRequestReceived)) {
-        Log::error("AdviceModule", "Failed to connect MessageRouter::requestReceived to AdviceModule::onRequestReceived");
+    if (!MessageRouter::instance().registerActions(this, {"advice_get_list", "advice_get_details"},
+            &AdviceModule::onRequestReceived)) {
+        Log::error("AdviceModule", "Failed to register AdviceModule actions with MessageRouter");
     }
     if (!connect(this, &AdviceModule::businessResponse,
             &MessageRouter::instance(), &MessageRouter::onBusinessResponse)) {
@@ -44,11 +44,11 @@ QJsonObject AdviceModule::getAdvicesByPatient(const QString& patientUsername) {
     response["type"] = "advice_list_response";
     
     try {
-        DBManager db(DatabaseConfig::getDatabasePath());
+        DBLease db;
         
         // 先获取患者的医疗记录
         QJsonArray medicalRecords;
-        if (!db.getMedicalRecordsByPatient(patientUsername, medicalRecords)) {
+        if (!db->getMedicalRecordsByPatient(patientUsername, medicalRecords)) {
             response["success"] = false;
             response["error"] = "获取医疗记录失败";
             return response;
@@ -63,7 +63,7 @@ QJsonObject AdviceModule::getAdvicesByPatient(const QString& patientUsername) {
             int recordId = record.value("id").toInt();
             
             QJsonArray recordAdvices;
-            if (db.getMedicalAdviceByRecord(recordId, recordAdvices)) {
+            if (db->getMedicalAdviceByRecord(recordId, recordAdvices)) {
                 // 为每个医嘱添加医疗记录信息
                 for (const QJsonValue& adviceValue : recordAdvices) {
                     QJsonObject advice = adviceValue.toObject();
@@ -76,7 +76,7 @@ QJsonObject AdviceModule::getAdvicesByPatient(const QString& patientUsername) {
                     
                     // 检查是否有关联的处方
                     QJsonArray prescriptions;
-                    if (db.getPrescriptionsByPatient(patientUsername, prescriptions)) {
+                    if (db->getPrescriptionsByPatient(patientUsername, prescriptions)) {
                         for (const QJsonValue& prescValue : prescriptions) {
                             QJsonObject prescription = prescValue.toObject();
                             if (prescription.value("record_id").toInt() == recordId) {
@@ -161,7 +161,7 @@ QJsonObject AdviceModule::getAdviceDetails(int adviceId) {
     response["type"] = "advice_details_response";
     
     try {
-        DBManager db(DatabaseConfig::getDatabasePath());
+        DBLease db;
         
         // 首先通过adviceId找到对应的医疗记录
         QJsonArray allRecords;
@@ -188,9 +188,7 @@ void AdviceModule::onRequestReceived(const QJsonObject& payload) {
         QJsonObject response = handleAdviceRequest(payload);
         
         // 添加request_uuid字段
-        if (payload.contains("uuid")) {
-            response["request_uuid"] = payload.value("uuid").toString();
-        }
+        MessageRouter::stampReply(response, payload);
     Log::response("Advice", response);
         // 发送响应
     emit businessResponse(response);
@@ -1,7 +1,9 @@
 #include "appointment.h"
 #include "core/network/messagerouter.h"
+#include "core/network/pushhub.h"
 #include "core/database/database.h"
-#include "core/database/database_config.h"
+#include "core/database/dbpool.h"
+#include "core/database/writequeue.h"
 #include "core/logging/logging.h"
 #include <QJsonArray>
 #include <QDate>
@@ -9,9 +11,12 @@
 #include <QSqlQuery>
 
 AppointmentModule::AppointmentModule(QObject *parent):QObject(parent) {
-    if (!connect(&MessageRouter::instance(), &MessageRouter::requestReceived,
-            this, &AppointmentModule::onRequest)) {
-        Log::error("AppointmentModule", "Failed to connect MessageRouter::requestReceived to AppointmentModule::onRequest");
+    if (!MessageRouter::instance().registerActions(this, {
+            "create_appointment", "get_appointments_by_patient", "get_appointments_by_doctor",
+            "get_doctors_schedule_overview", "get_doctor_schedule_with_stats",
+            "update_appointment_status"},
+            &AppointmentModule::onRequest)) {
+        Log::error("AppointmentModule", "Failed to register AppointmentModule actions with MessageRouter");
     }
     if (!connect(this, &AppointmentModule::businessResponse,
             &MessageRouter::instance(), &MessageRouter::onBusinessResponse)) {
@@ -34,23 +39,30 @@ void AppointmentModule::onRequest(const QJsonObject &payload) {
 }
 
 void AppointmentModule::handleCreate(const QJsonObject &payload) {
-    DBManager db(DatabaseConfig::getDatabasePath());
     QJsonObject out; out["type"] = "create_appointment_response";
     QJsonObject data = payload.value("data").toObject();
-    bool ok = db.createAppointment(data);
+    // 名额检查与插入在写线程上原子完成，新预约 id 随结果一并返回
+    QJsonObject result;
+    bool ok = DBWriteQueue::instance().execute([data](DBManager &db, QJsonObject &res) {
+        int appointmentId = 0; QString error;
+        if (!db.bookAppointment(data, appointmentId, error)) { res["error"] = error; return false; }
+        res["appointment_id"] = appointmentId;
+        return true;
+    }, result);
     out["success"] = ok;
-    if (!ok) {
+    if (ok) {
+        out["appointment_id"] = result.value("appointment_id");
+    } else if (!result.value("error").toString().isEmpty()) {
+        out["error"] = result.value("error").toString();
+    } else {
+        DBLease db;
         // 详细诊断提示
         QString diag; QJsonObject tmp;
-        if (!db.getDoctorInfo(data.value("doctor_username").toString(), tmp)) {
+        if (!db->getDoctorInfo(data.value("doctor_username").toString(), tmp)) {
             diag += QStringLiteral("医生不存在; ");
-        } else {
-            // 检查预约是否已满 - 使用数据库管理器的内部机制
-            // 由于createAppointment已经做了验证，这里主要提供用户友好的错误信息
-            diag = QStringLiteral("当前医生预约数量已达上限，请等待或选择其他医生挂号");
         }
-        if (!db.getPatientInfo(data.value("patient_username").toString(), tmp)) {
-            if (diag.isEmpty()) diag += QStringLiteral("患者不存在; ");
+        if (!db->getPatientInfo(data.value("patient_username").toString(), tmp)) {
+            diag += QStringLiteral("患者不存在; ");
         }
         if (diag.isEmpty()) diag = QStringLiteral("数据库插入失败");
         out["error"] = diag;
@@ -60,16 +72,16 @@ void AppointmentModule::handleCreate(const QJsonObject &payload) {
 }
 
 void AppointmentModule::handleListByPatient(const QJsonObject &payload) {
-    DBManager db(DatabaseConfig::getDatabasePath());
-    QJsonArray arr; bool ok = db.getAppointmentsByPatient(payload.value("username").toString(), arr);
+    DBLease db;
+    QJsonArray arr; bool ok = db->getAppointmentsByPatient(payload.value("username").toString(), arr);
     QJsonObject out; out["type"] = "appointments_response"; out["success"] = ok; if (ok) out["data"] = arr; else out["error"] = QStringLiteral("查询失败");
     Log::resultCount("Appointment", ok, arr.size(), "appointments_by_patient");
     reply(out, payload);
 }
 
 void AppointmentModule::handleListByDoctor(const QJsonObject &payload) {
-    DBManager db(DatabaseConfig::getDatabasePath());
-    QJsonArray arr; bool ok = db.getAppointmentsByDoctor(payload.value("username").toString(), arr);
+    DBLease db;
+    QJsonArray arr; bool ok = db->getAppointmentsByDoctor(payload.value("username").toString(), arr);
     QJsonObject out; out["type"] = "appointments_response"; out["success"] = ok; if (ok) out["data"] = arr; else out["error"] = QStringLiteral("查询失败");
     Log::resultCount("Appointment", ok, arr.size(), "appointments_by_doctor");
     reply(out, payload);
@@ -77,61 +89,56 @@ void AppointmentModule::handleListByDoctor(const QJsonObject &payload) {
 
 void AppointmentModule::handleOverview(const QJsonObject &payload) {
     Q_UNUSED(payload)
-    DBManager db(DatabaseConfig::getDatabasePath());
-    QJsonArray arr; bool ok = db.getAllDoctorsScheduleOverview(arr);
+    DBLease db;
+    QJsonArray arr; bool ok = db->getAllDoctorsScheduleOverview(arr);
     QJsonObject out; out["type"] = "doctors_schedule_overview_response"; out["success"] = ok; if (ok) out["data"] = arr; else out["error"] = QStringLiteral("获取失败");
     Log::resultCount("Appointment", ok, arr.size(), "doctors_schedule_overview");
     reply(out, payload);
 }
 
 void AppointmentModule::handleStats(const QJsonObject &payload) {
-    DBManager db(DatabaseConfig::getDatabasePath());
-    QJsonArray arr; bool ok = db.getDoctorScheduleWithAppointmentStats(payload.value("doctor_username").toString(), arr);
+    DBLease db;
+    QJsonArray arr; bool ok = db->getDoctorScheduleWithAppointmentStats(payload.value("doctor_username").toString(), arr);
     QJsonObject out; out["type"] = "doctor_schedule_stats_response"; out["success"] = ok; if (ok) out["data"] = arr; else out["error"] = QStringLiteral("获取失败");
     Log::resultCount("Appointment", ok, arr.size(), "doctor_schedule_stats");
     reply(out, payload);
 }
 
 void AppointmentModule::handleUpdateStatus(const QJsonObject &payload) {
-    DBManager db(DatabaseConfig::getDatabasePath());
     const QJsonObject data = payload.value("data").toObject();
     int apptId = data.value("appointment_id").toInt();
     QString status = data.value("status").toString();
-    bool ok = apptId > 0 && !status.isEmpty() && db.updateAppointmentStatus(apptId, status);
+    bool ok = apptId > 0 && !status.isEmpty()
+              && DBWriteQueue::instance().write([&](DBManager &db) { return db.updateAppointmentStatus(apptId, status); });
     QJsonObject out; out["type"] = "update_appointment_status_response"; out["success"] = ok; if (!ok) out["error"] = QStringLiteral("更新失败");
     QJsonObject ret; ret["appointment_id"] = apptId; ret["status"] = status; out["data"] = ret;
     Log::result("Appointment", ok, "update_appointment_status");
     reply(out, payload);
     
-    // 如果状态更新为completed，广播一个预约完成通知
-    if (ok && status == "completed") {
-        // 广播预约完成通知，让其他客户端知道预约数量发生变化
-        QJsonObject notification;
-        notification["type"] = "appointment_completed_notification";
-        notification["appointment_id"] = apptId;
-        notification["timestamp"] = QDateTime::currentMSecsSinceEpoch();
-        
-        // 通过查询获取医生用户名和预约日期
-        QJsonArray patientAppointments;
-        QString allDoctors = ""; // 空字符串表示获取所有医生
-        if (db.getAppointmentsByDoctor(allDoctors, patientAppointments)) {
-            for (const auto& apptData : patientAppointments) {
-                QJsonObject appt = apptData.toObject();
-                if (appt.value("id").toInt() == apptId) {
-                    notification["doctor_username"] = appt.value("doctor_username").toString();
-                    notification["appointment_date"] = appt.value("appointment_date").toString();
-                    break;
-                }
-            }
-        }
-        
-        // 发送给消息路由器进行广播
-        emit businessResponse(notification);
+    if (!ok) return;
+    // 状态变化推送给预约双方的在线设备
+    QJsonObject appt;
+    if (!DBLease()->getAppointmentById(apptId, appt)) return;
+    const QJsonObject change{{"appointment_id", apptId},
+                             {"status", status},
+                             {"doctor_username", appt.value("doctor_username")},
+                             {"patient_username", appt.value("patient_username")},
+                             {"appointment_date", appt.value("appointment_date")},
+                             {"timestamp", QDateTime::currentMSecsSinceEpoch()}};
+    PushHub::instance().publish(appt.value("patient_username").toString(), "appointment.status", change);
+    PushHub::instance().publish(appt.value("doctor_username").toString(), "appointment.status", change);
+    // 预约完成意味着该医生当日号源变化，通知所有在线客户端刷新（原 appointment_completed_notification）
+    if (status == "completed") {
+        PushHub::instance().broadcast("appointment.completed",
+                                      QJsonObject{{"appointment_id", apptId},
+                                                  {"doctor_username", appt.value("doctor_username")},
+                                                  {"appointment_date", appt.value("appointment_date")},
+                                                  {"timestamp", change.value("timestamp")}});
     }
 }
 
 void AppointmentModule::reply(QJsonObject resp, const QJsonObject &orig) {
-    if (orig.contains("uuid")) resp["request_uuid"] = orig.value("uuid").toString();
+    MessageRouter::stampReply(resp, orig);
     Log::response("Appointment", resp);
     emit businessResponse(resp);
 }
@@ -1,6 +1,6 @@
 #include "doctorinfo.h"
 #include "core/database/database.h"
-#include "core/database/database_config.h"
+#include "core/database/dbpool.h"
 #include "core/network/messagerouter.h"
 #include "core/logging/logging.h"
 #include <QJsonArray>
@@ -10,16 +10,17 @@
 
 #include "doctorinfo.h"
 #include "core/database/database.h"
-#include "core/database/database_config.h"
+#include "core/database/dbpool.h"
 #include "core/network/messagerouter.h"
 #include <QJsonArray>
 #include <QDebug>
 
 DoctorInfoModule::DoctorInfoModule(QObject* parent) : QObject(parent) {
     // 连接消息路由器
-    if (!connect(&MessageRouter::instance(), &MessageRouter::requestReceived,
-            this, &DoctorInfoModule::onRequestReceived)) {
-        Log::error("DoctorInfoModule", "Failed to connect MessageRouter::requestReceived to DoctorInfoModule::onRequestReceived");
+    if (!MessageRouter::instance().registerActions(this, {
+            "doctorinfo_get_details", "doctorinfo_get_schedule"},
+            &DoctorInfoModule::onRequestReceived)) {
+        Log::error("DoctorInfoModule", "Failed to register DoctorInfoModule actions with MessageRouter");
     }
     if (!connect(this, &DoctorInfoModule::businessResponse,
             &MessageRouter::instance(), &MessageRouter::onBusinessResponse)) {
@@ -52,11 +53,11 @@ QJsonObject DoctorInfoModule::getDoctorDetails(const QString& doctorUsername) {
     response["type"] = "doctorinfo_details_response";
     
     try {
-        DBManager db(DatabaseConfig::getDatabasePath());
+        DBLease db;
         
         // 获取医生基本信息
         QJsonObject doctorInfo;
-        if (!db.getDoctorInfo(doctorUsername, doctorInfo)) {
+        if (!db->getDoctorInfo(doctorUsername, doctorInfo)) {
             response["success"] = false;
             response["error"] = "获取医生信息失败";
             return response;
@@ -64,13 +65,13 @@ QJsonObject DoctorInfoModule::getDoctorDetails(const QString& doctorUsername) {
         
         // 获取医生统计信息
         QJsonObject statistics;
-        if (db.getDoctorStatistics(doctorUsername, statistics)) {
+        if (db->getDoctorStatistics(doctorUsername, statistics)) {
             doctorInfo["statistics"] = statistics;
         }
         
         // 获取医生排班信息
         QJsonArray schedules;
-        if (db.getDoctorSchedules(doctorUsername, schedules)) {
+        if (db->getDoctorSchedules(doctorUsername, schedules)) {
             doctorInfo["schedules"] = schedules;
         }
         
@@ -91,10 +92,10 @@ QJsonObject DoctorInfoModule::getDoctorSchedule(const QString& doctorUsername) {
     response["type"] = "doctorinfo_schedule_response";
     
     try {
-        DBManager db(DatabaseConfig::getDatabasePath());
+        DBLease db;
         
         QJsonArray schedules;
-        if (!db.getDoctorSchedules(doctorUsername, schedules)) {
+        if (!db->getDoctorSchedules(doctorUsername, schedules)) {
             response["success"] = false;
             response["error"] = "获取医生排班信息失败";
             return response;
@@ -123,9 +124,7 @@ void DoctorInfoModule::onRequestReceived(const QJsonObject& payload) {
     QJsonObject response = handleDoctorInfoRequest(payload);
     
     // 添加 request_uuid 用于回复路由
-    if (payload.contains("uuid")) {
-        response["request_uuid"] = payload.value("uuid").toString();
-    }
+    MessageRouter::stampReply(response, payload);
     Log::response("DoctorInfo", response);
     // 通过发射信号回复
     emit businessResponse(response);
@@ -1,13 +1,13 @@
 #include "doctorlist.h"
 #include "core/network/messagerouter.h"
 #include "core/database/database.h"
-#include "core/database/database_config.h"
+#include "core/database/dbpool.h"
 #include "core/logging/logging.h"
 #include <QJsonArray>
 
 DoctorListModule::DoctorListModule(QObject *parent):QObject(parent) {
-    connect(&MessageRouter::instance(), &MessageRouter::requestReceived,
-            this, &DoctorListModule::onRequest);
+    MessageRouter::instance().registerActions(this, {"get_all_doctors", "get_doctors_by_department"},
+            &DoctorListModule::onRequest);
     connect(this, &DoctorListModule::businessResponse,
             &MessageRouter::instance(), &MessageRouter::onBusinessResponse);
 }
@@ -21,23 +21,23 @@ void DoctorListModule::onRequest(const QJsonObject &payload) {
 }
 
 void DoctorListModule::handleGetAll(const QJsonObject &payload) {
-    DBManager db(DatabaseConfig::getDatabasePath());
-    QJsonArray list; bool ok = db.getAllDoctorsScheduleOverview(list);
+    DBLease db;
+    QJsonArray list; bool ok = db->getAllDoctorsScheduleOverview(list);
     QJsonObject out; out["type"] = "doctors_response"; out["success"] = ok; if (ok) out["data"] = list; else out["error"] = QStringLiteral("获取医生列表失败");
     Log::resultCount("DoctorList", ok, list.size(), "all");
     reply(out, payload);
 }
 
 void DoctorListModule::handleByDepartment(const QJsonObject &payload) {
-    DBManager db(DatabaseConfig::getDatabasePath());
-    QJsonArray list; bool ok = db.getDoctorsByDepartment(payload.value("department").toString(), list);
+    DBLease db;
+    QJsonArray list; bool ok = db->getDoctorsByDepartment(payload.value("department").toString(), list);
     QJsonObject out; out["type"] = "doctors_response"; out["success"] = ok; if (ok) out["data"] = list; else out["error"] = QStringLiteral("获取医生列表失败");
     Log::resultCount("DoctorList", ok, list.size(), "by_dept");
     reply(out, payload);
 }
 
 void DoctorListModule::reply(QJsonObject resp, const QJsonObject &orig) {
-    if (orig.contains("uuid")) resp["request_uuid"] = orig.value("uuid").toString();
+    MessageRouter::stampReply(resp, orig);
     Log::response("DoctorList", resp);
     emit businessResponse(resp);
 }
@@ -1,22 +1,15 @@
 #include "evaluate.h"
 #include "core/network/messagerouter.h"
-#include "core/database/database_config.h"
+#include "core/database/database.h"
+#include "core/database/dbpool.h"
+#include "core/database/writequeue.h"
 #include "core/logging/logging.h"
-#include <QSqlQuery>
-#include <QSqlError>
 #include <QJsonDocument>
 #include <QDebug>
-#include <QRandomGenerator>
-
-static const char* WALLET_TABLE_SQL = "CREATE TABLE IF NOT EXISTS patient_wallets (\n"
-                                      " patient_username TEXT PRIMARY KEY,\n"
-                                      " balance REAL DEFAULT 0,\n"
-                                      " updated_at DATETIME DEFAULT CURRENT_TIMESTAMP\n"
-                                      ")";
 
 EvaluateModule::EvaluateModule(QObject *parent):QObject(parent) {
-    connect(&MessageRouter::instance(), &MessageRouter::requestReceived,
-            this, &EvaluateModule::onRequest);
+    MessageRouter::instance().registerActions(this, {"evaluate_get_config", "evaluate_recharge"},
+            &EvaluateModule::onRequest);
     connect(this, &EvaluateModule::businessResponse,
             &MessageRouter::instance(), &MessageRouter::onBusinessResponse);
 }
@@ -29,7 +22,7 @@ void EvaluateModule::onRequest(const QJsonObject &payload) {
 
 void EvaluateModule::handleGetConfig(const QJsonObject &payload) {
     const QString patient = payload.value("patient_username").toString();
-    double balance = ensureAndFetchBalance(patient);
+    double balance = fetchBalance(patient);
     QJsonObject resp; resp["type"] = "evaluate_config_response"; resp["success"] = true;
     // 提供多份常用临床评估量表。若外网不可访问，前端仍可显示基本说明链接（本地 html 占位）。
     QJsonArray forms;
@@ -65,68 +58,30 @@ void EvaluateModule::handleRecharge(const QJsonObject &payload) {
     sendResponse(resp, payload);
 }
 
-double EvaluateModule::ensureAndFetchBalance(const QString &patientUsername) {
-    QSqlDatabase tempDb = QSqlDatabase::addDatabase(
-        "QSQLITE",
-        QString("evaluate_conn_%1").arg(reinterpret_cast<quintptr>(this))
-            + QString::number(QRandomGenerator::global()->generate())
-    );
-    tempDb.setDatabaseName(DatabaseConfig::getDatabasePath());
-    if(!tempDb.open()) { qWarning() << "[ EvaluateModule ] 打开数据库失败:" << tempDb.lastError().text(); return 0.0; }
-    {
-        QSqlQuery create(tempDb);
-        if(!create.exec(WALLET_TABLE_SQL)) {
-            qWarning() << "[ EvaluateModule ] 创建钱包表失败:" << create.lastError().text();
-        }
-    }
+double EvaluateModule::fetchBalance(const QString &patientUsername) {
+    // 钱包表在启动时创建；无记录视为余额 0，读取不再建户
     double balance = 0.0;
-    {
-        QSqlQuery sel(tempDb);
-        sel.prepare("SELECT balance FROM patient_wallets WHERE patient_username=:p");
-        sel.bindValue(":p", patientUsername);
-        if(sel.exec() && sel.next()) {
-            balance = sel.value(0).toDouble();
-        } else {
-            QSqlQuery ins(tempDb);
-            ins.prepare("INSERT INTO patient_wallets (patient_username, balance) VALUES (:p, 0)");
-            ins.bindValue(":p", patientUsername);
-            if(!ins.exec()) qWarning() << "[ EvaluateModule ] 插入初始钱包失败:" << ins.lastError().text();
-        }
+    if (!DBLease()->getWalletBalance(patientUsername, balance)) {
+        qWarning() << "[ EvaluateModule ] 查询余额失败:" << patientUsername;
     }
-    tempDb.close();
-    QSqlDatabase::removeDatabase(tempDb.connectionName());
     return balance;
 }
 
 bool EvaluateModule::updateBalance(const QString &patientUsername, double delta, double &newBalance, QString &err) {
-    QSqlDatabase tempDb = QSqlDatabase::addDatabase(
-        "QSQLITE",
-        QString("evaluate_conn_upd_%1").arg(reinterpret_cast<quintptr>(this))
-            + QString::number(QRandomGenerator::global()->generate())
-    );
-    tempDb.setDatabaseName(DatabaseConfig::getDatabasePath());
-    if(!tempDb.open()) { err = QStringLiteral("数据库打开失败"); return false; }
-    {
-        QSqlQuery create(tempDb); create.exec(WALLET_TABLE_SQL); // ignore error here
-    }
-    tempDb.transaction();
-    QSqlQuery sel(tempDb); sel.prepare("SELECT balance FROM patient_wallets WHERE patient_username=:p"); sel.bindValue(":p", patientUsername);
-    if(!sel.exec()) { err = sel.lastError().text(); tempDb.rollback(); tempDb.close(); QSqlDatabase::removeDatabase(tempDb.connectionName()); return false; }
-    double current = 0.0; bool exists=false; if(sel.next()){ current = sel.value(0).toDouble(); exists=true; }
-    if(!exists) {
-        QSqlQuery ins(tempDb); ins.prepare("INSERT INTO patient_wallets (patient_username, balance) VALUES (:p, 0)"); ins.bindValue(":p", patientUsername);
-        if(!ins.exec()) { err = ins.lastError().text(); tempDb.rollback(); tempDb.close(); QSqlDatabase::removeDatabase(tempDb.connectionName()); return false; }
-    }
-    newBalance = current + delta;
-    QSqlQuery upd(tempDb); upd.prepare("UPDATE patient_wallets SET balance=:b, updated_at=CURRENT_TIMESTAMP WHERE patient_username=:p"); upd.bindValue(":b", newBalance); upd.bindValue(":p", patientUsername);
-    if(!upd.exec()) { err = upd.lastError().text(); tempDb.rollback(); tempDb.close(); QSqlDatabase::removeDatabase(tempDb.connectionName()); return false; }
-    tempDb.commit();
-    tempDb.close(); QSqlDatabase::removeDatabase(tempDb.connectionName());
+    QJsonObject result;
+    bool ok = DBWriteQueue::instance().execute([patientUsername, delta](DBManager &db, QJsonObject &result) {
+        double balance = 0.0; QString error;
+        if (!db.adjustWalletBalance(patientUsername, delta, balance, error)) { result["error"] = error; return false; }
+        result["balance"] = balance;
+        return true;
+    }, result);
+    if (!ok) { err = result.value("error").toString(); return false; }
+    newBalance = result.value("balance").toDouble();
     return true;
 }
 
 void EvaluateModule::sendResponse(QJsonObject resp, const QJsonObject &orig) {
-    if(orig.contains("uuid")) resp["request_uuid"] = orig.value("uuid").toString();
+    MessageRouter::stampReply(resp, orig);
     Log::response("Evaluate", resp);
     emit businessResponse(resp);
 }
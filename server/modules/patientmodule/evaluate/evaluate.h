@@ -17,6 +17,6 @@ private:
     void handleGetConfig(const QJsonObject &payload);
     void handleRecharge(const QJsonObject &payload);
     void sendResponse(QJsonObject resp, const QJsonObject &orig);
-    double ensureAndFetchBalance(const QString &patientUsername);
+    double fetchBalance(const QString &patientUsername);
     bool updateBalance(const QString &patientUsername, double delta, double &newBalance, QString &err);
 };
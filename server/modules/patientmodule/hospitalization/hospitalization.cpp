@@ -1,15 +1,18 @@
 #include "hospitalization.h"
 #include "core/network/messagerouter.h"
 #include "core/database/database.h"
-#include "core/database/database_config.h"
+#include "core/database/dbpool.h"
+#include "core/database/writequeue.h"
 #include "core/logging/logging.h"
 #include <QJsonArray>
 #include <algorithm>
 
 HospitalizationModule::HospitalizationModule(QObject *parent):QObject(parent) {
-    if (!connect(&MessageRouter::instance(), &MessageRouter::requestReceived,
-            this, &HospitalizationModule::onRequest)) {
-        Log::error("HospitalizationModule", "Failed to connect MessageRouter::requestReceived to HospitalizationModule::onRequest");
+    if (!MessageRouter::instance().registerActions(this, {
+            "create_hospitalization", "get_hospitalizations_by_patient",
+            "get_hospitalizations_by_doctor", "get_all_hospitalizations"},
+            &HospitalizationModule::onRequest)) {
+        Log::error("HospitalizationModule", "Failed to register HospitalizationModule actions with MessageRouter");
     }
     if (!connect(this, &HospitalizationModule::businessResponse,
             &MessageRouter::instance(), &MessageRouter::onBusinessResponse)) {
@@ -30,17 +33,17 @@ void HospitalizationModule::onRequest(const QJsonObject &payload) {
 }
 
 void HospitalizationModule::handleCreate(const QJsonObject &payload) {
-    DBManager db(DatabaseConfig::getDatabasePath());
-    bool ok = db.createHospitalization(payload.value("data").toObject());
+    const QJsonObject data = payload.value("data").toObject();
+    bool ok = DBWriteQueue::instance().write([&data](DBManager &db) { return db.createHospitalization(data); });
     QJsonObject out; out["type"] = "create_hospitalization_response"; out["success"] = ok; if (!ok) out["error"] = QStringLiteral("创建失败");
     Log::result("Hospitalization", ok, "create_hospitalization");
     reply(out, payload);
 }
 
 void HospitalizationModule::handleByPatient(const QJsonObject &payload) {
-    DBManager db(DatabaseConfig::getDatabasePath());
+    DBLease db;
     QJsonArray list; 
-    bool ok = db.getHospitalizationsByPatient(payload.value("patient_username").toString(), list);
+    bool ok = db->getHospitalizationsByPatient(payload.value("patient_username").toString(), list);
     
     if (ok) {
         // 转换为Vector进行排序
@@ -81,23 +84,23 @@ void HospitalizationModule::handleByPatient(const QJsonObject &payload) {
 }
 
 void HospitalizationModule::handleByDoctor(const QJsonObject &payload) {
-    DBManager db(DatabaseConfig::getDatabasePath());
-    QJsonArray list; bool ok = db.getHospitalizationsByDoctor(payload.value("doctor_username").toString(), list);
+    DBLease db;
+    QJsonArray list; bool ok = db->getHospitalizationsByDoctor(payload.value("doctor_username").toString(), list);
     QJsonObject out; out["type"] = "hospitalizations_response"; out["success"] = ok; if (ok) out["data"] = list; else out["error"] = QStringLiteral("查询失败");
     Log::resultCount("Hospitalization", ok, list.size(), "by_doctor");
     reply(out, payload);
 }
 
 void HospitalizationModule::handleAll(const QJsonObject &payload) {
-    DBManager db(DatabaseConfig::getDatabasePath());
-    QJsonArray list; bool ok = db.getAllHospitalizations(list);
+    DBLease db;
+    QJsonArray list; bool ok = db->getAllHospitalizations(list);
     QJsonObject out; out["type"] = "hospitalizations_response"; out["success"] = ok; if (ok) out["data"] = list; else out["error"] = QStringLiteral("查询失败");
     Log::resultCount("Hospitalization", ok, list.size(), "all");
     reply(out, payload);
 }
 
 void HospitalizationModule::reply(QJsonObject resp, const QJsonObject &orig) {
-    if (orig.contains("uuid")) resp["request_uuid"] = orig.value("uuid").toString();
+    MessageRouter::stampReply(resp, orig);
     Log::response("Hospitalization", resp);
     emit businessResponse(resp);
 }
@@ -1,7 +1,7 @@
 #include "medicalrecord.h"
 #include "core/network/messagerouter.h"
 #include "core/database/database.h"
-#include "core/database/database_config.h"
+#include "core/database/dbpool.h"
 #include "core/logging/logging.h"
 #include <QJsonArray>
 #include <QDebug>
@@ -9,9 +9,11 @@
 
 MedicalRecordModule::MedicalRecordModule(QObject *parent) : QObject(parent)
 {
-    if (!connect(&MessageRouter::instance(), &MessageRouter::requestReceived,
-            this, &MedicalRecordModule::onRequest)) {
-        Log::error("MedicalRecordModule", "Failed to connect MessageRouter::requestReceived to MedicalRecordModule::onRequest");
+    if (!MessageRouter::instance().registerActions(this, {
+            "get_medical_records", "get_medical_records_by_patient", "get_medical_record_details",
+            "get_medical_records_by_doctor"},
+            &MedicalRecordModule::onRequest)) {
+        Log::error("MedicalRecordModule", "Failed to register MedicalRecordModule actions with MessageRouter");
     }
     if (!connect(this, &MedicalRecordModule::businessResponse,
             &MessageRouter::instance(), &MessageRouter::onBusinessResponse)) {
@@ -33,8 +35,8 @@ void MedicalRecordModule::onRequest(const QJsonObject &payload)
     if (action == "get_medical_records_by_doctor") {
         // 兼容旧接口名称，直接透传到 DBManager 的医生查询
         QJsonObject resp; resp["type"] = "medical_records_response";
-        DBManager db(DatabaseConfig::getDatabasePath());
-        QJsonArray records; bool ok = db.getMedicalRecordsByDoctor(payload.value("doctor_username").toString(), records);
+        DBLease db;
+        QJsonArray records; bool ok = db->getMedicalRecordsByDoctor(payload.value("doctor_username").toString(), records);
         resp["success"] = ok; if (ok) resp["data"] = records; else resp["error"] = "获取医生病例记录失败";
         return sendResponse(resp, payload);
     }
@@ -47,9 +49,9 @@ void MedicalRecordModule::handleGetMedicalRecords(const QJsonObject &payload)
     QJsonObject resp;
     resp["type"] = "medical_records_response";
     
-    DBManager db(DatabaseConfig::getDatabasePath());
+    DBLease db;
     QJsonArray records;
-    bool ok = db.getMedicalRecordsByPatient(patientUsername, records);
+    bool ok = db->getMedicalRecordsByPatient(patientUsername, records);
     
     if (ok) {
         // 转换为Vector进行排序
@@ -107,12 +109,12 @@ void MedicalRecordModule::handleGetMedicalRecordDetails(const QJsonObject &paylo
     QJsonObject resp;
     resp["type"] = "medical_record_details_response";
     
-    DBManager db(DatabaseConfig::getDatabasePath());
+    DBLease db;
     QJsonArray records;
     
     // 通过患者用户名获取所有记录，然后筛选指定的记录
     QString patientUsername = payload.value("patient_username").toString();
-    bool ok = db.getMedicalRecordsByPatient(patientUsername, records);
+    bool ok = db->getMedicalRecordsByPatient(patientUsername, records);
     
     if (ok) {
         for (int i = 0; i < records.size(); ++i) {
@@ -136,9 +138,7 @@ void MedicalRecordModule::handleGetMedicalRecordDetails(const QJsonObject &paylo
 
 void MedicalRecordModule::sendResponse(QJsonObject resp, const QJsonObject &orig)
 {
-    if (orig.contains("uuid")) {
-        resp["request_uuid"] = orig.value("uuid").toString();
-    }
+    MessageRouter::stampReply(resp, orig);
     Log::response("MedicalRecord", resp);
     emit businessResponse(resp);
 }
@@ -1,17 +1,14 @@
 #include "medicine.h"
-#include "core/database/database.h"
-#include "core/database/database_config.h"
+#include "core/database/medicationcatalog.h"
 #include "core/network/messagerouter.h"
 #include "core/logging/logging.h"
+#include "core/storage/blobstore.h"
 #include <QDateTime>
 #include <QDir>
 #include <QFile>
 #include <QJsonArray>
 #include <QJsonDocument>
-#include <QSet>
-#include <QSqlError>
 #include <QUrlQuery>
-#include <algorithm>
 
 static QString localMedicationsJsonPath()
 {
@@ -34,22 +31,15 @@ static QString moduleImageDir()
 MedicineModule::MedicineModule(QObject* parent)
     : QObject(parent)
 {
-    connect(&MessageRouter::instance(), &MessageRouter::requestReceived,
-        this, &MedicineModule::onRequest);
+    MessageRouter::instance().registerActions(this, {"get_medications", "search_medications"},
+            &MedicineModule::onRequest);
+    // 远程检索使用 m_nam（线程亲和），需在本模块所在线程执行
+    MessageRouter::instance().registerActions(this, {"search_medications_remote"},
+            &MedicineModule::onRequest, MessageRouter::DispatchPolicy::Affine);
     connect(this, &MedicineModule::businessResponse,
             &MessageRouter::instance(), &MessageRouter::onBusinessResponse);
     loadLocalMeta();
-    
-    // 测试图片目录
-    QString imgDir = moduleImageDir();
-    if (!imgDir.isEmpty()) {
-        qInfo() << "[ MedicineModule ] 图片目录可用:" << imgDir;
-        QDir dir(imgDir);
-        QStringList imageFiles = dir.entryList(QStringList() << "*.png" << "*.jpg" << "*.jpeg", QDir::Files);
-        qInfo() << "[ MedicineModule ] 找到" << imageFiles.size() << "个图片文件:" << imageFiles;
-    } else {
-        qWarning() << "[ MedicineModule ] 图片目录不可用";
-    }
+    buildImageIndex();
 }
 
 void MedicineModule::onRequest(const QJsonObject& payload)
@@ -66,151 +56,25 @@ void MedicineModule::onRequest(const QJsonObject& payload)
 
 void MedicineModule::handleGetMedications(const QJsonObject& payload)
 {
-    DBManager db(DatabaseConfig::getDatabasePath());
+    // MedicationCatalog 已排除医疗器械并按 id 升序排好
     QJsonArray list;
-    bool ok = db.getMedications(list);
+    bool ok = MedicationCatalog::instance().all(list);
     
-    // 过滤掉医疗器械类药品
-    if (ok) {
-        QStringList medicalDevices = {"血糖试纸", "电子体温计", "一次性医用口罩"};
-        QJsonArray filtered;
-        for (const auto& item : list) {
-            QJsonObject o = item.toObject();
-            QString name = o.value("name").toString();
-            if (!medicalDevices.contains(name)) {
-                filtered.append(item);
-            }
-        }
-        list = filtered;
-    }
-    
-    // 合并本地图片与描述补全
+    // 合并本地描述补全与图片哈希
     if (ok) {
+        const bool inlineImages = payload.value("inline_images").toBool();
         for (int i = 0; i < list.size(); ++i) {
             QJsonObject o = list[i].toObject();
-            auto name = o.value("name").toString();
-            for (const auto& lmv : m_localMeta) {
-                QJsonObject lo = lmv.toObject();
-                if (lo.value("name").toString() == name) {
-                    if (o.value("description").toString().isEmpty())
-                        o["description"] = lo.value("description");
-                    if (o.value("precautions").toString().isEmpty())
-                        o["precautions"] = lo.value("precautions");
-                    QString img = lo.value("image").toString();
-                    if (!img.isEmpty()) {
-                        QString resPath = QStringLiteral("resources/medications/images/%1").arg(img);
-                        QString modDir = moduleImageDir();
-                        QString modPath = modDir.isEmpty() ? QString() : (modDir + "/" + img);
-                        if (QFile::exists(resPath)) {
-                            o["image_path"] = resPath;
-                        } else if (!modPath.isEmpty() && QFile::exists(modPath)) {
-                            QFile f(modPath);
-                            if (f.open(QIODevice::ReadOnly)) {
-                                QByteArray b64 = f.readAll().toBase64();
-                                o["image_base64"] = QString::fromLatin1(b64);
-                            }
-                        }
-                    }
-                    // 若仍无图片，尝试按药品名称匹配模块 img 下同名文件（任意扩展）
-                    if (!o.contains("image_path") && !o.contains("image_base64")) {
-                        QString modDir = moduleImageDir();
-                        if (!modDir.isEmpty()) {
-                            QString base = o.value("name").toString();
-                            QStringList exts = { ".png", ".jpg", ".jpeg" };
-                            for (const QString& ext : exts) {
-                                QString candidate = modDir + "/" + base + ext;
-                                if (QFile::exists(candidate)) {
-                                    QFile f(candidate);
-                                    if (f.open(QIODevice::ReadOnly))
-                                        o["image_base64"] = QString::fromLatin1(f.readAll().toBase64());
-                                    break;
-                                }
-                            }
-                        }
-                    }
-                    break;
-                }
-            }
-            // 对于所有药品，都尝试按药品名称匹配图片文件（如果还没有base64数据的话）
-            if (!o.contains("image_base64")) {
-                QString modDir = moduleImageDir();
-                if (!modDir.isEmpty()) {
-                    QString base = o.value("name").toString();
-                    QStringList exts = { ".png", ".jpg", ".jpeg", ".webp" };
-                    qInfo() << "[ MedicineModule ] 尝试为药品" << base << "查找图片，目录:" << modDir;
-                    for (const QString& ext : exts) {
-                        QString candidate = modDir + "/" + base + ext;
-                        qInfo() << "[ MedicineModule ] 检查图片文件:" << candidate;
-                        if (QFile::exists(candidate)) {
-                            QFile f(candidate);
-                            if (f.open(QIODevice::ReadOnly)) {
-                                QByteArray imageData = f.readAll();
-                                o["image_base64"] = QString::fromLatin1(imageData.toBase64());
-                                // 清除不正确的image_path
-                                if (o.contains("image_path")) {
-                                    o.remove("image_path");
-                                }
-                                qInfo() << "[ MedicineModule ] 为药品" << base << "加载图片成功:" << candidate << "大小:" << imageData.size() << "字节";
-                            } else {
-                                qWarning() << "[ MedicineModule ] 无法打开图片文件:" << candidate;
-                            }
-                            break;
-                        }
-                    }
-                    if (!o.contains("image_base64")) {
-                        qWarning() << "[ MedicineModule ] 未找到药品" << base << "的图片文件";
-                    }
-                }
+            auto lo = m_localMetaByName.constFind(o.value("name").toString());
+            if (lo != m_localMetaByName.constEnd()) {
+                if (o.value("description").toString().isEmpty())
+                    o["description"] = lo->value("description");
+                if (o.value("precautions").toString().isEmpty())
+                    o["precautions"] = lo->value("precautions");
             }
+            attachImage(o, inlineImages);
             list[i] = o;
         }
-        
-        // 添加调试信息：检查每个药品的图片数据
-        qInfo() << "[ MedicineModule ] 药品图片加载统计:";
-        for (int i = 0; i < list.size(); ++i) {
-            QJsonObject o = list[i].toObject();
-            QString medName = o.value("name").toString();
-            bool hasImagePath = o.contains("image_path");
-            bool hasImageBase64 = o.contains("image_base64");
-            qInfo() << "[ MedicineModule ] 药品:" << medName 
-                    << "hasImagePath:" << hasImagePath 
-                    << "hasImageBase64:" << hasImageBase64;
-            
-            if (hasImageBase64) {
-                QString base64 = o.value("image_base64").toString();
-                qInfo() << "[ MedicineModule ] 药品" << medName << "base64数据长度:" << base64.length();
-            }
-        }
-        
-        // 按ID从小到大排序
-        if (ok) {
-            qInfo() << "[ MedicineModule ] 排序前药品数量:" << list.size();
-            if (!list.isEmpty()) {
-                qInfo() << "[ MedicineModule ] 排序前第一个药品ID:" << list.first().toObject().value("id").toInt();
-                qInfo() << "[ MedicineModule ] 排序前最后一个药品ID:" << list.last().toObject().value("id").toInt();
-            }
-            
-            // 转换为std::vector进行排序
-            std::vector<QJsonValue> sortedList;
-            for (const auto& item : list) {
-                sortedList.push_back(item);
-            }
-            
-            std::sort(sortedList.begin(), sortedList.end(), [](const QJsonValue& a, const QJsonValue& b) {
-                return a.toObject().value("id").toInt() < b.toObject().value("id").toInt();
-            });
-            
-            // 转回QJsonArray
-            list = QJsonArray();
-            for (const auto& item : sortedList) {
-                list.append(item);
-            }
-            
-            if (!list.isEmpty()) {
-                qInfo() << "[ MedicineModule ] 排序后第一个药品ID:" << list.first().toObject().value("id").toInt();
-                qInfo() << "[ MedicineModule ] 排序后最后一个药品ID:" << list.last().toObject().value("id").toInt();
-            }
-        }
     }
     QJsonObject resp;
     resp["type"] = "medications_response";
@@ -224,114 +88,22 @@ void MedicineModule::handleGetMedications(const QJsonObject& payload)
 
 void MedicineModule::handleSearchMedications(const QJsonObject& payload)
 {
-    DBManager db(DatabaseConfig::getDatabasePath());
     const QString keyword = payload.value("keyword").toString();
     qInfo() << "[ MedicineModule ] 本地/DB 搜索关键字=" << keyword;
+    // 仅匹配 name 或 generic_name（不区分大小写），结果按 id 升序
     QJsonArray list;
-    bool ok = db.searchMedications(keyword, list);
+    bool ok = MedicationCatalog::instance().search(keyword, list);
     
-    // 过滤掉医疗器械类药品
-    if (ok) {
-        QStringList medicalDevices = {"血糖试纸", "电子体温计", "一次性医用口罩"};
-        QJsonArray filtered;
-        for (const auto& item : list) {
-            QJsonObject o = item.toObject();
-            QString name = o.value("name").toString();
-            if (!medicalDevices.contains(name)) {
-                filtered.append(item);
-            }
-        }
-        list = filtered;
-    }
-    
-    // 为数据库返回的每个药品添加图片
+    // 为命中的药品附加图片哈希
     if (ok) {
+        const bool inlineImages = payload.value("inline_images").toBool();
         for (int i = 0; i < list.size(); ++i) {
             QJsonObject o = list[i].toObject();
-            
-            // 强制为所有搜索结果加载图片（无论是否已有image_path）
-            if (!o.contains("image_base64")) {
-                QString modDir = moduleImageDir();
-                if (!modDir.isEmpty()) {
-                    QString base = o.value("name").toString();
-                    QStringList exts = { ".png", ".jpg", ".jpeg", ".webp" };
-                    qInfo() << "[ MedicineModule ] 搜索结果尝试为药品" << base << "查找图片，目录:" << modDir;
-                    for (const QString& ext : exts) {
-                        QString candidate = modDir + "/" + base + ext;
-                        qInfo() << "[ MedicineModule ] 搜索时检查图片文件:" << candidate;
-                        if (QFile::exists(candidate)) {
-                            QFile f(candidate);
-                            if (f.open(QIODevice::ReadOnly)) {
-                                QByteArray imageData = f.readAll();
-                                o["image_base64"] = QString::fromLatin1(imageData.toBase64());
-                                // 清除错误的image_path
-                                if (o.contains("image_path")) {
-                                    o.remove("image_path");
-                                }
-                                qInfo() << "[ MedicineModule ] 为搜索结果药品" << base << "加载图片成功:" << candidate << "大小:" << imageData.size() << "字节";
-                            } else {
-                                qWarning() << "[ MedicineModule ] 无法打开搜索结果图片文件:" << candidate;
-                            }
-                            break;
-                        }
-                    }
-                    if (!o.contains("image_base64")) {
-                        qWarning() << "[ MedicineModule ] 搜索时未找到药品" << base << "的图片文件";
-                    }
-                }
-            }
+            attachImage(o, inlineImages);
             list[i] = o;
         }
     }
     
-    // 注释掉本地 meta 补充逻辑，只返回数据库中的药品
-    // if (ok && !keyword.isEmpty()) {
-    //     // 将本地 meta 中名称或通用名或分类包含关键字的条目（若数据库未返回）补充
-    //     ...本地补充逻辑已移除...
-    // }
-    // 严格再次过滤：仅保留 name 或 generic_name 包含关键字的项
-    if (ok && !keyword.isEmpty()) {
-        QJsonArray filtered;
-        for (const auto& v : list) {
-            QJsonObject o = v.toObject();
-            QString name = o.value("name").toString();
-            QString gen = o.value("generic_name").toString();
-            if (name.contains(keyword, Qt::CaseInsensitive) || gen.contains(keyword, Qt::CaseInsensitive))
-                filtered.append(o);
-        }
-        list = filtered;
-    }
-    
-        // 按ID从小到大排序
-        if (ok) {
-            qInfo() << "[ MedicineModule ] 排序前药品数量:" << list.size();
-            if (!list.isEmpty()) {
-                qInfo() << "[ MedicineModule ] 排序前第一个药品ID:" << list.first().toObject().value("id").toInt();
-                qInfo() << "[ MedicineModule ] 排序前最后一个药品ID:" << list.last().toObject().value("id").toInt();
-            }
-            
-            // 转换为std::vector进行排序
-            std::vector<QJsonValue> sortedList;
-            for (const auto& item : list) {
-                sortedList.push_back(item);
-            }
-            
-            std::sort(sortedList.begin(), sortedList.end(), [](const QJsonValue& a, const QJsonValue& b) {
-                return a.toObject().value("id").toInt() < b.toObject().value("id").toInt();
-            });
-            
-            // 转回QJsonArray
-            list = QJsonArray();
-            for (const auto& item : sortedList) {
-                list.append(item);
-            }
-            
-            if (!list.isEmpty()) {
-                qInfo() << "[ MedicineModule ] 排序后第一个药品ID:" << list.first().toObject().value("id").toInt();
-                qInfo() << "[ MedicineModule ] 排序后最后一个药品ID:" << list.last().toObject().value("id").toInt();
-            }
-        }
-    
     QJsonObject resp;
     resp["type"] = "medications_response";
     resp["success"] = ok;
@@ -411,6 +183,10 @@ void MedicineModule::loadLocalMeta()
         QJsonDocument doc = QJsonDocument::fromJson(f.readAll());
         if (doc.isArray()) {
             m_localMeta = doc.array();
+            for (const auto& v : m_localMeta) {
+                const QJsonObject lo = v.toObject();
+                m_localMetaByName.insert(lo.value("name").toString(), lo);
+            }
             qInfo() << "[ MedicineModule ] 载入本地元数据条目数=" << m_localMeta.size();
         } else
             qWarning() << "[ MedicineModule ] 元数据格式非数组";
@@ -419,10 +195,70 @@ void MedicineModule::loadLocalMeta()
     }
 }
 
+void MedicineModule::buildImageIndex()
+{
+    // 图片只在启动时读取一次并放入 BlobStore，响应中仅携带哈希，客户端按哈希单独拉取
+    const QString modDir = moduleImageDir();
+    const QDir dir(modDir);
+    if (!modDir.isEmpty()) {
+        // 同名多扩展时按此优先级取第一个
+        const QStringList exts = { "png", "jpg", "jpeg", "webp" };
+        const QFileInfoList files = dir.entryInfoList(QStringList() << "*.png" << "*.jpg" << "*.jpeg" << "*.webp", QDir::Files);
+        for (const QString& ext : exts) {
+            for (const QFileInfo& fi : files) {
+                if (fi.suffix().compare(ext, Qt::CaseInsensitive) != 0 || m_imageIndex.contains(fi.completeBaseName()))
+                    continue;
+                const QString hash = BlobStore::instance().putFile(fi.absoluteFilePath());
+                if (!hash.isEmpty())
+                    m_imageIndex.insert(fi.completeBaseName(), hash);
+            }
+        }
+    } else {
+        qWarning() << "[ MedicineModule ] 图片目录不可用";
+    }
+    // 本地元数据中显式指定的图片文件（药品名与文件名不一致时）
+    for (const auto& lmv : m_localMeta) {
+        const QJsonObject lo = lmv.toObject();
+        const QString name = lo.value("name").toString();
+        const QString img = lo.value("image").toString();
+        if (name.isEmpty() || img.isEmpty() || m_imageIndex.contains(name))
+            continue;
+        QStringList candidates { QStringLiteral("resources/medications/images/%1").arg(img) };
+        if (!modDir.isEmpty())
+            candidates << dir.filePath(img);
+        for (const QString& path : candidates) {
+            if (!QFile::exists(path))
+                continue;
+            const QString hash = BlobStore::instance().putFile(path);
+            if (!hash.isEmpty()) {
+                m_imageIndex.insert(name, hash);
+                break;
+            }
+        }
+    }
+    qInfo() << "[ MedicineModule ] 图片索引建立完成: 药品数=" << m_imageIndex.size()
+            << ", blob 数=" << BlobStore::instance().count()
+            << ", 总字节=" << BlobStore::instance().totalBytes();
+}
+
+void MedicineModule::attachImage(QJsonObject& o, bool inlineImage) const
+{
+    const QString hash = m_imageIndex.value(o.value("name").toString());
+    if (hash.isEmpty())
+        return;
+    o["image_hash"] = hash;
+    o["image_size"] = BlobStore::instance().sizeOf(hash);
+    // 旧客户端可通过 inline_images=true 继续获取内联 base64
+    if (inlineImage) {
+        QByteArray bytes;
+        if (BlobStore::instance().get(hash, bytes))
+            o["image_base64"] = QString::fromLatin1(bytes.toBase64());
+    }
+}
+
 void MedicineModule::sendResponse(QJsonObject resp, const QJsonObject& orig)
 {
-    if (orig.contains("uuid"))
-        resp["request_uuid"] = orig.value("uuid").toString();
+    MessageRouter::stampReply(resp, orig);
     Log::response("Medicine", resp);
     emit businessResponse(resp);
 }
\ No newline at end of file
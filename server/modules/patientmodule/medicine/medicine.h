@@ -4,6 +4,7 @@
  #include <QNetworkAccessManager>
  #include <QNetworkReply>
  #include <QJsonArray>
+ #include <QHash>
   class MedicineModule : public QObject {
 	 Q_OBJECT
  public:
@@ -16,7 +17,12 @@
  private:
 	QNetworkAccessManager m_nam;
 	QJsonArray m_localMeta; // 本地元数据缓存
+	QHash<QString, QJsonObject> m_localMetaByName; // 药品名 -> 本地元数据
+	// 药品名 -> 图片 blob 哈希（构造时建立，之后只读，可被并发处理函数共享）
+	QHash<QString, QString> m_imageIndex;
 	void loadLocalMeta();
+	void buildImageIndex();
+	void attachImage(QJsonObject &o, bool inlineImage) const;
 	 void handleGetMedications(const QJsonObject &payload);
 	 void handleSearchMedications(const QJsonObject &payload);
 	 void handleRemoteSearch(const QJsonObject &payload);
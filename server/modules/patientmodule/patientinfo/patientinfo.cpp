@@ -1,15 +1,16 @@
 #include "patientinfo.h"
 #include "core/network/messagerouter.h"
 #include "core/database/database.h"
-#include "core/database/database_config.h"
+#include "core/database/dbpool.h"
+#include "core/database/writequeue.h"
 #include "core/logging/logging.h"
 #include <QJsonArray>
 #include <QSqlQuery>
 
 PatientInfoModule::PatientInfoModule(QObject *parent):QObject(parent) {
-    if (!connect(&MessageRouter::instance(), &MessageRouter::requestReceived,
-            this, &PatientInfoModule::onRequest)) {
-        Log::error("PatientInfoModule", "Failed to connect MessageRouter::requestReceived to PatientInfoModule::onRequest");
+    if (!MessageRouter::instance().registerActions(this, {"get_patient_info", "update_patient_info"},
+            &PatientInfoModule::onRequest)) {
+        Log::error("PatientInfoModule", "Failed to register PatientInfoModule actions with MessageRouter");
     }
     if (!connect(this, &PatientInfoModule::businessResponse,
             &MessageRouter::instance(), &MessageRouter::onBusinessResponse)) {
@@ -26,25 +27,26 @@ void PatientInfoModule::onRequest(const QJsonObject &payload) {
 }
 
 void PatientInfoModule::handleGet(const QJsonObject &payload) {
-    DBManager db(DatabaseConfig::getDatabasePath());
+    DBLease db;
     QJsonObject out; out["type"] = "patient_info_response";
-    QJsonObject data; bool ok = db.getPatientInfo(payload.value("username").toString(), data);
+    QJsonObject data; bool ok = db->getPatientInfo(payload.value("username").toString(), data);
     out["success"] = ok; if (ok) out["data"] = data; else out["error"] = QStringLiteral("获取患者信息失败");
     Log::result("PatientInfo", ok, "get_patient_info");
     reply(out, payload);
 }
 
 void PatientInfoModule::handleUpdate(const QJsonObject &payload) {
-    DBManager db(DatabaseConfig::getDatabasePath());
     QJsonObject out; out["type"] = "update_patient_info_response";
-    bool ok = db.updatePatientInfo(payload.value("username").toString(), payload.value("data").toObject());
+    const QString username = payload.value("username").toString();
+    const QJsonObject data = payload.value("data").toObject();
+    bool ok = DBWriteQueue::instance().write([&](DBManager &db) { return db.updatePatientInfo(username, data); });
     out["success"] = ok; if (!ok) out["error"] = QStringLiteral("更新失败");
     Log::result("PatientInfo", ok, "update_patient_info");
     reply(out, payload);
 }
 
 void PatientInfoModule::reply(QJsonObject resp, const QJsonObject &orig) {
-    if (orig.contains("uuid")) resp["request_uuid"] = orig.value("uuid").toString();
+    MessageRouter::stampReply(resp, orig);
     Log::response("PatientInfo", resp);
     emit businessResponse(resp);
 }
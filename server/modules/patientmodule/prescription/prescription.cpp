@@ -1,16 +1,17 @@
 #include "prescription.h"
 #include "core/network/messagerouter.h"
 #include "core/database/database.h"
-#include "core/database/database_config.h"
+#include "core/database/dbpool.h"
 #include "core/logging/logging.h"
 #include <QJsonArray>
 #include <QDebug>
 #include <algorithm>
 
 PrescriptionModule::PrescriptionModule(QObject *parent):QObject(parent) {
-    if (!connect(&MessageRouter::instance(), &MessageRouter::requestReceived,
-            this, &PrescriptionModule::onRequest)) {
-        Log::error("PrescriptionModule", "Failed to connect MessageRouter::requestReceived to PrescriptionModule::onRequest");
+    if (!MessageRouter::instance().registerActions(this, {
+            "prescription_get_list", "prescription_get_details"},
+            &PrescriptionModule::onRequest)) {
+        Log::error("PrescriptionModule", "Failed to register PrescriptionModule actions with MessageRouter");
     }
     if (!connect(this, &PrescriptionModule::businessResponse,
             &MessageRouter::instance(), &MessageRouter::onBusinessResponse)) {
@@ -36,9 +37,9 @@ void PrescriptionModule::handleGetList(const QJsonObject &payload) {
         return sendResponse(resp, payload);
     }
     
-    DBManager db(DatabaseConfig::getDatabasePath());
+    DBLease db;
     QJsonArray list;
-    bool ok = db.getPrescriptionsByPatient(patient, list);
+    bool ok = db->getPrescriptionsByPatient(patient, list);
     
     if (ok) {
         // 转换为Vector进行排序
@@ -49,7 +50,7 @@ void PrescriptionModule::handleGetList(const QJsonObject &payload) {
             // 通过doctor_username获取科室信息
             QString doctorUsername = prescription.value("doctor_username").toString();
             QJsonObject doctorInfo;
-            if (db.getDoctorInfo(doctorUsername, doctorInfo)) {
+            if (db->getDoctorInfo(doctorUsername, doctorInfo)) {
                 prescription["department"] = doctorInfo.value("department").toString();
             } else {
                 prescription["department"] = "未知科室";
@@ -110,15 +111,15 @@ void PrescriptionModule::handleGetDetails(const QJsonObject &payload) {
         return sendResponse(resp, payload);
     }
     
-    DBManager db(DatabaseConfig::getDatabasePath());
+    DBLease db;
     QJsonObject details;
-    bool ok = db.getPrescriptionDetails(prescriptionId, details);
+    bool ok = db->getPrescriptionDetails(prescriptionId, details);
     
     if (ok) {
         // 添加科室信息
         QString doctorUsername = details.value("doctor_username").toString();
         QJsonObject doctorInfo;
-        if (db.getDoctorInfo(doctorUsername, doctorInfo)) {
+        if (db->getDoctorInfo(doctorUsername, doctorInfo)) {
             details["department"] = doctorInfo.value("department").toString();
         } else {
             details["department"] = "未知科室";
@@ -145,7 +146,7 @@ void PrescriptionModule::handleGetDetails(const QJsonObject &payload) {
 }
 
 void PrescriptionModule::sendResponse(QJsonObject resp, const QJsonObject &orig) {
-    if (orig.contains("uuid")) resp["request_uuid"] = orig.value("uuid").toString();
+    MessageRouter::stampReply(resp, orig);
     Log::response("Prescription", resp);
     emit businessResponse(resp);
 }
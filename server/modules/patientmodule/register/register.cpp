@@ -3,21 +3,23 @@
 #include <QDateTime>
 #include <QDebug>
 #include "core/database/database.h"
+#include "core/database/dbpool.h"
+#include "core/database/writequeue.h"
+#include "core/database/database_config.h"
 #include "core/network/messagerouter.h"
-#include <QCoreApplication>
-#include <QDir>
 #include <QSqlDatabase>
+#include <QThread>
 #include <QSqlQuery>
 #include <QSqlError>
 
 RegisterManager::RegisterManager(QObject* parent): QObject(parent) {
     qDebug() << "[ RegisterManager ] 构造函数被调用，开始连接信号槽...";
-    connect(&MessageRouter::instance(), &MessageRouter::requestReceived,
-            this, &RegisterManager::onRequest, Qt::DirectConnection);
+    MessageRouter::instance().registerActions(this, {"get_doctor_schedule", "register_doctor"},
+            &RegisterManager::onRequest);
     qDebug() << "[ RegisterManager ] 信号槽连接完成";
+    // 处理函数在工作线程执行，响应需经队列连接回到路由器线程
     connect(this, &RegisterManager::businessResponse,
-            &MessageRouter::instance(), &MessageRouter::onBusinessResponse,
-            Qt::DirectConnection);
+            &MessageRouter::instance(), &MessageRouter::onBusinessResponse);
     qDebug() << "[ RegisterManager ] RegisterManager初始化完成";
 }
 
@@ -26,11 +28,9 @@ QList<DoctorSchedule> RegisterManager::getAllDoctorSchedules() {
     // 适配现有 doctors 表: username, name, department, title, specialization, consultation_fee
     // 数据库并无排班/上限/已预约等字段，这里用占位/默认值，不改动数据库。
     QList<DoctorSchedule> list;
-    QDir dir(QCoreApplication::applicationDirPath());
-    for (int i=0;i<4 && !dir.exists("data");++i) dir.cdUp();
-    DBManager db(dir.filePath("data/user.db"));
+    DBLease db;
     QJsonArray doctors;
-    if (db.getAllDoctors(doctors)) {
+    if (db->getAllDoctors(doctors)) {
         int idx = 1; // 生成临时 doctorId
         for (const auto &v : doctors) {
             QJsonObject o = v.toObject();
@@ -51,10 +51,10 @@ QList<DoctorSchedule> RegisterManager::getAllDoctorSchedules() {
         }
         if (list.isEmpty()) {
             // fallback: 直接扫描 users 表 role=doctor
-            QSqlDatabase conn = QSqlDatabase::addDatabase("QSQLITE", "register_fallback");
-            QDir d(QCoreApplication::applicationDirPath());
-            for (int i=0;i<4 && !d.exists("data");++i) d.cdUp();
-            conn.setDatabaseName(d.filePath("data/user.db"));
+            QSqlDatabase conn = QSqlDatabase::addDatabase("QSQLITE",
+                QString("register_fallback_%1").arg(reinterpret_cast<quintptr>(QThread::currentThread())));
+            conn.setDatabaseName(DBConnectionPool::instance().databasePath());
+            conn.setConnectOptions(DatabaseConfig::getReadOnlyConnectOptions());
             if (conn.open()) {
                 QSqlQuery q(conn);
                 if (q.exec("SELECT username FROM users WHERE role='doctor'")) {
@@ -65,14 +65,16 @@ QList<DoctorSchedule> RegisterManager::getAllDoctorSchedules() {
                 }
             }
             conn.close();
-            QSqlDatabase::removeDatabase("register_fallback");
+            const QString fallbackName = conn.connectionName();
+            conn = QSqlDatabase();
+            QSqlDatabase::removeDatabase(fallbackName);
         }
     }
     return list;
 }
 
 // 挂号逻辑
-bool RegisterManager::registerPatient(int doctorId, const QString& patientName, QString& errorMsg) {
+bool RegisterManager::registerPatient(int doctorId, const QString& patientName, QString& errorMsg, int& appointmentId) {
     // 使用内存中的排班列表（含 fallback），避免 doctors 表为空导致失败
     QList<DoctorSchedule> schedules = getAllDoctorSchedules();
     QString doctorUsername; QString department; double fee = 0.0; QString doctorName;
@@ -88,14 +90,10 @@ bool RegisterManager::registerPatient(int doctorId, const QString& patientName,
     department = ds.department;
     fee = ds.fee;
 
-    QDir dir2(QCoreApplication::applicationDirPath());
-    for (int i=0;i<4 && !dir2.exists("data");++i) dir2.cdUp();
-    DBManager db(dir2.filePath("data/user.db"));
-    
     const QDate today = QDate::currentDate();
     const QTime now = QTime::currentTime();
     
-    // 使用DBManager的createAppointment方法
+    // 由写线程原子预约（名额检查与插入同一条语句），并取回新预约 id
     QJsonObject appt;
     appt["patient_username"] = patientName;
     appt["doctor_username"] = doctorUsername;
@@ -105,8 +103,9 @@ bool RegisterManager::registerPatient(int doctorId, const QString& patientName,
     appt["chief_complaint"] = QString("预约挂号 - %1").arg(doctorName);
     appt["fee"] = fee;
     
-    if (!db.createAppointment(appt)) {
-        errorMsg = QStringLiteral("创建预约失败，请稍后重试");
+    QString bookingError;
+    if (!DBWriteQueue::instance().write([&](DBManager &db) { return db.bookAppointment(appt, appointmentId, bookingError); })) {
+        errorMsg = bookingError.isEmpty() ? QStringLiteral("创建预约失败，请稍后重试") : bookingError;
         return false;
     }
     
@@ -138,25 +137,20 @@ void RegisterManager::onRequest(const QJsonObject& payload) {
              << ", doctorId=" << payload.value("doctorId").toInt()
              << ", patientName=" << payload.value("patientName").toString();
     
-    // 只处理挂号相关的动作
-    if (action != "get_doctor_schedule" && action != "register_doctor") {
-        return; // 不处理非挂号相关的请求
-    }
-    
     qDebug() << "[ RegisterManager ] 处理挂号相关请求:" << payload;
     
     if (action == "get_doctor_schedule") {
         auto list = getAllDoctorSchedules();
         QJsonArray arr; for (auto &ds : list) arr.append(doctorScheduleToJson(ds));
         QJsonObject resp; resp["type"] = "doctor_schedule_response"; resp["success"] = true; resp["data"] = arr;
-    if (payload.contains("uuid")) resp["request_uuid"] = payload.value("uuid").toString();
+    MessageRouter::stampReply(resp, payload);
     qDebug() << "[ RegisterManager ] 回传 doctor_schedule_response request_uuid=" << resp.value("request_uuid").toString();
     emit businessResponse(resp);
     } else if (action == "register_doctor") {
         qDebug() << "[ RegisterManager ] 处理挂号请求...";
         QString patientName = payload.value("patientName").toString();
         qDebug() << "[ RegisterManager ] 患者姓名:" << patientName;
-        QString err; bool ok = false;
+        QString err; bool ok = false; int appointmentId = 0;
         QList<DoctorSchedule> schedules = getAllDoctorSchedules();
         
         auto findByName = [&](const QString& target)->int { 
@@ -192,7 +186,7 @@ void RegisterManager::onRequest(const QJsonObject& payload) {
         
         if (matchId > 0 && matchId <= schedules.size()) {
             qDebug() << "[ RegisterManager ] 找到医生，序号:" << matchId << "开始挂号...";
-            ok = registerPatient(matchId, patientName, err);
+            ok = registerPatient(matchId, patientName, err, appointmentId);
             qDebug() << "[ RegisterManager ] 挂号结果:" << ok << "错误信息:" << err;
         } else {
             err = QStringLiteral("医生不存在或序号无效");
@@ -209,9 +203,10 @@ void RegisterManager::onRequest(const QJsonObject& payload) {
             resp["message"] = QStringLiteral("挂号成功");
             resp["doctor_name"] = payload.value("doctor_name").toString();
             resp["patient_name"] = patientName;
+            resp["appointment_id"] = appointmentId;
         }
         
-    if (payload.contains("uuid")) { resp["request_uuid"] = payload.value("uuid").toString(); }
+    MessageRouter::stampReply(resp, payload);
     qDebug() << "[ RegisterManager ] 回传 register_doctor_response success=" << ok
          << ", request_uuid=" << resp.value("request_uuid").toString();
         
@@ -26,7 +26,8 @@ public:
 
     QList<DoctorSchedule> getAllDoctorSchedules();
 
-    bool registerPatient(int doctorId, const QString& patientName, QString& errorMsg);
+    // 成功时 appointmentId 为新建预约的 id
+    bool registerPatient(int doctorId, const QString& patientName, QString& errorMsg, int& appointmentId);
     static QJsonObject doctorScheduleToJson(const DoctorSchedule& ds);
 public slots:
     void onRequest(const QJsonObject& payload);
@@ -0,0 +1,145 @@
+#include "core/database/database.h"
+#include <QCoreApplication>
+#include <QDate>
+#include <QDebug>
+#include <QJsonObject>
+#include <QSqlDatabase>
+#include <QSqlQuery>
+#include <QTemporaryDir>
+
+// appointment_counters 触发器与 bookAppointment 名额检查：在临时数据库上运行，不改动 data/user.db
+
+static int failures = 0;
+
+#define CHECK(cond) \
+    do { \
+        if (!(cond)) { \
+            qWarning() << "FAILED:" << #cond << "line" << __LINE__; \
+            ++failures; \
+        } \
+    } while (0)
+
+static int counter(QSqlDatabase& db, const QString& doctor, const QString& date, const QString& status) {
+    QSqlQuery q(db);
+    q.prepare("SELECT count FROM appointment_counters WHERE doctor_username = :d AND appointment_date = :date AND status = :s");
+    q.bindValue(":d", doctor);
+    q.bindValue(":date", date);
+    q.bindValue(":s", status);
+    return (q.exec() && q.next()) ? q.value(0).toInt() : 0;
+}
+
+static int appointmentRows(QSqlDatabase& db, const QString& doctor, const QString& date) {
+    QSqlQuery q(db);
+    q.prepare("SELECT COUNT(*) FROM appointments WHERE doctor_username = :d AND appointment_date = :date");
+    q.bindValue(":d", doctor);
+    q.bindValue(":date", date);
+    return (q.exec() && q.next()) ? q.value(0).toInt() : -1;
+}
+
+static QJsonObject request(const QString& patient, const QString& date, const QString& time) {
+    QJsonObject appt;
+    appt["patient_username"] = patient;
+    appt["doctor_username"] = "doc1";
+    appt["appointment_date"] = date;
+    appt["appointment_time"] = time;
+    appt["chief_complaint"] = "头痛";
+    return appt;
+}
+
+int main(int argc, char *argv[]) {
+    QCoreApplication app(argc, argv);
+
+    QTemporaryDir dir;
+    CHECK(dir.isValid());
+    const QString path = dir.filePath("user.db");
+
+    // 一个工作日（按 strftime('%w') 排班）与另一天，用于日期修改
+    const QDate day(2030, 1, 7);
+    const QString date = day.toString("yyyy-MM-dd");
+    const QString otherDate = day.addDays(1).toString("yyyy-MM-dd");
+    const QString full = QStringLiteral("当前医生预约数量已达上限，请等待或选择其他医生挂号");
+    {
+        DBManager db(path); // 引导连接：完成全部迁移
+        CHECK(db.isOpen());
+        CHECK(db.isSchemaReady());
+
+        QSqlDatabase raw = QSqlDatabase::addDatabase("QSQLITE", "counters_test");
+        raw.setDatabaseName(path);
+        CHECK(raw.open());
+        {
+            QSqlQuery q(raw);
+            CHECK(q.exec("INSERT INTO users (username, password, role) VALUES ('doc1', 'x', 'doctor'), "
+                         "('p1', 'x', 'patient'), ('p2', 'x', 'patient'), ('p3', 'x', 'patient')"));
+            CHECK(q.exec("INSERT INTO doctors (username, name, department, consultation_fee) VALUES ('doc1', '医生一', '内科', 10)"));
+            q.prepare("INSERT INTO doctor_schedules (doctor_username, day_of_week, start_time, end_time, max_appointments) "
+                      "VALUES ('doc1', :dow, '08:00', '17:00', 2)");
+            q.bindValue(":dow", day.dayOfWeek() % 7);
+            CHECK(q.exec());
+        }
+
+        int id1 = 0, id2 = 0, id3 = 0;
+        QString error;
+
+        // INSERT：每条预约计入 (医生, 日期, pending)
+        CHECK(db.bookAppointment(request("p1", date, "09:00"), id1, error));
+        CHECK(id1 > 0);
+        CHECK(counter(raw, "doc1", date, "pending") == 1);
+        CHECK(db.bookAppointment(request("p2", date, "10:00"), id2, error));
+        CHECK(id2 > id1);
+        CHECK(counter(raw, "doc1", date, "pending") == 2);
+
+        // 名额已满：拒绝、给出提示且不插入
+        id3 = 0;
+        CHECK(!db.bookAppointment(request("p3", date, "11:00"), id3, error));
+        CHECK(error == full);
+        CHECK(id3 == 0);
+        CHECK(appointmentRows(raw, "doc1", date) == 2);
+        CHECK(counter(raw, "doc1", date, "pending") == 2);
+
+        // 出诊时间外与无法解析的时间同样拒绝，不绕过名额检查
+        CHECK(!db.bookAppointment(request("p3", date, "20:00"), id3, error));
+        CHECK(!error.isEmpty());
+        CHECK(!db.bookAppointment(request("p3", date, "later"), id3, error));
+        CHECK(!error.isEmpty());
+        CHECK(appointmentRows(raw, "doc1", date) == 2);
+
+        // 状态 UPDATE（pending -> cancelled）：计数在两种状态间转移，并释放一个名额
+        CHECK(db.updateAppointmentStatus(id1, "cancelled"));
+        CHECK(counter(raw, "doc1", date, "pending") == 1);
+        CHECK(counter(raw, "doc1", date, "cancelled") == 1);
+        CHECK(db.bookAppointment(request("p3", date, "11:00"), id3, error));
+        CHECK(counter(raw, "doc1", date, "pending") == 2);
+
+        // 日期 UPDATE：计数从原日期转到新日期
+        {
+            QSqlQuery q(raw);
+            q.prepare("UPDATE appointments SET appointment_date = :date WHERE id = :id");
+            q.bindValue(":date", otherDate);
+            q.bindValue(":id", id2);
+            CHECK(q.exec());
+        }
+        CHECK(counter(raw, "doc1", date, "pending") == 1);
+        CHECK(counter(raw, "doc1", otherDate, "pending") == 1);
+
+        // DELETE：计数随之减少
+        {
+            QSqlQuery q(raw);
+            q.prepare("DELETE FROM appointments WHERE id = :id");
+            q.bindValue(":id", id3);
+            CHECK(q.exec());
+        }
+        CHECK(counter(raw, "doc1", date, "pending") == 0);
+        CHECK(counter(raw, "doc1", date, "cancelled") == 1);
+        CHECK(counter(raw, "doc1", otherDate, "pending") == 1);
+
+        raw.close();
+    }
+    QSqlDatabase::removeDatabase("counters_test");
+
+    if (failures > 0) {
+        qWarning() << "appointment_counters 测试失败项:" << failures;
+        return 1;
+    }
+    qDebug() << "appointment_counters 测试通过";
+    return 0;
+}